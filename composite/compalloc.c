@@ -406,6 +406,7 @@ compRedirectSubwindows(ClientPtr pClient, WindowPtr pWin, int update)
          * critical output
          */
         DamageExtSetCritical(pClient, TRUE);
+        SmartScheduleCompositorRedirect(pClient, TRUE);
         pWin->inhibitBGPaint = TRUE;
     }
     return Success;
@@ -435,6 +436,7 @@ compFreeClientSubwindows(WindowPtr pWin, XID id)
                  * critical output
                  */
                 DamageExtSetCritical(pClient, FALSE);
+                SmartScheduleCompositorRedirect(pClient, FALSE);
                 csw->update = CompositeRedirectAutomatic;
                 pWin->inhibitBGPaint = FALSE;
                 if (pWin->mapped)
@@ -56,88 +56,156 @@ SOFTWARE.
 #include "resource.h"
 #include "dix.h"
 
+/*
+ * Atom names are kept back to back in a string arena, in blocks that are
+ * only freed by FreeAllAtoms, so the pointers NameForAtom returns never
+ * move.  atomNames maps atoms to names; atomTable is an open-addressed
+ * hash table of atoms, each slot holding the hash of the name too, so a
+ * lookup hashes the name once and only compares names whose hashes match.
+ */
+
 #define InitialTableSize 256
+#define ArenaBlockSize  (16 * 1024)
 
-typedef struct _Node {
-    struct _Node *left, *right;
-    Atom a;
-    unsigned int fingerPrint;
+typedef struct _AtomName {
     const char *string;
-} NodeRec, *NodePtr;
+    unsigned int len;
+} AtomNameRec;
+
+typedef struct _AtomSlot {
+    CARD32 hash;
+    Atom atom;                  /* None for an empty slot */
+} AtomSlotRec;
+
+typedef struct _ArenaBlock {
+    struct _ArenaBlock *next;
+    char *top, *end;
+} ArenaBlockRec, *ArenaBlockPtr;
 
 static Atom lastAtom = None;
-static NodePtr atomRoot = NULL;
-static unsigned long tableLength;
-static NodePtr *nodeTable;
+static unsigned long tableLength;       /* entries in atomNames */
+static AtomNameRec *atomNames;
+static unsigned long atomTableMask;     /* entries in atomTable - 1 */
+static AtomSlotRec *atomTable;
+static ArenaBlockPtr atomArena;
 
-Atom
-MakeAtom(const char *string, unsigned len, Bool makeit)
+static CARD32
+AtomHash(const char *string, unsigned len)
 {
-    NodePtr *np;
+    CARD32 hash = 2166136261u;  /* FNV-1a */
     unsigned i;
-    int comp;
-    unsigned int fp = 0;
 
-    np = &atomRoot;
-    for (i = 0; i < (len + 1) / 2; i++) {
-        fp = fp * 27 + string[i];
-        fp = fp * 27 + string[len - 1 - i];
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char) string[i];
+        hash *= 16777619u;
     }
-    while (*np != NULL) {
-        if (fp < (*np)->fingerPrint)
-            np = &((*np)->left);
-        else if (fp > (*np)->fingerPrint)
-            np = &((*np)->right);
-        else {                  /* now start testing the strings */
-            comp = strncmp(string, (*np)->string, (int) len);
-            if ((comp < 0) || ((comp == 0) && (len < strlen((*np)->string))))
-                np = &((*np)->left);
-            else if (comp > 0)
-                np = &((*np)->right);
-            else
-                return (*np)->a;
-        }
-    }
-    if (makeit) {
-        NodePtr nd;
+    return hash;
+}
 
-        nd = malloc(sizeof(NodeRec));
-        if (!nd)
-            return BAD_RESOURCE;
-        if (lastAtom < XA_LAST_PREDEFINED) {
-            nd->string = string;
+static const char *
+AtomArenaCopy(const char *string, unsigned len)
+{
+    ArenaBlockPtr block = atomArena;
+    char *copy;
+
+    if (!block || block->end - block->top < len + 1) {
+        size_t size = max(ArenaBlockSize, len + 1);
+
+        block = malloc(sizeof(ArenaBlockRec) + size);
+        if (!block)
+            return NULL;
+        block->top = (char *) (block + 1);
+        block->end = block->top + size;
+        /* keep filling the fuller block if this one is just for a long name */
+        if (atomArena && size > ArenaBlockSize) {
+            block->next = atomArena->next;
+            atomArena->next = block;
         }
         else {
-            nd->string = strndup(string, len);
-            if (!nd->string) {
-                free(nd);
-                return BAD_RESOURCE;
-            }
-        }
-        if ((lastAtom + 1) >= tableLength) {
-            NodePtr *table;
-
-            table = reallocarray(nodeTable, tableLength, 2 * sizeof(NodePtr));
-            if (!table) {
-                if (nd->string != string) {
-                    /* nd->string has been strdup'ed */
-                    free((char *) nd->string);
-                }
-                free(nd);
-                return BAD_RESOURCE;
-            }
-            tableLength <<= 1;
-            nodeTable = table;
+            block->next = atomArena;
+            atomArena = block;
         }
-        *np = nd;
-        nd->left = nd->right = NULL;
-        nd->fingerPrint = fp;
-        nd->a = ++lastAtom;
-        nodeTable[lastAtom] = nd;
-        return nd->a;
     }
-    else
+
+    copy = block->top;
+    memcpy(copy, string, len);
+    copy[len] = '\0';
+    block->top += len + 1;
+    return copy;
+}
+
+static Bool
+AtomTableGrow(void)
+{
+    unsigned long size = (atomTableMask + 1) * 2;
+    AtomSlotRec *table;
+    unsigned long i, j;
+
+    table = calloc(size, sizeof(AtomSlotRec));
+    if (!table)
+        return FALSE;
+    for (i = 0; i <= atomTableMask; i++) {
+        if (atomTable[i].atom == None)
+            continue;
+        for (j = atomTable[i].hash & (size - 1); table[j].atom != None;
+             j = (j + 1) & (size - 1))
+            ;
+        table[j] = atomTable[i];
+    }
+    free(atomTable);
+    atomTable = table;
+    atomTableMask = size - 1;
+    return TRUE;
+}
+
+Atom
+MakeAtom(const char *string, unsigned len, Bool makeit)
+{
+    CARD32 hash = AtomHash(string, len);
+    unsigned long i;
+    const char *copy;
+
+    if (!atomTable)
+        return makeit ? BAD_RESOURCE : None;
+
+    for (i = hash & atomTableMask; atomTable[i].atom != None;
+         i = (i + 1) & atomTableMask) {
+        AtomNameRec *name = &atomNames[atomTable[i].atom];
+
+        if (atomTable[i].hash == hash && name->len == len &&
+            memcmp(name->string, string, len) == 0)
+            return atomTable[i].atom;
+    }
+    if (!makeit)
         return None;
+
+    /* keep the table at most half full */
+    if ((lastAtom + 1) * 2 > atomTableMask + 1) {
+        if (!AtomTableGrow())
+            return BAD_RESOURCE;
+        for (i = hash & atomTableMask; atomTable[i].atom != None;
+             i = (i + 1) & atomTableMask)
+            ;
+    }
+    if ((lastAtom + 1) >= tableLength) {
+        AtomNameRec *names;
+
+        names = reallocarray(atomNames, tableLength, 2 * sizeof(AtomNameRec));
+        if (!names)
+            return BAD_RESOURCE;
+        tableLength <<= 1;
+        atomNames = names;
+    }
+    copy = AtomArenaCopy(string, len);
+    if (!copy)
+        return BAD_RESOURCE;
+
+    ++lastAtom;
+    atomNames[lastAtom].string = copy;
+    atomNames[lastAtom].len = len;
+    atomTable[i].hash = hash;
+    atomTable[i].atom = lastAtom;
+    return lastAtom;
 }
 
 Bool
@@ -149,13 +217,9 @@ ValidAtom(Atom atom)
 const char *
 NameForAtom(Atom atom)
 {
-    NodePtr node;
-
-    if (atom > lastAtom)
+    if (atom == None || atom > lastAtom)
         return 0;
-    if ((node = nodeTable[atom]) == NULL)
-        return 0;
-    return node->string;
+    return atomNames[atom].string;
 }
 
 void
@@ -164,32 +228,21 @@ AtomError(void)
     FatalError("initializing atoms");
 }
 
-static void
-FreeAtom(NodePtr patom)
-{
-    if (patom->left)
-        FreeAtom(patom->left);
-    if (patom->right)
-        FreeAtom(patom->right);
-    if (patom->a > XA_LAST_PREDEFINED) {
-        /*
-         * All strings above XA_LAST_PREDEFINED are strdup'ed, so it's safe to
-         * cast here
-         */
-        free((char *) patom->string);
-    }
-    free(patom);
-}
-
 void
 FreeAllAtoms(void)
 {
-    if (atomRoot == NULL)
-        return;
-    FreeAtom(atomRoot);
-    atomRoot = NULL;
-    free(nodeTable);
-    nodeTable = NULL;
+    ArenaBlockPtr block, next;
+
+    for (block = atomArena; block; block = next) {
+        next = block->next;
+        free(block);
+    }
+    atomArena = NULL;
+    free(atomNames);
+    atomNames = NULL;
+    free(atomTable);
+    atomTable = NULL;
+    atomTableMask = 0;
     lastAtom = None;
 }
 
@@ -198,10 +251,13 @@ InitAtoms(void)
 {
     FreeAllAtoms();
     tableLength = InitialTableSize;
-    nodeTable = xallocarray(InitialTableSize, sizeof(NodePtr));
-    if (!nodeTable)
+    atomNames = xallocarray(InitialTableSize, sizeof(AtomNameRec));
+    atomTable = calloc(InitialTableSize * 2, sizeof(AtomSlotRec));
+    if (!atomNames || !atomTable)
         AtomError();
-    nodeTable[None] = NULL;
+    atomTableMask = InitialTableSize * 2 - 1;
+    atomNames[None].string = NULL;
+    atomNames[None].len = 0;
     MakePredeclaredAtoms();
     if (lastAtom != XA_LAST_PREDEFINED)
         AtomError();
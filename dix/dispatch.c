@@ -220,6 +220,7 @@ UpdateCurrentTimeIf(void)
 /* in milliseconds */
 #define SMART_SCHEDULE_DEFAULT_INTERVAL	5
 #define SMART_SCHEDULE_MAX_SLICE	15
+#define SMART_SCHEDULE_PERIOD		100
 
 #ifdef HAVE_SETITIMER
 Bool SmartScheduleSignalEnable = TRUE;
@@ -233,6 +234,21 @@ int SmartScheduleLatencyLimited = 0;
 static ClientPtr SmartLastClient;
 static int SmartLastIndex[SMART_MAX_PRIORITY - SMART_MIN_PRIORITY + 1];
 
+/*
+ * The default budgets of the classes above bulk add up to 80 ms, so bulk
+ * clients which are ready get the rest of each busy period.  A class can
+ * only run over its budget by the turn it started before running out,
+ * so that is at least 20 ms less one slice per class.
+ */
+Bool SmartScheduleClassesEnable = TRUE;
+SmartScheduleClassRec SmartScheduleClasses[SMART_NUM_CLASSES] = {
+    [SMART_CLASS_BULK] = { "bulk", 0, 0 },
+    [SMART_CLASS_NORMAL] = { "normal", 0, 30 },
+    [SMART_CLASS_INTERACTIVE] = { "interactive", 0, 20 },
+    [SMART_CLASS_COMPOSITOR] = { "compositor", 0, 30 },
+};
+static long SmartSchedulePeriodStart;
+
 #ifdef SMART_DEBUG
 long SmartLastPrint;
 #endif
@@ -261,8 +277,10 @@ clients_are_ready(void)
 void
 mark_client_ready(ClientPtr client)
 {
-    if (xorg_list_is_empty(&client->ready))
+    if (xorg_list_is_empty(&client->ready)) {
         xorg_list_append(&client->ready, &ready_clients);
+        client->smart_ready_tick = SmartScheduleTime;
+    }
 }
 
 /*
@@ -271,8 +289,10 @@ mark_client_ready(ClientPtr client)
  */
 void mark_client_saved_ready(ClientPtr client)
 {
-    if (xorg_list_is_empty(&client->ready))
+    if (xorg_list_is_empty(&client->ready)) {
         xorg_list_append(&client->ready, &saved_ready_clients);
+        client->smart_ready_tick = SmartScheduleTime;
+    }
 }
 
 /* Client has no requests queued and no data on network */
@@ -306,18 +326,154 @@ mark_client_ungrab(void)
     }
 }
 
+/*
+ * Rank of the client's class, or -1 if the class has used up its budget
+ * for this period and should let the others run first.
+ */
+static int
+SmartScheduleRank(ClientPtr client)
+{
+    SmartScheduleClassPtr class;
+
+    if (!SmartScheduleClassesEnable)
+        return 0;
+
+    class = &SmartScheduleClasses[client->smart_class];
+    if (class->budget && class->used >= class->budget)
+        return -1;
+    return client->smart_class;
+}
+
+void
+SmartScheduleSetClientClass(ClientPtr client, SmartScheduleClass class)
+{
+    client->smart_class = class;
+    client->smart_class_fixed = class != SMART_CLASS_NORMAL;
+}
+
+/*
+ * Count a manual Composite redirect taken or released by the client.  It
+ * is in the compositor class until it has released all of them.
+ */
+void
+SmartScheduleCompositorRedirect(ClientPtr client, Bool hold)
+{
+    if (hold) {
+        if (client->smart_redirects++ == 0)
+            SmartScheduleSetClientClass(client, SMART_CLASS_COMPOSITOR);
+    }
+    else if (client->smart_redirects > 0 && --client->smart_redirects == 0)
+        SmartScheduleSetClientClass(client, SMART_CLASS_NORMAL);
+}
+
+/*
+ * Move clients between normal and bulk as their smart_priority shows them
+ * using up their slices or going idle.  Interactive clients get demoted
+ * too if they start behaving like bulk ones.
+ */
+static void
+SmartScheduleClassify(ClientPtr client)
+{
+    if (client->smart_class_fixed)
+        return;
+
+    if (client->smart_priority <= SMART_BULK_PRIORITY)
+        client->smart_class = SMART_CLASS_BULK;
+    else if (client->smart_class == SMART_CLASS_BULK &&
+             client->smart_priority >= 0)
+        client->smart_class = SMART_CLASS_NORMAL;
+}
+
+/*
+ * Charge a finished turn to the client and its class.
+ */
+static void
+SmartScheduleAccount(ClientPtr client, long start_tick, Bool exhausted)
+{
+    long ran = SmartScheduleTime - start_tick;
+
+    client->smart_stats.run_time += ran;
+    if (exhausted)
+        client->smart_stats.exhausted++;
+    SmartScheduleClasses[client->smart_class].used += ran;
+    SmartScheduleClassify(client);
+    /* if it is still ready, it is waiting again from now on */
+    client->smart_ready_tick = SmartScheduleTime;
+}
+
+void
+SmartScheduleLogStats(ClientPtr client)
+{
+    SmartScheduleStatsPtr stats = &client->smart_stats;
+
+    if (!stats->turns)
+        return;
+
+    LogMessageVerb(X_INFO, 4,
+                   "client %d (%s): %lu turns, %lu cut short, ran %lums, "
+                   "waited %lums (max %lums)\n",
+                   client->index,
+                   SmartScheduleClasses[client->smart_class].name,
+                   stats->turns, stats->exhausted, stats->run_time,
+                   stats->wait_time, stats->max_wait);
+}
+
+/* Milliseconds from 0 to a whole period, with nothing after the digits */
+static Bool
+SmartScheduleParseTime(const char *str, long *ms)
+{
+    char *end;
+
+    *ms = strtol(str, &end, 10);
+    return end != str && *end == '\0' &&
+        *ms >= 0 && *ms <= SMART_SCHEDULE_PERIOD;
+}
+
+/*
+ * Set up a class from the -schedClass command line option.
+ */
+Bool
+SmartScheduleParseClass(const char *name, const char *slice,
+                        const char *budget)
+{
+    long slice_ms, budget_ms;
+    int i;
+
+    if (!SmartScheduleParseTime(slice, &slice_ms) ||
+        !SmartScheduleParseTime(budget, &budget_ms))
+        return FALSE;
+
+    for (i = 0; i < SMART_NUM_CLASSES; i++) {
+        if (strcmp(name, SmartScheduleClasses[i].name) == 0) {
+            SmartScheduleClasses[i].slice = slice_ms;
+            SmartScheduleClasses[i].budget = budget_ms;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
 static ClientPtr
 SmartScheduleClient(void)
 {
     ClientPtr pClient, best = NULL;
     int bestRobin, robin;
+    int bestRank, rank;
     long now = SmartScheduleTime;
-    long idle;
+    long idle, wait;
     int nready = 0;
+    int i;
 
     bestRobin = 0;
+    bestRank = 0;
     idle = 2 * SmartScheduleSlice;
 
+    if (now - SmartSchedulePeriodStart >= SMART_SCHEDULE_PERIOD) {
+        for (i = 0; i < SMART_NUM_CLASSES; i++)
+            SmartScheduleClasses[i].used = 0;
+        SmartSchedulePeriodStart = now;
+    }
+
     xorg_list_for_each_entry(pClient, &ready_clients, ready) {
         nready++;
 
@@ -332,20 +488,25 @@ SmartScheduleClient(void)
             (pClient->index -
              SmartLastIndex[pClient->smart_priority -
                             SMART_MIN_PRIORITY]) & 0xff;
+        rank = SmartScheduleRank(pClient);
 
         /* pick the best client */
         if (!best ||
             pClient->priority > best->priority ||
             (pClient->priority == best->priority &&
-             (pClient->smart_priority > best->smart_priority ||
-              (pClient->smart_priority == best->smart_priority && robin > bestRobin))))
+             (rank > bestRank ||
+              (rank == bestRank &&
+               (pClient->smart_priority > best->smart_priority ||
+                (pClient->smart_priority == best->smart_priority && robin > bestRobin))))))
         {
             best = pClient;
             bestRobin = robin;
+            bestRank = rank;
         }
 #ifdef SMART_DEBUG
         if ((now - SmartLastPrint) >= 5000)
-            fprintf(stderr, " %2d: %3d", pClient->index, pClient->smart_priority);
+            fprintf(stderr, " %2d: %3d/%d", pClient->index,
+                    pClient->smart_priority, pClient->smart_class);
 #endif
     }
 #ifdef SMART_DEBUG
@@ -355,6 +516,15 @@ SmartScheduleClient(void)
     }
 #endif
     SmartLastIndex[best->smart_priority - SMART_MIN_PRIORITY] = best->index;
+
+    best->smart_stats.turns++;
+    wait = now - best->smart_ready_tick;
+    if (wait > 0) {
+        best->smart_stats.wait_time += wait;
+        if (wait > best->smart_stats.max_wait)
+            best->smart_stats.max_wait = wait;
+    }
+
     /*
      * Set current client pointer
      */
@@ -404,7 +574,9 @@ Dispatch(void)
 {
     int result;
     ClientPtr client;
-    long start_tick;
+    long start_tick, slice;
+    Bool exhausted;
+    uint64_t stats_start;
 
     nextFreeClientID = 1;
     nClients = 0;
@@ -418,6 +590,11 @@ Dispatch(void)
             FlushIfCriticalOutputPending();
         }
 
+        if (RequestStatsPending)
+            RequestStatsSignaled();
+
+        ScratchReset();
+
         if (!WaitForSomething(clients_are_ready()))
             continue;
 
@@ -428,6 +605,11 @@ Dispatch(void)
 
         if (!dispatchException && clients_are_ready()) {
             client = SmartScheduleClient();
+            slice = SmartScheduleSlice;
+            if (SmartScheduleClassesEnable &&
+                SmartScheduleClasses[client->smart_class].slice)
+                slice = SmartScheduleClasses[client->smart_class].slice;
+            exhausted = FALSE;
 
             isItTimeToYield = FALSE;
 
@@ -437,11 +619,12 @@ Dispatch(void)
                     ProcessInputEvents();
 
                 FlushIfCriticalOutputPending();
-                if ((SmartScheduleTime - start_tick) >= SmartScheduleSlice)
+                if ((SmartScheduleTime - start_tick) >= slice)
                 {
                     /* Penalize clients which consume ticks */
                     if (client->smart_priority > SMART_MIN_PRIORITY)
                         client->smart_priority--;
+                    exhausted = TRUE;
                     break;
                 }
 
@@ -470,6 +653,7 @@ Dispatch(void)
                                           client->index,
                                           client->requestBuffer);
 #endif
+                stats_start = RequestStatsEnabled ? RequestStatsTime() : 0;
                 if (result > (maxBigRequestSize << 2))
                     result = BadLength;
                 else {
@@ -478,6 +662,9 @@ Dispatch(void)
                         result =
                             (*client->requestVector[client->majorOp]) (client);
                 }
+                if (stats_start)
+                    RequestStatsDone(client, stats_start);
+                ScratchReset();
                 if (!SmartScheduleSignalEnable)
                     SmartScheduleTime = GetTimeInMillis();
 
@@ -500,8 +687,10 @@ Dispatch(void)
                 }
             }
             FlushAllOutput();
-            if (client == SmartLastClient)
+            if (client == SmartLastClient) {
                 client->smart_stop_tick = SmartScheduleTime;
+                SmartScheduleAccount(client, start_tick, exhausted);
+            }
         }
         dispatchException &= ~DE_PRIORITYCHANGE;
     }
@@ -2066,6 +2255,31 @@ ProcPutImage(ClientPtr client)
     return Success;
 }
 
+/*
+ * Make sure *buffer isn't still queued for output before GetImage fills it
+ * again, switching to a new one if it is.  The reply header has already
+ * gone out, so if that fails the client can only be dropped.
+ */
+static Bool
+GetImageBuffer(ClientPtr client, OsBufferPtr *buffer, char **data,
+               long length)
+{
+    OsBufferPtr fresh;
+
+    if (!OsBufferIsShared(*buffer))
+        return TRUE;
+
+    fresh = OsBufferAlloc(length);
+    if (!fresh) {
+        MarkClientException(client);
+        return FALSE;
+    }
+    OsBufferUnref(*buffer);
+    *buffer = fresh;
+    *data = OsBufferData(fresh);
+    return TRUE;
+}
+
 static int
 DoGetImage(ClientPtr client, int format, Drawable drawable,
            int x, int y, int width, int height,
@@ -2079,6 +2293,7 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
     int relx, rely;
     long widthBytesLine, length;
     Mask plane = 0;
+    OsBufferPtr pOsBuf;
     char *pBuf;
     xGetImageReply xgi;
     RegionPtr pVisibleRegion = NULL;
@@ -2192,8 +2407,11 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
             length += widthBytesLine;
         }
     }
-    if (!(pBuf = calloc(1, length)))
+    /* Bands still queued for a slow client are sent from this buffer, not
+     * copied, so start a fresh one rather than overwrite it. */
+    if (!(pOsBuf = OsBufferAlloc(length)))
         return BadAlloc;
+    pBuf = OsBufferData(pOsBuf);
     WriteReplyToClient(client, sizeof(xGetImageReply), &xgi);
 
     if (pDraw->type == DRAWABLE_WINDOW)
@@ -2206,6 +2424,8 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
         linesDone = 0;
         while (height - linesDone > 0) {
             nlines = min(linesPerBuf, height - linesDone);
+            if (!GetImageBuffer(client, &pOsBuf, &pBuf, length))
+                break;
             (*pDraw->pScreen->GetImage) (pDraw,
                                          x,
                                          y + linesDone,
@@ -2222,7 +2442,8 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
             ReformatImage(pBuf, (int) (nlines * widthBytesLine),
                           BitsPerPixel(pDraw->depth), ClientOrder(client));
 
-            WriteToClient(client, (int) (nlines * widthBytesLine), pBuf);
+            WriteBufferToClient(client, (int) (nlines * widthBytesLine), pBuf,
+                                pOsBuf);
             linesDone += nlines;
         }
     }
@@ -2233,6 +2454,8 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
                 linesDone = 0;
                 while (height - linesDone > 0) {
                     nlines = min(linesPerBuf, height - linesDone);
+                    if (!GetImageBuffer(client, &pOsBuf, &pBuf, length))
+                        break;
                     (*pDraw->pScreen->GetImage) (pDraw,
                                                  x,
                                                  y + linesDone,
@@ -2250,13 +2473,15 @@ DoGetImage(ClientPtr client, int format, Drawable drawable,
                     ReformatImage(pBuf, (int) (nlines * widthBytesLine),
                                   1, ClientOrder(client));
 
-                    WriteToClient(client, (int)(nlines * widthBytesLine), pBuf);
+                    WriteBufferToClient(client,
+                                        (int) (nlines * widthBytesLine), pBuf,
+                                        pOsBuf);
                     linesDone += nlines;
                 }
             }
         }
     }
-    free(pBuf);
+    OsBufferUnref(pOsBuf);
     return Success;
 }
 
@@ -3445,6 +3670,7 @@ CloseDownClient(ClientPtr client)
         CloseDownConnection(client);
         output_pending_clear(client);
         mark_client_not_ready(client);
+        SmartScheduleLogStats(client);
 
         /* If the client made it to the Running stage, nClients has
          * been incremented on its behalf, so we need to decrement it
@@ -3514,6 +3740,9 @@ InitClient(ClientPtr client, int i, void *ospriv)
     QueryMinMaxKeyCodes(&client->minKC, &client->maxKC);
     client->smart_start_tick = SmartScheduleTime;
     client->smart_stop_tick = SmartScheduleTime;
+    client->smart_ready_tick = SmartScheduleTime;
+    client->smart_class = SMART_CLASS_NORMAL;
+    client->smart_redirects = 0;
     client->clientIds = NULL;
 }
 
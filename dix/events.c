@@ -2015,6 +2015,9 @@ TryClientEvents(ClientPtr client, DeviceIntPtr dev, xEvent *pEvents,
     if (BitIsOn(criticalEvents, type)) {
         if (client->smart_priority < SMART_MAX_PRIORITY)
             client->smart_priority++;
+        /* clients reacting to input are interactive until they hog */
+        if (client->smart_class == SMART_CLASS_NORMAL)
+            client->smart_class = SMART_CLASS_INTERACTIVE;
         SetCriticalOutputPending();
     }
 
@@ -2101,60 +2104,157 @@ DeliverToWindowOwner(DeviceIntPtr dev, WindowPtr win,
     return EVENT_NOT_DELIVERED;
 }
 
+/*
+ * Most of the clients that selected for events on a window don't want any
+ * one kind of event, but delivery used to try each of them.  So for the
+ * last few kinds of events delivered to a window we keep the clients that
+ * do want them, in the order of the window's client list.  The lists hang
+ * off the window's optional record and are thrown away by
+ * InvalidateInputRecipients whenever selections on the window change.
+ */
+#define INPUT_RECIPIENTS_MAX 4  /* lists kept per window */
+
+typedef struct _InputRecipients {
+    struct _InputRecipients *next;
+    int deviceid;
+    Bool master;
+    int type;
+    int evtype;                 /* XI2 event type, or 0 */
+    Mask filter;
+    int nclients;
+    InputClients *clients[];
+} InputRecipientsRec, *InputRecipientsPtr;
+
+/**
+ * Drop the cached recipient lists of the window.  Must be called whenever
+ * a client's event selection on the window changes.
+ */
+void
+InvalidateInputRecipients(WindowPtr pWin)
+{
+    InputRecipientsPtr r, next;
+
+    if (!pWin->optional)
+        return;
+
+    for (r = pWin->optional->recipients; r; r = next) {
+        next = r->next;
+        free(r);
+    }
+    pWin->optional->recipients = NULL;
+}
+
+/**
+ * Find or make the list of clients in iclients whose masks want the event.
+ *
+ * @return The list, or NULL if we're out of memory.
+ */
+static InputRecipientsPtr
+GetInputRecipients(DeviceIntPtr dev, WindowPtr win, xEvent *events,
+                   Mask filter, InputClients * iclients)
+{
+    InputRecipientsPtr r, *prev;
+    InputClients *ic;
+    int type = events->u.u.type;
+    int evtype = xi2_get_type(events);
+    Bool master = evtype ? IsMaster(dev) : FALSE;
+    int n = 0, depth = 0;
+
+    for (prev = &win->optional->recipients; (r = *prev); prev = &r->next) {
+        if (r->deviceid == dev->id && r->master == master &&
+            r->type == type && r->evtype == evtype && r->filter == filter) {
+            /* keep the busiest lists at the front */
+            *prev = r->next;
+            r->next = win->optional->recipients;
+            win->optional->recipients = r;
+            return r;
+        }
+        if (++depth == INPUT_RECIPIENTS_MAX) {
+            *prev = NULL;
+            free(r);
+            break;
+        }
+    }
+
+    for (ic = iclients; ic; ic = ic->next)
+        if (GetEventMask(dev, events, ic) & filter)
+            n++;
+
+    r = malloc(sizeof(InputRecipientsRec) + n * sizeof(InputClients *));
+    if (!r)
+        return NULL;
+    r->deviceid = dev->id;
+    r->master = master;
+    r->type = type;
+    r->evtype = evtype;
+    r->filter = filter;
+    r->nclients = 0;
+    for (ic = iclients; ic; ic = ic->next)
+        if (GetEventMask(dev, events, ic) & filter)
+            r->clients[r->nclients++] = ic;
+
+    r->next = win->optional->recipients;
+    win->optional->recipients = r;
+    return r;
+}
+
 /**
  * Get the list of clients that should be tried for event delivery on the
- * given window.
+ * given window.  *recipients is NULL if there are none.
  *
  * @return 1 if the client list should be traversed, zero if the event
  * should be skipped.
  */
 static Bool
 GetClientsForDelivery(DeviceIntPtr dev, WindowPtr win,
-                      xEvent *events, Mask filter, InputClients ** iclients)
+                      xEvent *events, Mask filter,
+                      InputRecipientsPtr *recipients)
 {
-    int rc = 0;
+    InputClients *iclients;
 
     if (core_get_type(events) != 0)
-        *iclients = (InputClients *) wOtherClients(win);
+        iclients = (InputClients *) wOtherClients(win);
     else if (xi2_get_type(events) != 0) {
         OtherInputMasks *inputMasks = wOtherInputMasks(win);
 
         /* Has any client selected for the event? */
         if (!WindowXI2MaskIsset(dev, win, events))
-            goto out;
-        *iclients = inputMasks->inputClients;
+            return 0;
+        iclients = inputMasks->inputClients;
     }
     else {
         OtherInputMasks *inputMasks = wOtherInputMasks(win);
 
         /* Has any client selected for the event? */
         if (!inputMasks || !(inputMasks->inputEvents[dev->id] & filter))
-            goto out;
+            return 0;
 
-        *iclients = inputMasks->inputClients;
+        iclients = inputMasks->inputClients;
     }
 
-    rc = 1;
- out:
-    return rc;
+    *recipients = NULL;
+    if (iclients)
+        *recipients = GetInputRecipients(dev, win, events, filter, iclients);
+    return 1;
 }
 
 /**
- * Try delivery on each client in inputclients, provided the event mask
- * accepts it and there is no interfering core grab..
+ * Try delivery on each of the clients, provided the event mask accepts it
+ * and there is no interfering core grab..
  */
 static enum EventDeliveryState
-DeliverEventToInputClients(DeviceIntPtr dev, InputClients * inputclients,
-                           WindowPtr win, xEvent *events,
+DeliverEventToInputClients(DeviceIntPtr dev, InputClients ** iclients,
+                           int niclients, WindowPtr win, xEvent *events,
                            int count, Mask filter, GrabPtr grab,
                            ClientPtr *client_return, Mask *mask_return)
 {
-    int attempt;
+    int i, attempt;
     enum EventDeliveryState rc = EVENT_NOT_DELIVERED;
     Bool have_device_button_grab_class_client = FALSE;
 
-    for (; inputclients; inputclients = inputclients->next) {
+    for (i = 0; i < niclients; i++) {
         Mask mask;
+        InputClients *inputclients = iclients[i];
         ClientPtr client = rClient(inputclients);
 
         if (IsInterferingGrab(client, dev, events))
@@ -2205,13 +2305,17 @@ DeliverEventToWindowMask(DeviceIntPtr dev, WindowPtr win, xEvent *events,
                          int count, Mask filter, GrabPtr grab,
                          ClientPtr *client_return, Mask *mask_return)
 {
-    InputClients *iclients;
+    InputRecipientsPtr recipients;
 
-    if (!GetClientsForDelivery(dev, win, events, filter, &iclients))
+    if (!GetClientsForDelivery(dev, win, events, filter, &recipients))
         return EVENT_SKIP;
+    if (!recipients)
+        return EVENT_NOT_DELIVERED;
 
-    return DeliverEventToInputClients(dev, iclients, win, events, count, filter,
-                                      grab, client_return, mask_return);
+    return DeliverEventToInputClients(dev, recipients->clients,
+                                      recipients->nclients, win, events,
+                                      count, filter, grab, client_return,
+                                      mask_return);
 
 }
 
@@ -2372,28 +2476,26 @@ DeliverRawEvent(RawDeviceEvent *ev, DeviceIntPtr device)
 
     for (i = 0; i < screenInfo.numScreens; i++) {
         WindowPtr root;
-        InputClients *inputclients;
+        InputRecipientsPtr recipients;
+        int j;
 
         root = screenInfo.screens[i]->root;
-        if (!GetClientsForDelivery(device, root, xi, filter, &inputclients))
+        if (!GetClientsForDelivery(device, root, xi, filter, &recipients) ||
+            !recipients)
             continue;
 
-        for (; inputclients; inputclients = inputclients->next) {
+        for (j = 0; j < recipients->nclients; j++) {
             ClientPtr c;        /* unused */
             Mask m;             /* unused */
-            InputClients ic = *inputclients;
 
-            /* Because we run through the list manually, copy the actual
-             * list, shorten the copy to only have one client and then pass
-             * that down to DeliverEventToInputClients. This way we avoid
-             * double events on XI 2.1 clients that have a grab on the
-             * device.
+            /* Deliver to the clients one by one, so that we can skip
+             * XI 2.1 clients that have a grab on the device and got the
+             * event already.
              */
-            ic.next = NULL;
-
-            if (!FilterRawEvents(rClient(&ic), grab, root))
-                DeliverEventToInputClients(device, &ic, root, xi, 1,
-                                           filter, NULL, &c, &m);
+            if (!FilterRawEvents(rClient(recipients->clients[j]), grab, root))
+                DeliverEventToInputClients(device, &recipients->clients[j],
+                                           1, root, xi, 1, filter, NULL,
+                                           &c, &m);
         }
     }
 
@@ -4346,6 +4448,8 @@ RecalculateDeliverableEvents(WindowPtr pWin)
     OtherClients *others;
     WindowPtr pChild;
 
+    InvalidateInputRecipients(pWin);
+
     pChild = pWin;
     while (1) {
         if (pChild->optional) {
@@ -112,6 +112,7 @@ Equipment Corporation.
 #else
 #include "dixevents.h"          /* InitEvents() */
 #endif
+#include "mi.h"
 
 #ifdef DPMSExtension
 #include <X11/extensions/dpmsconst.h>
@@ -191,6 +192,8 @@ dix_main(int argc, char *argv[], char *envp[])
         InitFonts();
         InitCallbackManager();
         InitOutput(&screenInfo, argc, argv);
+        /* after InitOutput, in case the DDX wants SIGUSR2 */
+        RequestStatsInit();
 
         if (screenInfo.numScreens < 1)
             FatalError("no screens found");
@@ -271,10 +274,17 @@ dix_main(int argc, char *argv[], char *envp[])
 
         NotifyParentProcess();
 
+        dixPrivateLayout(4);
+
         InputThreadInit();
+        ReaderThreadInit();
 
         Dispatch();
 
+        RequestStatsFini();
+        ReaderThreadFini();
+        WorkerThreadFini();
+
         UndisplayDevices();
         DisableAllDevices();
 
@@ -340,6 +350,10 @@ dix_main(int argc, char *argv[], char *envp[])
 
         FreeAuditTimer();
 
+        FreePixmapPool();
+
+        miArcCacheFlush();
+
         DeleteCallbackManager();
 
         if (dispatchException & DE_TERMINATE) {
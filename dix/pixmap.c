@@ -105,21 +105,138 @@ FreeScratchPixmapsForScreen(ScreenPtr pScreen)
     FreeScratchPixmapHeader(pScreen->pScratchPixmap);
 }
 
+/*
+ * Pixmap pool
+ *
+ * Compositing managers and RENDER create and destroy lots of short-lived
+ * pixmaps of the same few sizes: glyph masks, temporaries for
+ * CompositeGlyphs and window backing pixmaps while a window is resized.
+ * Rather than going back to malloc every time, freed pixmap memory is
+ * kept on free lists by size class, and AllocatePixmap takes a block from
+ * the right list when there is one.
+ *
+ * Size classes are eight steps per power of two, so a pixmap wastes at
+ * most an eighth of its size to rounding.  The pool holds at most
+ * PixmapPoolLimit bytes (-pixmappool), and no single block bigger than a
+ * quarter of that.  Blocks that sat unused through a whole trim interval
+ * are given back to malloc, so an idle server doesn't hang on to them.
+ *
+ * Pixmaps are only created and destroyed on the main thread.
+ */
+
+#define PIXMAP_POOL_MIN         256     /* smallest size class */
+#define PIXMAP_POOL_STEPS       8       /* size classes per power of two */
+#define PIXMAP_POOL_CLASSES     (1 + PIXMAP_POOL_STEPS * (32 - 8))
+#define PIXMAP_POOL_TRIM_MS     5000
+
+typedef union _PixmapBlock {
+    struct {
+        union _PixmapBlock *next;       /* on a free list */
+        int class;                      /* -1 if not from the pool */
+    } b;
+    char align[16];
+} PixmapBlock;
+
+size_t PixmapPoolLimit = 16 * 1024 * 1024;
+
+static PixmapBlock *poolFree[PIXMAP_POOL_CLASSES];
+static int poolCount[PIXMAP_POOL_CLASSES];
+static int poolUnused[PIXMAP_POOL_CLASSES];     /* fewest free since trim */
+static size_t poolBytes;
+static OsTimerPtr poolTimer;
+static Bool poolTimerArmed;
+
+static unsigned long poolHits, poolMisses, poolReleased, poolTrimmed;
+
+/* Index of the smallest size class holding size bytes, or -1 */
+static int
+PixmapPoolClass(size_t size)
+{
+    int log2, step;
+
+    if (size <= PIXMAP_POOL_MIN)
+        return 0;
+    log2 = 8 * sizeof(long long) - 1 - __builtin_clzll(size - 1);
+    if (log2 >= 32)
+        return -1;
+    step = ((size - 1 - ((size_t) 1 << log2)) >> (log2 - 3)) + 1;
+    return 1 + (log2 - 8) * PIXMAP_POOL_STEPS + step - 1;
+}
+
+static size_t
+PixmapPoolClassSize(int class)
+{
+    int log2, step;
+
+    if (class == 0)
+        return PIXMAP_POOL_MIN;
+    log2 = 8 + (class - 1) / PIXMAP_POOL_STEPS;
+    step = (class - 1) % PIXMAP_POOL_STEPS + 1;
+    return ((size_t) 1 << log2) + ((size_t) step << (log2 - 3));
+}
+
+static CARD32
+PixmapPoolTrim(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    PixmapBlock *block;
+    int class;
+
+    for (class = 0; class < PIXMAP_POOL_CLASSES; class++) {
+        for (; poolUnused[class]; poolUnused[class]--) {
+            block = poolFree[class];
+            poolFree[class] = block->b.next;
+            poolCount[class]--;
+            poolBytes -= PixmapPoolClassSize(class);
+            poolTrimmed++;
+            free(block);
+        }
+        poolUnused[class] = poolCount[class];
+    }
+
+    if (poolBytes)
+        return PIXMAP_POOL_TRIM_MS;
+    poolTimerArmed = FALSE;
+    return 0;
+}
+
 /* callable by ddx */
 PixmapPtr
 AllocatePixmap(ScreenPtr pScreen, int pixDataSize)
 {
     PixmapPtr pPixmap;
+    PixmapBlock *block;
+    size_t size;
+    int class = -1;
 
     assert(pScreen->totalPixmapSize > 0);
 
-    if (pScreen->totalPixmapSize > ((size_t) - 1) - pixDataSize)
+    if (pScreen->totalPixmapSize >
+        ((size_t) - 1) - sizeof(PixmapBlock) - pixDataSize)
         return NullPixmap;
+    size = sizeof(PixmapBlock) + pScreen->totalPixmapSize + pixDataSize;
 
-    pPixmap = malloc(pScreen->totalPixmapSize + pixDataSize);
-    if (!pPixmap)
-        return NullPixmap;
+    if (size <= PixmapPoolLimit / 4)
+        class = PixmapPoolClass(size);
+
+    if (class >= 0 && (block = poolFree[class])) {
+        poolFree[class] = block->b.next;
+        if (--poolCount[class] < poolUnused[class])
+            poolUnused[class] = poolCount[class];
+        poolBytes -= PixmapPoolClassSize(class);
+        poolHits++;
+    }
+    else {
+        if (class >= 0) {
+            size = PixmapPoolClassSize(class);
+            poolMisses++;
+        }
+        block = malloc(size);
+        if (!block)
+            return NullPixmap;
+    }
+    block->b.class = class;
 
+    pPixmap = (PixmapPtr) (block + 1);
     dixInitScreenPrivates(pScreen, pPixmap, pPixmap + 1, PRIVATE_PIXMAP);
     return pPixmap;
 }
@@ -128,8 +245,76 @@ AllocatePixmap(ScreenPtr pScreen, int pixDataSize)
 void
 FreePixmap(PixmapPtr pPixmap)
 {
+    PixmapBlock *block = (PixmapBlock *) pPixmap - 1;
+    int class = block->b.class;
+    size_t size;
+
     dixFiniPrivates(pPixmap, PRIVATE_PIXMAP);
-    free(pPixmap);
+
+    if (class < 0) {
+        free(block);
+        return;
+    }
+
+    size = PixmapPoolClassSize(class);
+    if (poolBytes + size > PixmapPoolLimit) {
+        poolReleased++;
+        free(block);
+        return;
+    }
+
+    block->b.next = poolFree[class];
+    poolFree[class] = block;
+    poolCount[class]++;
+    poolBytes += size;
+
+    if (!poolTimerArmed) {
+        poolTimer = TimerSet(poolTimer, 0, PIXMAP_POOL_TRIM_MS,
+                             PixmapPoolTrim, NULL);
+        poolTimerArmed = poolTimer != NULL;
+    }
+}
+
+/**
+ * Empty the pixmap pool, at the end of a server generation.
+ */
+void
+FreePixmapPool(void)
+{
+    int class;
+
+    TimerFree(poolTimer);
+    poolTimer = NULL;
+    poolTimerArmed = FALSE;
+
+    for (class = 0; class < PIXMAP_POOL_CLASSES; class++) {
+        while (poolFree[class]) {
+            PixmapBlock *block = poolFree[class];
+
+            poolFree[class] = block->b.next;
+            free(block);
+        }
+        poolCount[class] = poolUnused[class] = 0;
+    }
+    poolBytes = 0;
+}
+
+/**
+ * Log how well the pixmap pool has done since the server started.
+ */
+void
+PixmapPoolLogStats(void)
+{
+    unsigned long allocs = poolHits + poolMisses;
+
+    if (!allocs)
+        return;
+    LogMessageVerb(X_INFO, 0,
+                   "Pixmap pool: %lu of %lu allocations reused (%.1f%%), "
+                   "%zu KiB retained, %lu freed over the limit, "
+                   "%lu trimmed when idle\n",
+                   poolHits, allocs, 100.0 * poolHits / allocs,
+                   poolBytes / 1024, poolReleased, poolTrimmed);
 }
 
 void PixmapUnshareSlavePixmap(PixmapPtr slave_pixmap)
@@ -66,6 +66,9 @@ from The Open Group.
 
 static DevPrivateSetRec global_keys[PRIVATE_LAST];
 
+/* where the keys registered with dixRegisterHotPrivateKey lie */
+static unsigned hot_start[PRIVATE_LAST], hot_end[PRIVATE_LAST];
+
 static const Bool xselinux_private[PRIVATE_LAST] = {
     [PRIVATE_SCREEN] = TRUE,
     [PRIVATE_CLIENT] = TRUE,
@@ -322,18 +325,12 @@ grow_screen_specific_set(DevPrivateType type, unsigned bytes)
     }
 }
 
-/*
- * Register a private key. This takes the type of object the key will
- * be used with, which may be PRIVATE_ALL indicating that this key
- * will be used with all of the private objects. If 'size' is
- * non-zero, then the specified amount of space will be allocated in
- * the private storage. Otherwise, space for a single pointer will
- * be allocated which can be set with dixSetPrivate
- */
-Bool
-dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
+static Bool
+registerPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size,
+                   Bool hot)
 {
     DevPrivateType t;
+    DevPrivateKey k;
     int offset;
     unsigned bytes;
 
@@ -370,6 +367,8 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
             if (xselinux_private[t]) {
                 grow_private_set(&global_keys[t], bytes);
                 grow_screen_specific_set(t, bytes);
+                hot_start[t] += bytes;
+                hot_end[t] += bytes;
                 if (allocated_early[t])
                     allocated_early[t] (dixMovePrivates, bytes);
             }
@@ -378,6 +377,20 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
 
         offset = 0;
     }
+    else if (hot && !allocated_early[type]) {
+        /* Nothing has been allocated yet, so just move the cold keys
+         * (and the screen-specific ones after them) up to make room
+         * at the end of the hot ones
+         */
+        assert(!global_keys[type].created);
+        offset = hot_end[type];
+        for (k = global_keys[type].key; k; k = k->next)
+            if (k->offset >= offset)
+                k->offset += bytes;
+        global_keys[type].offset += bytes;
+        grow_screen_specific_set(type, bytes);
+        hot_end[type] += bytes;
+    }
     else {
         /* Resize if we can, or make sure nothing's allocated if we can't */
         if (!allocated_early[type])
@@ -401,6 +414,33 @@ dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
     return TRUE;
 }
 
+/*
+ * Register a private key. This takes the type of object the key will
+ * be used with, which may be PRIVATE_ALL indicating that this key
+ * will be used with all of the private objects. If 'size' is
+ * non-zero, then the specified amount of space will be allocated in
+ * the private storage. Otherwise, space for a single pointer will
+ * be allocated which can be set with dixSetPrivate
+ */
+Bool
+dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size)
+{
+    return registerPrivateKey(key, type, size, FALSE);
+}
+
+/*
+ * Register a private key for a private used on nearly every operation on
+ * the object.  These are kept together at the start of the private
+ * storage, in the order they were registered, with the other privates
+ * after them.
+ */
+Bool
+dixRegisterHotPrivateKey(DevPrivateKey key, DevPrivateType type,
+                         unsigned size)
+{
+    return registerPrivateKey(key, type, size, TRUE);
+}
+
 Bool
 dixRegisterScreenPrivateKey(DevScreenPrivateKey screenKey, ScreenPtr pScreen,
                             DevPrivateType type, unsigned size)
@@ -754,6 +794,94 @@ dixPrivateUsage(void)
     ErrorF("TOTAL: %d objects, %d bytes, %d allocs\n", objects, bytes, alloc);
 }
 
+static int
+keyOffsetCompare(const void *a, const void *b)
+{
+    DevPrivateKey ka = *(DevPrivateKey const *) a;
+    DevPrivateKey kb = *(DevPrivateKey const *) b;
+
+    return ka->offset - kb->offset;
+}
+
+static void
+logPrivateKeys(int verb, DevPrivateType type, DevPrivateKey global,
+               DevPrivateKey selinux, DevPrivateKey screen)
+{
+    DevPrivateKey lists[3] = { selinux, global, screen };
+    DevPrivateKey key, *keys;
+    int i, n = 0;
+
+    for (i = 0; i < ARRAY_SIZE(lists); i++)
+        for (key = lists[i]; key; key = key->next)
+            n++;
+    keys = xallocarray(n, sizeof(DevPrivateKey));
+    if (!keys)
+        return;
+
+    n = 0;
+    for (i = 0; i < ARRAY_SIZE(lists); i++)
+        for (key = lists[i]; key; key = key->next)
+            keys[n++] = key;
+    qsort(keys, n, sizeof(DevPrivateKey), keyOffsetCompare);
+
+    for (i = 0; i < n; i++) {
+        const char *what = "cold";
+
+        key = keys[i];
+        if (key->type == PRIVATE_XSELINUX)
+            what = "xselinux";
+        else if (key->offset >= global_keys[type].offset)
+            what = "screen-specific";
+        else if ((unsigned) key->offset >= hot_start[type] &&
+                 (unsigned) key->offset < hot_end[type])
+            what = "hot";
+        LogMessageVerb(X_NONE, verb, "    %6d %6d %s\n", key->offset,
+                       key->size ? key->size : (int) sizeof(void *), what);
+    }
+    free(keys);
+}
+
+/*
+ * Log the offset and size of every private, by object type, to help
+ * decide which keys should be hot.
+ */
+void
+dixPrivateLayout(int verb)
+{
+    DevPrivateType t;
+    DevPrivateSetPtr set;
+    DevPrivateKey selinux;
+    int s;
+
+    for (t = PRIVATE_XSELINUX + 1; t < PRIVATE_LAST; t++) {
+        if (!global_keys[t].offset && !screen_specific_private[t])
+            continue;
+        selinux = xselinux_private[t] ? global_keys[PRIVATE_XSELINUX].key :
+            NULL;
+
+        LogMessageVerb(X_INFO, verb,
+                       "%s privates: %d bytes, %u of them hot, in %d objects\n",
+                       key_names[t], global_keys[t].offset,
+                       hot_end[t] - hot_start[t], global_keys[t].created);
+        LogMessageVerb(X_NONE, verb, "    %6s %6s\n", "offset", "size");
+        if (!screen_specific_private[t]) {
+            logPrivateKeys(verb, t, global_keys[t].key, selinux, NULL);
+            continue;
+        }
+
+        for (s = 0; s < screenInfo.numScreens + screenInfo.numGPUScreens; s++) {
+            ScreenPtr pScreen = s < screenInfo.numScreens ?
+                screenInfo.screens[s] :
+                screenInfo.gpuscreens[s - screenInfo.numScreens];
+
+            set = &pScreen->screenSpecificPrivates[t];
+            LogMessageVerb(X_NONE, verb, "  screen %d: %u bytes\n",
+                           pScreen->myNum, set->offset);
+            logPrivateKeys(verb, t, global_keys[t].key, selinux, set->key);
+        }
+    }
+}
+
 void
 dixResetPrivates(void)
 {
@@ -778,6 +906,7 @@ dixResetPrivates(void)
         }
         global_keys[t].key = NULL;
         global_keys[t].offset = 0;
+        hot_start[t] = hot_end[t] = 0;
         global_keys[t].created = 0;
         global_keys[t].allocated = 0;
     }
@@ -65,8 +65,172 @@ SOFTWARE.
  *   Properties belong to windows.  The list of properties should not be
  *   traversed directly.  Instead, use the three functions listed above.
  *
+ *   Once a window has PROPERTY_INDEX_MIN properties, they are also kept
+ *   in a hash table by name, so that looking one up doesn't walk the
+ *   list.  The list stays the real thing: if the index can't be
+ *   allocated, the window simply goes without and lookups walk the list.
+ *
+ *   A name can be on the list more than once, when an XACE module such
+ *   as SELinux polyinstantiates it; the module walks on from the first
+ *   instance to the one the client may see.  So the index only holds
+ *   the instance of each name that comes first on the list.
+ *
  *****************************************************************/
 
+#define PROPERTY_INDEX_MIN      16
+
+typedef struct _PropertyIndex {
+    int bits;                   /* log2 of the number of slots */
+    int used;
+    PropertyPtr slots[];        /* open addressing, linear probing */
+} PropertyIndexRec, *PropertyIndexPtr;
+
+static inline unsigned
+PropertyHash(Atom name, int bits)
+{
+    return (uint32_t) (name * 2654435761u) >> (32 - bits);
+}
+
+/* The slot holding name, or the empty one where its probe chain ends */
+static PropertyPtr *
+PropertyIndexSlot(PropertyIndexPtr index, Atom name)
+{
+    unsigned mask = (1u << index->bits) - 1;
+    unsigned i = PropertyHash(name, index->bits);
+
+    while (index->slots[i] && index->slots[i]->propertyName != name)
+        i = (i + 1) & mask;
+    return &index->slots[i];
+}
+
+/* Index all the properties on the list, leaving room for as many again */
+static PropertyIndexPtr
+PropertyIndexBuild(PropertyPtr list)
+{
+    PropertyIndexPtr index;
+    PropertyPtr pProp, *slot;
+    int count = 0, bits = 6;
+
+    for (pProp = list; pProp; pProp = pProp->next)
+        count++;
+    while ((1 << bits) < count * 4)
+        bits++;
+
+    index = calloc(1, sizeof(PropertyIndexRec) +
+                   (sizeof(PropertyPtr) << bits));
+    if (!index)
+        return NULL;
+    index->bits = bits;
+    for (pProp = list; pProp; pProp = pProp->next) {
+        /* later instances of a name stay behind the first */
+        slot = PropertyIndexSlot(index, pProp->propertyName);
+        if (!*slot) {
+            *slot = pProp;
+            index->used++;
+        }
+    }
+    return index;
+}
+
+/* Called with pProp just put at the head of the window's list */
+static void
+PropertyIndexAdd(WindowPtr pWin, PropertyPtr pProp)
+{
+    WindowOptPtr optional = pWin->optional;
+    PropertyIndexPtr index = optional->propIndex;
+    PropertyPtr p, *slot;
+    int count = 0;
+
+    /* keep it at most half full */
+    if (index && (index->used + 1) * 2 <= 1 << index->bits) {
+        /* it is the first instance of its name now */
+        slot = PropertyIndexSlot(index, pProp->propertyName);
+        if (!*slot)
+            index->used++;
+        *slot = pProp;
+        return;
+    }
+
+    if (!index) {
+        for (p = optional->userProps; p && count < PROPERTY_INDEX_MIN;
+             p = p->next)
+            count++;
+        if (count < PROPERTY_INDEX_MIN)
+            return;
+    }
+    free(index);
+    optional->propIndex = PropertyIndexBuild(optional->userProps);
+}
+
+/* Called with pProp just taken off the list; its next is still good */
+static void
+PropertyIndexRemove(PropertyIndexPtr index, PropertyPtr pProp)
+{
+    unsigned mask = (1u << index->bits) - 1;
+    PropertyPtr *slot = PropertyIndexSlot(index, pProp->propertyName);
+    PropertyPtr p;
+    unsigned i, j, home;
+
+    if (*slot != pProp)
+        return;
+
+    /* the next instance of the name, if any, is the first one now */
+    for (p = pProp->next; p; p = p->next)
+        if (p->propertyName == pProp->propertyName) {
+            *slot = p;
+            return;
+        }
+
+    /* pull back entries further along that could no longer be found */
+    i = slot - index->slots;
+    for (j = (i + 1) & mask; index->slots[j]; j = (j + 1) & mask) {
+        home = PropertyHash(index->slots[j]->propertyName, index->bits);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            index->slots[i] = index->slots[j];
+            i = j;
+        }
+    }
+    index->slots[i] = NULL;
+    index->used--;
+}
+
+/* The first property on the list with the name */
+static PropertyPtr
+FindProperty(WindowPtr pWin, Atom propertyName)
+{
+    PropertyIndexPtr index = pWin->optional ? pWin->optional->propIndex : NULL;
+    PropertyPtr pProp;
+
+    if (index)
+        return *PropertyIndexSlot(index, propertyName);
+
+    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
+        if (pProp->propertyName == propertyName)
+            break;
+    return pProp;
+}
+
+/* Take pProp off the window; the caller frees it */
+static void
+RemoveProperty(WindowPtr pWin, PropertyPtr pProp)
+{
+    WindowOptPtr optional = pWin->optional;
+    PropertyPtr *prev;
+
+    for (prev = &optional->userProps; *prev != pProp; prev = &(*prev)->next)
+        ;
+    *prev = pProp->next;
+
+    if (optional->propIndex)
+        PropertyIndexRemove(optional->propIndex, pProp);
+
+    if (!optional->userProps) {
+        free(optional->propIndex);
+        optional->propIndex = NULL;
+        CheckWindowOptionalNeed(pWin);
+    }
+}
+
 #ifdef notdef
 static void
 PrintPropertys(WindowPtr pWin)
@@ -95,10 +259,7 @@ dixLookupProperty(PropertyPtr *result, WindowPtr pWin, Atom propertyName,
 
     client->errorValue = propertyName;
 
-    for (pProp = wUserProps(pWin); pProp; pProp = pProp->next)
-        if (pProp->propertyName == propertyName)
-            break;
-
+    pProp = FindProperty(pWin, propertyName);
     if (pProp)
         rc = XaceHookPropertyAccess(client, pWin, &pProp, access_mode);
     *result = pProp;
@@ -191,6 +352,7 @@ ProcRotateProperties(ClientPtr client)
             props[j]->format = saved[i].format;
             props[j]->size = saved[i].size;
             props[j]->data = saved[i].data;
+            props[j]->allocated = saved[i].allocated;
         }
     }
  out:
@@ -285,6 +447,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
         pProp->format = format;
         pProp->data = data;
         pProp->size = len;
+        pProp->allocated = totalSize;
         rc = XaceHookPropertyAccess(pClient, pWin, &pProp,
                                     DixCreateAccess | DixWriteAccess);
         if (rc != Success) {
@@ -295,6 +458,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
         }
         pProp->next = pWin->optional->userProps;
         pWin->optional->userProps = pProp;
+        PropertyIndexAdd(pWin, pProp);
     }
     else if (rc == Success) {
         /* To append or prepend to a property the request format and type
@@ -317,6 +481,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             memcpy(data, value, totalSize);
             pProp->data = data;
             pProp->size = len;
+            pProp->allocated = totalSize;
             pProp->type = type;
             pProp->format = format;
         }
@@ -324,12 +489,31 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             /* do nothing */
         }
         else if (mode == PropModeAppend) {
-            data = xallocarray(pProp->size + len, sizeInBytes);
-            if (!data)
-                return BadAlloc;
-            memcpy(data, pProp->data, pProp->size * sizeInBytes);
-            memcpy(data + pProp->size * sizeInBytes, value, totalSize);
-            pProp->data = data;
+            uint64_t used = (uint64_t) pProp->size * sizeInBytes;
+            uint64_t want = used + totalSize;
+
+            /*
+             * Appending only writes past the end of what's there, so it
+             * can go straight into room left over from the last append;
+             * the old contents stay as they were if the append is refused
+             * below.  Otherwise allocate half as much again as needed, so
+             * a property built up by appends isn't copied every time.
+             */
+            if (want <= pProp->allocated) {
+                memcpy((char *) pProp->data + used, value, totalSize);
+            }
+            else {
+                if (want > UINT32_MAX)
+                    return BadAlloc;
+                want = min(want + want / 2, UINT32_MAX);
+                data = malloc(want);
+                if (!data)
+                    return BadAlloc;
+                memcpy(data, pProp->data, used);
+                memcpy(data + used, value, totalSize);
+                pProp->data = data;
+                pProp->allocated = want;
+            }
             pProp->size += len;
         }
         else if (mode == PropModePrepend) {
@@ -340,6 +524,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
             memcpy(data, value, totalSize);
             pProp->data = data;
             pProp->size += len;
+            pProp->allocated = pProp->size * sizeInBytes;
         }
 
         /* Allow security modules to check the new content */
@@ -368,7 +553,7 @@ dixChangeWindowProperty(ClientPtr pClient, WindowPtr pWin, Atom property,
 int
 DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     int rc;
 
     rc = dixLookupProperty(&pProp, pWin, propName, client, DixDestroyAccess);
@@ -376,19 +561,7 @@ DeleteProperty(ClientPtr client, WindowPtr pWin, Atom propName)
         return Success;         /* Succeed if property does not exist */
 
     if (rc == Success) {
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
-
+        RemoveProperty(pWin, pProp);
         deliverPropertyNotifyEvent(pWin, PropertyDelete, pProp);
         free(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
@@ -410,8 +583,11 @@ DeleteAllWindowProperties(WindowPtr pWin)
         pProp = pNextProp;
     }
 
-    if (pWin->optional)
+    if (pWin->optional) {
         pWin->optional->userProps = NULL;
+        free(pWin->optional->propIndex);
+        pWin->optional->propIndex = NULL;
+    }
 }
 
 static int
@@ -443,7 +619,7 @@ NullPropertyReply(ClientPtr client, ATOM propertyType, int format)
 int
 ProcGetProperty(ClientPtr client)
 {
-    PropertyPtr pProp, prevProp;
+    PropertyPtr pProp;
     unsigned long n, len, ind;
     int rc;
     WindowPtr pWin;
@@ -546,19 +722,7 @@ ProcGetProperty(ClientPtr client)
 
     if (stuff->delete && (reply.bytesAfter == 0)) {
         /* Delete the Property */
-        if (pWin->optional->userProps == pProp) {
-            /* Takes care of head */
-            if (!(pWin->optional->userProps = pProp->next))
-                CheckWindowOptionalNeed(pWin);
-        }
-        else {
-            /* Need to traverse to find the previous element */
-            prevProp = pWin->optional->userProps;
-            while (prevProp->next != pProp)
-                prevProp = prevProp->next;
-            prevProp->next = pProp->next;
-        }
-
+        RemoveProperty(pWin, pProp);
         free(pProp->data);
         dixFreeObjectWithPrivates(pProp, PRIVATE_PROPERTY);
     }
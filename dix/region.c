@@ -85,6 +85,17 @@ Equipment Corporation.
 #include "gc.h"
 #include <pixman.h>
 
+#ifdef REGION_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define REGION_SIMD_AVX2
+#define REGION_SIMD_SSE2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define REGION_SIMD_SSE2
+#endif
+#endif
+
 #undef assert
 #ifdef REGION_DEBUG
 #define assert(expr) { \
@@ -214,6 +225,237 @@ if (((numRects) < ((reg)->data->size >> 1)) && ((reg)->data->size > 50)) \
     }									 \
 }
 
+/*======================================================================
+ *	    Band kernels
+ *====================================================================*/
+
+/*
+ * The inner loops of RegionOp and its helpers only ever look at the
+ * boxes of one band at a time: find where a band ends, compare the x
+ * extents of two bands, and stamp new y1/y2 values onto a run of
+ * boxes.  A BoxRec is four 16-bit words, so two (SSE2) or four (AVX2)
+ * boxes fit in a vector register and these can be done without
+ * branching per box.  The scalar versions are always available and are
+ * used when the SIMD kernels were not built in or have been turned off
+ * with regionUseSimd.
+ */
+
+#ifdef REGION_SIMD_SSE2
+Bool regionUseSimd = TRUE;
+#else
+Bool regionUseSimd = FALSE;
+#endif
+
+#ifdef REGION_SIMD_SSE2
+
+/* Word lanes of a BoxRec pair: x1 y1 x2 y2 x1 y1 x2 y2 */
+#define BOX_X_MASK_SSE2()	_mm_set_epi16(0, -1, 0, -1, 0, -1, 0, -1)
+#define BOX_Y2_MASK_SSE2()	_mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0)
+#define BOX_Y_SSE2(y1, y2)	_mm_set_epi16(y2, 0, y1, 0, y2, 0, y1, 0)
+
+static BoxPtr
+RegionFindBandEndSSE2(BoxPtr r, BoxPtr rEnd, short y1)
+{
+    __m128i vy1 = _mm_set1_epi16(y1);
+    int mask;
+
+#ifdef REGION_SIMD_AVX2
+    {
+        __m256i wy1 = _mm256_set1_epi16(y1);
+
+        while (rEnd - r >= 4) {
+            mask = _mm256_movemask_epi8(_mm256_cmpeq_epi16(wy1,
+                    _mm256_loadu_si256((__m256i *) r)));
+            /* y1 of box n lives in bytes 8n + 2 and 8n + 3 */
+            mask &= 0x04040404;
+            if (mask != 0x04040404)
+                return r + (__builtin_ctz(~mask & 0x04040404) >> 3);
+            r += 4;
+        }
+    }
+#endif
+    while (rEnd - r >= 2) {
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi16(vy1,
+                                 _mm_loadu_si128((__m128i *) r)));
+        if (!(mask & 0x0004))
+            return r;
+        if (!(mask & 0x0400))
+            return r + 1;
+        r += 2;
+    }
+    if (r != rEnd && r->y1 == y1)
+        r++;
+    return r;
+}
+
+static Bool
+RegionBandsMatchSSE2(BoxPtr a, BoxPtr b, int n)
+{
+    __m128i xmask = BOX_X_MASK_SSE2();
+    __m128i diff = _mm_setzero_si128();
+
+    for (; n >= 2; n -= 2, a += 2, b += 2)
+        diff = _mm_or_si128(diff,
+                            _mm_xor_si128(_mm_loadu_si128((__m128i *) a),
+                                          _mm_loadu_si128((__m128i *) b)));
+    diff = _mm_and_si128(diff, xmask);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xffff)
+        return FALSE;
+    return !n || (a->x1 == b->x1 && a->x2 == b->x2);
+}
+
+static void
+RegionBandSetY2SSE2(BoxPtr r, int n, short y2)
+{
+    __m128i ymask = BOX_Y2_MASK_SSE2();
+    __m128i vy2 = _mm_and_si128(_mm_set1_epi16(y2), ymask);
+    __m128i v;
+
+    for (; n >= 2; n -= 2, r += 2) {
+        v = _mm_loadu_si128((__m128i *) r);
+        v = _mm_or_si128(_mm_andnot_si128(ymask, v), vy2);
+        _mm_storeu_si128((__m128i *) r, v);
+    }
+    if (n)
+        r->y2 = y2;
+}
+
+static void
+RegionCopyBandSSE2(BoxPtr dst, BoxPtr r, int n, short y1, short y2)
+{
+    __m128i xmask = BOX_X_MASK_SSE2();
+    __m128i vy = BOX_Y_SSE2(y1, y2);
+    __m128i v;
+
+    for (; n >= 2; n -= 2, r += 2, dst += 2) {
+        v = _mm_and_si128(_mm_loadu_si128((__m128i *) r), xmask);
+        _mm_storeu_si128((__m128i *) dst, _mm_or_si128(v, vy));
+    }
+    if (n) {
+        dst->x1 = r->x1;
+        dst->y1 = y1;
+        dst->x2 = r->x2;
+        dst->y2 = y2;
+    }
+}
+
+static void
+RegionBoxesExtentsXSSE2(BoxPtr r, int n, short *px1, short *px2)
+{
+    __m128i vmin = _mm_set1_epi16(*px1);
+    __m128i vmax = _mm_set1_epi16(*px2);
+    __m128i v;
+    short lanes[8];
+    short x1, x2;
+
+    for (; n >= 2; n -= 2, r += 2) {
+        v = _mm_loadu_si128((__m128i *) r);
+        vmin = _mm_min_epi16(vmin, v);
+        vmax = _mm_max_epi16(vmax, v);
+    }
+    _mm_storeu_si128((__m128i *) lanes, vmin);
+    x1 = min(lanes[0], lanes[4]);
+    _mm_storeu_si128((__m128i *) lanes, vmax);
+    x2 = max(lanes[2], lanes[6]);
+    if (n) {
+        x1 = min(x1, r->x1);
+        x2 = max(x2, r->x2);
+    }
+    /* the y lanes above hold garbage; only keep the x1/x2 results */
+    *px1 = min(*px1, x1);
+    *px2 = max(*px2, x2);
+}
+
+#endif                          /* REGION_SIMD_SSE2 */
+
+/* Return the first box after r whose y1 differs from r->y1 */
+static inline BoxPtr
+RegionFindBandEnd(BoxPtr r, BoxPtr rEnd)
+{
+    short y1 = r->y1;
+
+    r++;
+    /* Most bands are short; only go wide once the band keeps going. */
+    if (r == rEnd || r->y1 != y1)
+        return r;
+#ifdef REGION_SIMD_SSE2
+    if (regionUseSimd)
+        return RegionFindBandEndSSE2(r + 1, rEnd, y1);
+#endif
+    do {
+        r++;
+    } while (r != rEnd && r->y1 == y1);
+    return r;
+}
+
+/* TRUE iff the n boxes at a and b have identical x1/x2 */
+static inline Bool
+RegionBandsMatch(BoxPtr a, BoxPtr b, int n)
+{
+#ifdef REGION_SIMD_SSE2
+    if (regionUseSimd && n >= 2)
+        return RegionBandsMatchSSE2(a, b, n);
+#endif
+    do {
+        if ((a->x1 != b->x1) || (a->x2 != b->x2))
+            return FALSE;
+        a++;
+        b++;
+    } while (--n);
+    return TRUE;
+}
+
+static inline void
+RegionBandSetY2(BoxPtr r, int n, short y2)
+{
+#ifdef REGION_SIMD_SSE2
+    if (regionUseSimd && n >= 2) {
+        RegionBandSetY2SSE2(r, n, y2);
+        return;
+    }
+#endif
+    do {
+        r->y2 = y2;
+        r++;
+    } while (--n);
+}
+
+/* Copy the x extents of n boxes from r to dst, giving them new y1/y2 */
+static inline void
+RegionCopyBand(BoxPtr dst, BoxPtr r, int n, short y1, short y2)
+{
+#ifdef REGION_SIMD_SSE2
+    if (regionUseSimd && n >= 2) {
+        RegionCopyBandSSE2(dst, r, n, y1, y2);
+        return;
+    }
+#endif
+    do {
+        assert(r->x1 < r->x2);
+        ADDRECT(dst, r->x1, y1, r->x2, y2);
+        r++;
+    } while (--n);
+}
+
+/* Widen [*px1, *px2) to cover the x extents of n boxes */
+static inline void
+RegionBoxesExtentsX(BoxPtr r, int n, short *px1, short *px2)
+{
+#ifdef REGION_SIMD_SSE2
+    if (regionUseSimd && n >= 2) {
+        RegionBoxesExtentsXSSE2(r, n, px1, px2);
+        return;
+    }
+#endif
+    while (n--) {
+        if (r->x1 < *px1)
+            *px1 = r->x1;
+        if (r->x2 > *px2)
+            *px2 = r->x2;
+        r++;
+    }
+}
+
 BoxRec RegionEmptyBox = { 0, 0, 0, 0 };
 RegDataRec RegionEmptyData = { 0, 0 };
 
@@ -438,26 +680,15 @@ RegionCoalesce(RegionPtr pReg,  /* Region to coalesce                */
      */
     y2 = pCurBox->y2;
 
-    do {
-        if ((pPrevBox->x1 != pCurBox->x1) || (pPrevBox->x2 != pCurBox->x2)) {
-            return curStart;
-        }
-        pPrevBox++;
-        pCurBox++;
-        numRects--;
-    } while (numRects);
+    if (!RegionBandsMatch(pPrevBox, pCurBox, numRects))
+        return curStart;
 
     /*
      * The bands may be merged, so set the bottom y of each box
      * in the previous band to the bottom y of the current band.
      */
-    numRects = curStart - prevStart;
     pReg->data->numRects -= numRects;
-    do {
-        pPrevBox--;
-        pPrevBox->y2 = y2;
-        numRects--;
-    } while (numRects);
+    RegionBandSetY2(pPrevBox, numRects, y2);
     return prevStart;
 }
 
@@ -502,11 +733,7 @@ RegionAppendNonO(RegionPtr pReg, BoxPtr r, BoxPtr rEnd, int y1, int y2)
     RECTALLOC(pReg, newRects);
     pNextRect = RegionTop(pReg);
     pReg->data->numRects += newRects;
-    do {
-        assert(r->x1 < r->x2);
-        ADDRECT(pNextRect, r->x1, y1, r->x2, y2);
-        r++;
-    } while (r != rEnd);
+    RegionCopyBand(pNextRect, r, newRects, y1, y2);
 
     return TRUE;
 }
@@ -514,10 +741,7 @@ RegionAppendNonO(RegionPtr pReg, BoxPtr r, BoxPtr rEnd, int y1, int y2)
 #define FindBand(r, rBandEnd, rEnd, ry1)		    \
 {							    \
     ry1 = r->y1;					    \
-    rBandEnd = r+1;					    \
-    while ((rBandEnd != rEnd) && (rBandEnd->y1 == ry1)) {   \
-	rBandEnd++;					    \
-    }							    \
+    rBandEnd = RegionFindBandEnd(r, rEnd);		    \
 }
 
 #define	AppendRegions(newReg, r, rEnd)					\
@@ -830,13 +1054,8 @@ RegionSetExtents(RegionPtr pReg)
     pReg->extents.y2 = pBoxEnd->y2;
 
     assert(pReg->extents.y1 < pReg->extents.y2);
-    while (pBox <= pBoxEnd) {
-        if (pBox->x1 < pReg->extents.x1)
-            pReg->extents.x1 = pBox->x1;
-        if (pBox->x2 > pReg->extents.x2)
-            pReg->extents.x2 = pBox->x2;
-        pBox++;
-    };
+    RegionBoxesExtentsX(pBox, pBoxEnd - pBox + 1,
+                        &pReg->extents.x1, &pReg->extents.x2);
 
     assert(pReg->extents.x1 < pReg->extents.x2);
 }
@@ -0,0 +1,364 @@
+/*
+ * Copyright © 2026 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Request statistics
+ *
+ * When enabled, Dispatch times every request and counts it against its
+ * opcode and against the client that sent it: how many, how many bytes,
+ * the total and longest time, and a histogram of times in power-of-two
+ * buckets.  Requests run on the main thread without blocking, so the
+ * time spent in the handler is the CPU time the request cost.
+ *
+ * Statistics are collected from startup with -reqstats.  SIGUSR2 turns
+ * collection on if it was off; otherwise it logs what was collected since
+ * the last time and starts over.  The signal handler only sets a flag;
+ * Dispatch does the logging between requests.  Some DDXes use SIGUSR2
+ * for themselves, the Solaris VT code for one, so the handler is only
+ * installed after InitOutput and only if nothing else has taken the
+ * signal.  Whatever was collected is logged at each server reset too.
+ *
+ * Everything here is touched only from the main thread, so the counters
+ * need no locking.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <X11/X.h>
+#include <X11/Xproto.h>
+#include "misc.h"
+#include "os.h"
+#include "opaque.h"
+#include "dixstruct.h"
+#include "extnsionst.h"
+#include "registry.h"
+#include "client.h"
+#include "mi.h"
+
+#define REQ_STATS_BUCKETS       20      /* < 1us, < 2us, ... >= 262ms */
+#define REQ_STATS_TOP           20      /* opcodes and clients to log */
+
+typedef struct _ReqStats {
+    uint64_t count;
+    uint64_t bytes;
+    uint64_t time;              /* ns */
+    uint64_t max;               /* ns */
+    uint32_t hist[REQ_STATS_BUCKETS];
+} ReqStatsRec, *ReqStatsPtr;
+
+Bool RequestStatsEnabled;
+volatile Bool RequestStatsPending;
+
+static ReqStatsRec coreStats[EXTENSION_BASE];
+static ReqStatsPtr extStats[256 - EXTENSION_BASE];     /* 256 minors each */
+static ReqStatsPtr clientStats;                         /* LimitClients */
+
+/* to tell how many allocations ScratchAlloc saved */
+static uint64_t requestCount;
+static unsigned long scratchAllocStart, scratchMallocStart;
+
+uint64_t
+RequestStatsTime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+RequestStatsReset(void)
+{
+    int i;
+
+    memset(coreStats, 0, sizeof(coreStats));
+    for (i = 0; i < ARRAY_SIZE(extStats); i++)
+        if (extStats[i])
+            memset(extStats[i], 0, 256 * sizeof(ReqStatsRec));
+    if (clientStats)
+        memset(clientStats, 0, LimitClients * sizeof(ReqStatsRec));
+
+    requestCount = 0;
+    scratchAllocStart = ScratchAllocCount;
+    scratchMallocStart = ScratchMallocCount;
+}
+
+static void
+RequestStatsAdd(ReqStatsPtr stats, uint64_t ns, CARD32 bytes)
+{
+    uint64_t us = ns / 1000;
+    int bucket = us ? 64 - __builtin_clzll(us) : 0;
+
+    if (bucket >= REQ_STATS_BUCKETS)
+        bucket = REQ_STATS_BUCKETS - 1;
+
+    stats->count++;
+    stats->bytes += bytes;
+    stats->time += ns;
+    if (ns > stats->max)
+        stats->max = ns;
+    stats->hist[bucket]++;
+}
+
+/**
+ * Count a request that started at start, as returned by RequestStatsTime,
+ * and has just been run.
+ */
+void
+RequestStatsDone(ClientPtr client, uint64_t start)
+{
+    uint64_t ns = RequestStatsTime() - start;
+    CARD32 bytes = client->req_len << 2;
+    ReqStatsPtr *ext;
+
+    requestCount++;
+    if (client->majorOp < EXTENSION_BASE)
+        RequestStatsAdd(&coreStats[client->majorOp], ns, bytes);
+    else {
+        ext = &extStats[client->majorOp - EXTENSION_BASE];
+        if (!*ext)
+            *ext = calloc(256, sizeof(ReqStatsRec));
+        if (*ext)
+            RequestStatsAdd(&(*ext)[client->minorOp], ns, bytes);
+    }
+
+    if (!clientStats)
+        clientStats = calloc(LimitClients, sizeof(ReqStatsRec));
+    if (clientStats) {
+        /* a new client in this slot */
+        if (client->sequence == 1)
+            memset(&clientStats[client->index], 0, sizeof(ReqStatsRec));
+        RequestStatsAdd(&clientStats[client->index], ns, bytes);
+    }
+}
+
+/* Upper bound of the bucket holding the given fraction of requests */
+static uint64_t
+RequestStatsPercentile(ReqStatsPtr stats, int percent)
+{
+    uint64_t want = (stats->count * percent + 99) / 100, seen = 0;
+    int i;
+
+    for (i = 0; i < REQ_STATS_BUCKETS - 1; i++) {
+        seen += stats->hist[i];
+        if (seen >= want)
+            return (uint64_t) 1 << i;
+    }
+    return stats->max / 1000;
+}
+
+static void
+RequestStatsLogOne(const char *what, ReqStatsPtr stats)
+{
+    LogMessageVerb(X_NONE, 0,
+                   "    %-36s %10llu %12llu %10.1f %8.1f %8llu %8llu %8.1f\n",
+                   what, (unsigned long long) stats->count,
+                   (unsigned long long) stats->bytes, stats->time / 1e6,
+                   stats->time / 1e3 / stats->count,
+                   (unsigned long long) RequestStatsPercentile(stats, 50),
+                   (unsigned long long) RequestStatsPercentile(stats, 99),
+                   stats->max / 1e3);
+}
+
+static void
+RequestStatsLogHeader(const char *what)
+{
+    LogMessageVerb(X_INFO, 0, "Request statistics, by %s:\n", what);
+    LogMessageVerb(X_NONE, 0,
+                   "    %-36s %10s %12s %10s %8s %8s %8s %8s\n",
+                   what, "count", "bytes", "total ms", "mean us",
+                   "p50 us<", "p99 us<", "max us");
+}
+
+static int
+RequestStatsCompare(const void *a, const void *b)
+{
+    ReqStatsPtr sa = *(ReqStatsPtr const *) a;
+    ReqStatsPtr sb = *(ReqStatsPtr const *) b;
+
+    return sa->time < sb->time ? 1 : sa->time > sb->time ? -1 : 0;
+}
+
+/* Pick the entries with the most time, most first */
+static int
+RequestStatsTop(ReqStatsPtr stats, int n, ReqStatsPtr *top)
+{
+    int i, ntop = 0;
+
+    for (i = 0; i < n; i++) {
+        if (!stats[i].count)
+            continue;
+        if (ntop < REQ_STATS_TOP)
+            top[ntop++] = &stats[i];
+        else if (stats[i].time > top[ntop - 1]->time)
+            top[ntop - 1] = &stats[i];
+        else
+            continue;
+        qsort(top, ntop, sizeof(ReqStatsPtr), RequestStatsCompare);
+    }
+    return ntop;
+}
+
+static void
+RequestStatsLog(void)
+{
+    ReqStatsPtr top[REQ_STATS_TOP], extTop[REQ_STATS_TOP];
+    ReqStatsPtr all[REQ_STATS_TOP * 2];
+    char name[64];
+    int i, j, ntop, nall;
+
+    RequestStatsLogHeader("request");
+
+    /* the top core requests, merged with the top of each extension */
+    nall = RequestStatsTop(coreStats, EXTENSION_BASE, all);
+    for (i = 0; i < ARRAY_SIZE(extStats); i++) {
+        if (!extStats[i])
+            continue;
+        ntop = RequestStatsTop(extStats[i], 256, extTop);
+        for (j = 0; j < ntop; j++)
+            all[nall++] = extTop[j];
+        qsort(all, nall, sizeof(ReqStatsPtr), RequestStatsCompare);
+        if (nall > REQ_STATS_TOP)
+            nall = REQ_STATS_TOP;
+    }
+
+    for (i = 0; i < nall; i++) {
+        int major, minor;
+
+        if (all[i] >= coreStats && all[i] < coreStats + EXTENSION_BASE) {
+            major = all[i] - coreStats;
+            minor = 0;
+        }
+        else {
+            for (j = 0; j < ARRAY_SIZE(extStats); j++)
+                if (extStats[j] && all[i] >= extStats[j] &&
+                    all[i] < extStats[j] + 256)
+                    break;
+            major = EXTENSION_BASE + j;
+            minor = all[i] - extStats[j];
+        }
+#ifdef X_REGISTRY_REQUEST
+        snprintf(name, sizeof(name), "%s (%d.%d)",
+                 LookupRequestName(major, minor), major, minor);
+#else
+        snprintf(name, sizeof(name), "%d.%d", major, minor);
+#endif
+        RequestStatsLogOne(name, all[i]);
+    }
+
+    if (requestCount)
+        LogMessageVerb(X_INFO, 0,
+                       "Scratch memory: %.2f allocations and %.4f mallocs "
+                       "per request\n",
+                       (double) (ScratchAllocCount - scratchAllocStart) /
+                       requestCount,
+                       (double) (ScratchMallocCount - scratchMallocStart) /
+                       requestCount);
+    PixmapPoolLogStats();
+    miArcCacheLogStats();
+
+    if (!clientStats)
+        return;
+
+    RequestStatsLogHeader("client");
+    ntop = RequestStatsTop(clientStats, LimitClients, top);
+    for (i = 0; i < ntop; i++) {
+        int index = top[i] - clientStats;
+        ClientPtr client = clients[index];
+        const char *cmd = client ? GetClientCmdName(client) : NULL;
+
+        if (!client)
+            continue;
+        snprintf(name, sizeof(name), "%d: %s (pid %d)", index,
+                 cmd ? cmd : "unknown", GetClientPid(client));
+        RequestStatsLogOne(name, top[i]);
+    }
+}
+
+/**
+ * Called by Dispatch between requests once RequestStatsPending is set.
+ */
+void
+RequestStatsSignaled(void)
+{
+    RequestStatsPending = FALSE;
+
+    if (RequestStatsEnabled)
+        RequestStatsLog();
+    else {
+        LogMessageVerb(X_INFO, 0, "Collecting request statistics\n");
+        RequestStatsEnabled = TRUE;
+    }
+    RequestStatsReset();
+}
+
+/**
+ * Called at server reset: log what was collected in this generation.
+ */
+void
+RequestStatsFini(void)
+{
+    RequestStatsPending = FALSE;
+
+    if (RequestStatsEnabled) {
+        RequestStatsLog();
+        RequestStatsReset();
+    }
+}
+
+#ifdef SIGUSR2
+static void
+RequestStatsSignal(int sig)
+{
+    RequestStatsPending = TRUE;
+}
+#endif
+
+/**
+ * Called after InitOutput, so that a DDX which uses SIGUSR2 keeps it.
+ */
+void
+RequestStatsInit(void)
+{
+#ifdef SIGUSR2
+    struct sigaction act;
+
+    if (sigaction(SIGUSR2, NULL, &act) == 0 &&
+        act.sa_handler != SIG_DFL && act.sa_handler != SIG_IGN &&
+        act.sa_handler != RequestStatsSignal) {
+        if (serverGeneration == 1)
+            LogMessageVerb(X_WARNING, 0,
+                           "SIGUSR2 is in use, request statistics are only "
+                           "logged at server reset\n");
+        return;
+    }
+    OsSignal(SIGUSR2, RequestStatsSignal);
+#endif
+}
@@ -105,8 +105,9 @@ Equipment Corporation.
  *      A resource ID is a 32 bit quantity, the upper 2 bits of which are
  *	off-limits for client-visible resources.  The next 8 bits are
  *      used as client ID, and the low 22 bits come from the client.
- *	A resource ID is "hashed" by extracting and xoring subfields
- *      (varying with the size of the hash table).
+ *	HashResourceID() "hashes" a resource ID for extension hash tables
+ *	by extracting and xoring subfields (varying with the size of the
+ *	table); the client resource tables multiply instead.
  *
  *      It is sometimes necessary for the server to create an ID that looks
  *      like it belongs to a client.  This ID, however,  must not be one
@@ -149,27 +150,48 @@ Equipment Corporation.
 #define TypeNameString(t) LookupResourceName(t)
 #endif
 
-static void RebuildTable(int    /*client */
-    );
-
 #define SERVER_MINID 32
 
 #define INITBUCKETS 64
 #define INITHASHSIZE 6
-#define MAXHASHSIZE 16
+
+/* old slots moved to the new table per AddResource while growing; any
+ * value above two finishes before the new table needs to grow again */
+#define MIGRATE_SLOTS 8
+
+/*
+ * Each client's resources live in a flat open-addressed table.  An empty
+ * slot has type RT_NONE.  Probes start from a multiplicative hash of the
+ * id: ids are handed out in order, and hashing their low bits alone would
+ * put all of a client's resources in one long run.  Each run is kept in
+ * Robin Hood order, sorted by home slot, so a probe can stop as soon as
+ * it reaches entries whose home is further on.  The entries for an id sit
+ * together, newest first as on the old hash chains, so lookups find the
+ * newest match and frees take the newest first.  Removal shifts the rest
+ * of the run back instead of leaving tombstones.
+ *
+ * When a table passes half full it is replaced by one twice the size,
+ * and the old table is drained a few runs at a time by AddResource.
+ * Runs are always moved whole, so every entry for a given id is in
+ * exactly one of the two tables.
+ */
 
 typedef struct _Resource {
-    struct _Resource *next;
     XID id;
     RESTYPE type;
     void *value;
 } ResourceRec, *ResourcePtr;
 
 typedef struct _ClientResource {
-    ResourcePtr *resources;
+    ResourcePtr resources;
     int elements;
-    int buckets;
-    int hashsize;               /* log(2)(buckets) */
+    int hashsize;               /* log(2)(slots in resources) */
+    ResourcePtr oldResources;   /* table being drained, or NULL */
+    int oldElements;
+    int oldHashsize;
+    int migrated;               /* old slots below this are empty */
+    unsigned int generation;    /* bumped whenever entries move */
+    ResourceRec last;           /* last successful lookup */
     XID fakeID;
     XID endFakeID;
 } ClientResourceRec;
@@ -632,7 +654,7 @@ ResourceClientBits(void)
 Bool
 InitClientResources(ClientPtr client)
 {
-    int i, j;
+    int i;
 
     if (client == serverClient) {
         lastResourceType = RT_LASTPREDEF;
@@ -645,12 +667,14 @@ InitClientResources(ClientPtr client)
         memcpy(resourceTypes, predefTypes, sizeof(predefTypes));
     }
     clientTable[i = client->index].resources =
-        malloc(INITBUCKETS * sizeof(ResourcePtr));
+        calloc(INITBUCKETS, sizeof(ResourceRec));
     if (!clientTable[i].resources)
         return FALSE;
-    clientTable[i].buckets = INITBUCKETS;
     clientTable[i].elements = 0;
     clientTable[i].hashsize = INITHASHSIZE;
+    clientTable[i].oldResources = NULL;
+    clientTable[i].oldElements = 0;
+    clientTable[i].last.type = RT_NONE;
     /* Many IDs allocated from the server client are visible to clients,
      * so we don't use the SERVER_BIT for them, but we have to start
      * past the magic value constants used in the protocol.  For normal
@@ -659,9 +683,6 @@ InitClientResources(ClientPtr client)
     clientTable[i].fakeID = client->clientAsMask |
         (client->index ? SERVER_BIT : SERVER_MINID);
     clientTable[i].endFakeID = (clientTable[i].fakeID | RESOURCE_ID_MASK) + 1;
-    for (j = 0; j < INITBUCKETS; j++) {
-        clientTable[i].resources[j] = NULL;
-    }
     return TRUE;
 }
 
@@ -678,18 +699,214 @@ HashResourceID(XID id, int numBits)
     return (id ^ (id >> numBits)) & ~((~0) << numBits);
 }
 
+static inline int
+ResourceHome(XID id, int hashsize)
+{
+    return (uint32_t) (id * 2654435761u) >> (32 - hashsize);
+}
+
+/* How far the entry in slot is past its home slot */
+static inline int
+SlotDistance(ResourcePtr table, int hashsize, int slot)
+{
+    return (slot - ResourceHome(table[slot].id, hashsize)) &
+        ((1 << hashsize) - 1);
+}
+
+static inline Bool
+ResourceMatches(ResourcePtr res, XID id, RESTYPE type, RESTYPE rclass)
+{
+    return res->id == id && (type ? res->type == type : (res->type & rclass));
+}
+
+/*
+ * Return the slot of the newest entry for id in table matching type, or
+ * any type in rclass if type is RT_NONE.
+ */
+static int
+FindSlot(ResourcePtr table, int hashsize, XID id, RESTYPE type,
+         RESTYPE rclass)
+{
+    int mask = (1 << hashsize) - 1;
+    int i, dist;
+
+    for (i = ResourceHome(id, hashsize), dist = 0; table[i].type != RT_NONE;
+         i = (i + 1) & mask, dist++) {
+        if (table[i].id == id) {
+            if (ResourceMatches(&table[i], id, type, rclass))
+                return i;
+        }
+        else if (SlotDistance(table, hashsize, i) < dist)
+            break;
+    }
+    return -1;
+}
+
+/* Whether table still holds res, an entry copied out of it */
+static Bool
+TableHolds(ResourcePtr table, int hashsize, ResourcePtr res)
+{
+    int i;
+
+    i = FindSlot(table, hashsize, res->id, res->type, 0);
+    if (i < 0)
+        return FALSE;
+    /* the same id and type more than once is rare, but allowed */
+    for (; table[i].type != RT_NONE && table[i].id == res->id;
+         i = (i + 1) & ((1 << hashsize) - 1))
+        if (table[i].type == res->type && table[i].value == res->value)
+            return TRUE;
+    return FALSE;
+}
+
+static ResourcePtr
+LookupSlot(ClientResourceRec *rrec, XID id, RESTYPE type, RESTYPE rclass)
+{
+    int i;
+
+    i = FindSlot(rrec->resources, rrec->hashsize, id, type, rclass);
+    if (i >= 0)
+        return &rrec->resources[i];
+    if (rrec->oldResources) {
+        i = FindSlot(rrec->oldResources, rrec->oldHashsize, id, type, rclass);
+        if (i >= 0)
+            return &rrec->oldResources[i];
+    }
+    return NULL;
+}
+
+/*
+ * Put res into table, ahead of the other entries for its id if it is the
+ * newest of them, or else behind them.  The rest of the run moves up.
+ */
+static void
+InsertSlot(ResourcePtr table, int hashsize, ResourcePtr res, Bool newest)
+{
+    int mask = (1 << hashsize) - 1;
+    int i, dist;
+    Bool seen = FALSE;
+    ResourceRec carry = *res, tmp;
+
+    for (i = ResourceHome(res->id, hashsize), dist = 0;
+         table[i].type != RT_NONE; i = (i + 1) & mask, dist++) {
+        if (table[i].id == res->id) {
+            if (newest)
+                break;
+            seen = TRUE;
+        }
+        else if (seen || SlotDistance(table, hashsize, i) < dist)
+            break;
+    }
+    for (; carry.type != RT_NONE; i = (i + 1) & mask) {
+        tmp = table[i];
+        table[i] = carry;
+        carry = tmp;
+    }
+}
+
+/*
+ * Empty a slot of the current table, moving the rest of the run back a
+ * slot up to the first entry that is in its home slot.
+ */
+static void
+RemoveSlot(ClientResourceRec *rrec, int hole)
+{
+    ResourcePtr table = rrec->resources;
+    int mask = (1 << rrec->hashsize) - 1;
+    int i;
+
+    if (table[hole].id == rrec->last.id)
+        rrec->last.type = RT_NONE;
+
+    for (i = (hole + 1) & mask; table[i].type != RT_NONE &&
+         SlotDistance(table, rrec->hashsize, i); i = (i + 1) & mask) {
+        table[hole] = table[i];
+        hole = i;
+    }
+    table[hole].type = RT_NONE;
+    rrec->elements--;
+    rrec->generation++;
+}
+
+/*
+ * Move the whole run of old slots containing slot into the current table.
+ * The run is taken in order, so each id keeps its newest entry first.
+ */
+static void
+MigrateRun(ClientResourceRec *rrec, int slot)
+{
+    ResourcePtr old = rrec->oldResources;
+    int mask = (1 << rrec->oldHashsize) - 1;
+    int i;
+
+    if (old[slot].type == RT_NONE)
+        return;
+    while (old[(slot - 1) & mask].type != RT_NONE)
+        slot = (slot - 1) & mask;
+    for (i = slot; old[i].type != RT_NONE; i = (i + 1) & mask) {
+        InsertSlot(rrec->resources, rrec->hashsize, &old[i], FALSE);
+        old[i].type = RT_NONE;
+        rrec->oldElements--;
+        rrec->elements++;
+    }
+    rrec->generation++;
+
+    if (!rrec->oldElements) {
+        free(rrec->oldResources);
+        rrec->oldResources = NULL;
+    }
+}
+
+static void
+MigrateSlots(ClientResourceRec *rrec, int count)
+{
+    while (rrec->oldResources && count-- > 0)
+        MigrateRun(rrec, rrec->migrated++);
+}
+
+static void
+FinishMigration(ClientResourceRec *rrec)
+{
+    MigrateSlots(rrec, INT_MAX);
+}
+
+/*
+ * Make sure every entry for id is in the current table.
+ */
+static void
+MigrateID(ClientResourceRec *rrec, XID id)
+{
+    if (rrec->oldResources)
+        MigrateRun(rrec, ResourceHome(id, rrec->oldHashsize));
+}
+
+static Bool
+GrowTable(ClientResourceRec *rrec)
+{
+    ResourcePtr resources;
+
+    FinishMigration(rrec);
+    resources = calloc(2 << rrec->hashsize, sizeof(ResourceRec));
+    if (!resources)
+        return FALSE;
+    rrec->oldResources = rrec->resources;
+    rrec->oldElements = rrec->elements;
+    rrec->oldHashsize = rrec->hashsize;
+    rrec->migrated = 0;
+    rrec->resources = resources;
+    rrec->elements = 0;
+    rrec->hashsize++;
+    rrec->generation++;
+    return TRUE;
+}
+
 static XID
 AvailableID(int client, XID id, XID maxid, XID goodid)
 {
-    ResourcePtr res;
-
     if ((goodid >= id) && (goodid <= maxid))
         return goodid;
     for (; id <= maxid; id++) {
-        res = clientTable[client].resources[HashResourceID(id, clientTable[client].hashsize)];
-        while (res && (res->id != id))
-            res = res->next;
-        if (!res)
+        if (!LookupSlot(&clientTable[client], id, RT_NONE, RC_ANY))
             return id;
     }
     return 0;
@@ -699,7 +916,6 @@ void
 GetXIDRange(int client, Bool server, XID *minp, XID *maxp)
 {
     XID id, maxid;
-    ResourcePtr *resp;
     ResourcePtr res;
     int i;
     XID goodid;
@@ -709,18 +925,19 @@ GetXIDRange(int client, Bool server, XID *minp, XID *maxp)
         id |= client ? SERVER_BIT : SERVER_MINID;
     maxid = id | RESOURCE_ID_MASK;
     goodid = 0;
-    for (resp = clientTable[client].resources, i = clientTable[client].buckets;
-         --i >= 0;) {
-        for (res = *resp++; res; res = res->next) {
-            if ((res->id < id) || (res->id > maxid))
-                continue;
-            if (((res->id - id) >= (maxid - res->id)) ?
-                (goodid = AvailableID(client, id, res->id - 1, goodid)) :
-                !(goodid = AvailableID(client, res->id + 1, maxid, goodid)))
-                maxid = res->id - 1;
-            else
-                id = res->id + 1;
-        }
+    FinishMigration(&clientTable[client]);
+    for (res = clientTable[client].resources,
+         i = 1 << clientTable[client].hashsize; --i >= 0; res++) {
+        if (res->type == RT_NONE)
+            continue;
+        if ((res->id < id) || (res->id > maxid))
+            continue;
+        if (((res->id - id) >= (maxid - res->id)) ?
+            (goodid = AvailableID(client, id, res->id - 1, goodid)) :
+            !(goodid = AvailableID(client, res->id + 1, maxid, goodid)))
+            maxid = res->id - 1;
+        else
+            id = res->id + 1;
     }
     if (id > maxid)
         id = maxid = 0;
@@ -798,79 +1015,42 @@ AddResource(XID id, RESTYPE type, void *value)
 {
     int client;
     ClientResourceRec *rrec;
-    ResourcePtr res, *head;
+    ResourceRec res;
 
 #ifdef XSERVER_DTRACE
     XSERVER_RESOURCE_ALLOC(id, type, value, TypeNameString(type));
 #endif
     client = CLIENT_ID(id);
     rrec = &clientTable[client];
-    if (!rrec->buckets) {
+    if (!rrec->resources) {
         ErrorF("[dix] AddResource(%lx, %x, %lx), client=%d \n",
                (unsigned long) id, type, (unsigned long) value, client);
         FatalError("client not in use\n");
     }
-    if ((rrec->elements >= 4 * rrec->buckets) && (rrec->hashsize < MAXHASHSIZE))
-        RebuildTable(client);
-    head = &rrec->resources[HashResourceID(id, clientTable[client].hashsize)];
-    res = malloc(sizeof(ResourceRec));
-    if (!res) {
+    if (rrec->oldResources) {
+        MigrateID(rrec, id);
+        MigrateSlots(rrec, MIGRATE_SLOTS);
+    }
+    /* keep at least one slot free even if the table can't grow */
+    if ((rrec->elements + rrec->oldElements + 1) * 2 > (1 << rrec->hashsize) &&
+        !GrowTable(rrec) &&
+        rrec->elements + rrec->oldElements + 1 >= (1 << rrec->hashsize)) {
         (*resourceTypes[type & TypeMask].deleteFunc) (value, id);
         return FALSE;
     }
-    res->next = *head;
-    res->id = id;
-    res->type = type;
-    res->value = value;
-    *head = res;
+    MigrateID(rrec, id);
+    res.id = id;
+    res.type = type;
+    res.value = value;
+    InsertSlot(rrec->resources, rrec->hashsize, &res, TRUE);
     rrec->elements++;
-    CallResourceStateCallback(ResourceStateAdding, res);
+    rrec->generation++;
+    if (id == rrec->last.id)
+        rrec->last.type = RT_NONE;
+    CallResourceStateCallback(ResourceStateAdding, &res);
     return TRUE;
 }
 
-static void
-RebuildTable(int client)
-{
-    int j;
-    ResourcePtr res, next;
-    ResourcePtr **tails, *resources;
-    ResourcePtr **tptr, *rptr;
-
-    /*
-     * For now, preserve insertion order, since some ddx layers depend
-     * on resources being free in the opposite order they are added.
-     */
-
-    j = 2 * clientTable[client].buckets;
-    tails =  xallocarray(j, sizeof(ResourcePtr *));
-    if (!tails)
-        return;
-    resources =  xallocarray(j, sizeof(ResourcePtr));
-    if (!resources) {
-        free(tails);
-        return;
-    }
-    for (rptr = resources, tptr = tails; --j >= 0; rptr++, tptr++) {
-        *rptr = NULL;
-        *tptr = rptr;
-    }
-    clientTable[client].hashsize++;
-    for (j = clientTable[client].buckets,
-         rptr = clientTable[client].resources; --j >= 0; rptr++) {
-        for (res = *rptr; res; res = next) {
-            next = res->next;
-            res->next = NULL;
-            tptr = &tails[HashResourceID(res->id, clientTable[client].hashsize)];
-            **tptr = res;
-            *tptr = &res->next;
-        }
-    }
-    free(tails);
-    clientTable[client].buckets *= 2;
-    free(clientTable[client].resources);
-    clientTable[client].resources = resources;
-}
-
 static void
 doFreeResource(ResourcePtr res, Bool skip)
 {
@@ -878,42 +1058,38 @@ doFreeResource(ResourcePtr res, Bool skip)
 
     if (!skip)
         resourceTypes[res->type & TypeMask].deleteFunc(res->value, res->id);
-
-    free(res);
 }
 
-void
-FreeResource(XID id, RESTYPE skipDeleteFuncType)
+/*
+ * Take the entry at slot out of the current table and free it.  The delete
+ * function may add or free other resources, so work on a copy.
+ */
+static void
+FreeSlot(ClientResourceRec *rrec, int slot, RESTYPE skipDeleteFuncType)
 {
-    int cid;
-    ResourcePtr res;
-    ResourcePtr *prev, *head;
-    int *eltptr;
-    int elements;
-
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-        eltptr = &clientTable[cid].elements;
-
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id) {
-                RESTYPE rtype = res->type;
+    ResourceRec res = rrec->resources[slot];
 
 #ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(res->id, res->type,
-                                      res->value, TypeNameString(res->type));
+    XSERVER_RESOURCE_FREE(res.id, res.type, res.value, TypeNameString(res.type));
 #endif
-                *prev = res->next;
-                elements = --*eltptr;
+    RemoveSlot(rrec, slot);
+    doFreeResource(&res, res.type == skipDeleteFuncType);
+}
 
-                doFreeResource(res, rtype == skipDeleteFuncType);
+void
+FreeResource(XID id, RESTYPE skipDeleteFuncType)
+{
+    int cid, i;
+    ClientResourceRec *rrec;
 
-                if (*eltptr != elements)
-                    prev = head;        /* prev may no longer be valid */
-            }
-            else
-                prev = &res->next;
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].resources) {
+        rrec = &clientTable[cid];
+        for (;;) {
+            MigrateID(rrec, id);
+            i = FindSlot(rrec->resources, rrec->hashsize, id, RT_NONE, RC_ANY);
+            if (i < 0)
+                break;
+            FreeSlot(rrec, i, skipDeleteFuncType);
         }
     }
 }
@@ -921,30 +1097,15 @@ FreeResource(XID id, RESTYPE skipDeleteFuncType)
 void
 FreeResourceByType(XID id, RESTYPE type, Bool skipFree)
 {
-    int cid;
-    ResourcePtr res;
-    ResourcePtr *prev, *head;
-
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        head = &clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        prev = head;
-        while ((res = *prev)) {
-            if (res->id == id && res->type == type) {
-#ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(res->id, res->type,
-                                      res->value, TypeNameString(res->type));
-#endif
-                *prev = res->next;
-                clientTable[cid].elements--;
-
-                doFreeResource(res, skipFree);
+    int cid, i;
+    ClientResourceRec *rrec;
 
-                break;
-            }
-            else
-                prev = &res->next;
-        }
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].resources) {
+        rrec = &clientTable[cid];
+        MigrateID(rrec, id);
+        i = FindSlot(rrec->resources, rrec->hashsize, id, type, 0);
+        if (i >= 0)
+            FreeSlot(rrec, i, skipFree ? type : RT_NONE);
     }
 }
 
@@ -960,49 +1121,110 @@ ChangeResourceValue(XID id, RESTYPE rtype, void *value)
     int cid;
     ResourcePtr res;
 
-    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if ((res->id == id) && (res->type == rtype)) {
-                res->value = value;
-                return TRUE;
-            }
+    if (((cid = CLIENT_ID(id)) < LimitClients) && clientTable[cid].resources) {
+        res = LookupSlot(&clientTable[cid], id, rtype, 0);
+        if (res) {
+            res->value = value;
+            if (id == clientTable[cid].last.id)
+                clientTable[cid].last.type = RT_NONE;
+            return TRUE;
+        }
     }
     return FALSE;
 }
 
-/* Note: if func adds or deletes resources, then func can get called
- * more than once for some resources.  If func adds new resources,
- * func might or might not get called for them.  func cannot both
- * add and delete an equal number of resources!
- */
+/* entries a walk can copy without allocating */
+#define WALK_STACK_ENTRIES 64
 
-void
-FindClientResourcesByType(ClientPtr client,
-                          RESTYPE type, FindResType func, void *cdata)
+/*
+ * Call visit on each of the client's entries of type, or of any type if
+ * type is RT_NONE, until it returns TRUE, and return that entry in found.
+ *
+ * The callbacks may add and free resources, which moves entries about the
+ * table, so the walk goes over a copy of the entries taken at the start:
+ * each entry is visited once, if it is still there when its turn comes.
+ * Entries added during the walk are not visited.
+ */
+static Bool
+WalkClientResources(ClientPtr client, RESTYPE type,
+                    Bool (*visit) (ResourcePtr res, void *closure),
+                    void *closure, ResourcePtr found)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    ResourceRec stack[WALK_STACK_ENTRIES];
+    ClientResourceRec *rrec;
+    ResourcePtr entries, res;
+    int i, n;
+    Bool done = FALSE;
 
     if (!client)
         client = serverClient;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                elements = *eltptr;
-                (*func) (this->value, this->id, cdata);
-                if (*eltptr != elements)
-                    next = resources[i];        /* start over */
+    rrec = &clientTable[client->index];
+    FinishMigration(rrec);
+
+    entries = stack;
+    if (rrec->elements > WALK_STACK_ENTRIES) {
+        entries = xallocarray(rrec->elements, sizeof(ResourceRec));
+        if (!entries) {
+            /* go without: entries that callbacks move may be missed */
+            for (i = 0; i < (1 << rrec->hashsize); i++) {
+                ResourceRec this = rrec->resources[i];
+
+                if (this.type != RT_NONE && (!type || this.type == type) &&
+                    (*visit) (&this, closure)) {
+                    *found = this;
+                    return TRUE;
+                }
+                FinishMigration(rrec);
             }
+            return FALSE;
         }
     }
+    for (i = n = 0; i < (1 << rrec->hashsize); i++) {
+        res = &rrec->resources[i];
+        if (res->type != RT_NONE && (!type || res->type == type))
+            entries[n++] = *res;
+    }
+
+    for (i = 0; i < n && !done; i++) {
+        res = &entries[i];
+        if (!TableHolds(rrec->resources, rrec->hashsize, res) &&
+            !(rrec->oldResources &&
+              TableHolds(rrec->oldResources, rrec->oldHashsize, res)))
+            continue;
+        if ((*visit) (res, closure)) {
+            *found = *res;
+            done = TRUE;
+        }
+    }
+
+    if (entries != stack)
+        free(entries);
+    return done;
+}
+
+typedef struct {
+    FindResType func;
+    void *cdata;
+} FindByTypeRec;
+
+static Bool
+FindByTypeVisit(ResourcePtr res, void *closure)
+{
+    FindByTypeRec *find = closure;
+
+    (*find->func) (res->value, res->id, find->cdata);
+    return FALSE;
+}
+
+void
+FindClientResourcesByType(ClientPtr client,
+                          RESTYPE type, FindResType func, void *cdata)
+{
+    FindByTypeRec find = { func, cdata };
+    ResourceRec found;
+
+    WalkClientResources(client, type, FindByTypeVisit, &find, &found);
 }
 
 void FindSubResources(void *resource,
@@ -1014,28 +1236,41 @@ void FindSubResources(void *resource,
     rtype.findSubResFunc(resource, func, cdata);
 }
 
+typedef struct {
+    FindAllRes func;
+    void *cdata;
+} FindAllRec;
+
+static Bool
+FindAllVisit(ResourcePtr res, void *closure)
+{
+    FindAllRec *find = closure;
+
+    (*find->func) (res->value, res->id, res->type, find->cdata);
+    return FALSE;
+}
+
 void
 FindAllClientResources(ClientPtr client, FindAllRes func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    int i, elements;
-    int *eltptr;
+    FindAllRec find = { func, cdata };
+    ResourceRec found;
 
-    if (!client)
-        client = serverClient;
+    WalkClientResources(client, RT_NONE, FindAllVisit, &find, &found);
+}
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            elements = *eltptr;
-            (*func) (this->value, this->id, this->type, cdata);
-            if (*eltptr != elements)
-                next = resources[i];    /* start over */
-        }
-    }
+typedef struct {
+    FindComplexResType func;
+    void *cdata;
+} LookupComplexRec;
+
+static Bool
+LookupComplexVisit(ResourcePtr res, void *closure)
+{
+    LookupComplexRec *lookup = closure;
+
+    /* the entry is a copy, so func may free the resource, as DRI1 does */
+    return (*lookup->func) (res->value, res->id, lookup->cdata);
 }
 
 void *
@@ -1043,74 +1278,71 @@ LookupClientResourceComplex(ClientPtr client,
                             RESTYPE type,
                             FindComplexResType func, void *cdata)
 {
-    ResourcePtr *resources;
-    ResourcePtr this, next;
-    void *value;
-    int i;
+    LookupComplexRec lookup = { func, cdata };
+    ResourceRec found;
 
-    if (!client)
-        client = serverClient;
+    if (WalkClientResources(client, type, LookupComplexVisit, &lookup,
+                            &found))
+        return found.value;
+    return NULL;
+}
 
-    resources = clientTable[client->index].resources;
-    for (i = 0; i < clientTable[client->index].buckets; i++) {
-        for (this = resources[i]; this; this = next) {
-            next = this->next;
-            if (!type || this->type == type) {
-                /* workaround func freeing the type as DRI1 does */
-                value = this->value;
-                if ((*func) (value, this->id, cdata))
-                    return value;
+/*
+ * Free the resources of a client whose type is in rclass, newest first
+ * for each id.  The table is kept valid up to the point each resource is
+ * deleted, as delete functions ("FreeClientPixels" for one) look up other
+ * resources of the same client.
+ *
+ * The walk starts after an empty slot, so it comes to each run from the
+ * start and to the newest entry of each id first.  Freeing an entry pulls
+ * the rest of its run back, so the slot is looked at again.  Delete
+ * functions that add or free other resources can move entries past the
+ * walk, so then it goes round once more.
+ */
+static void
+FreeClientResourcesByClass(ClientResourceRec *rrec, RESTYPE rclass)
+{
+    ResourcePtr resources;
+    unsigned int generation;
+    int i, n, mask;
+    Bool again;
+
+    do {
+        again = FALSE;
+        FinishMigration(rrec);
+        resources = rrec->resources;
+        mask = (1 << rrec->hashsize) - 1;
+        for (i = 0; resources[i].type != RT_NONE; i++);
+        for (n = 0; n <= mask;) {
+            if (!(resources[i].type & rclass)) {
+                i = (i + 1) & mask;
+                n++;
+                continue;
+            }
+            generation = rrec->generation;
+            FreeSlot(rrec, i, RT_NONE);
+            if (rrec->generation != generation + 1) {
+                again = TRUE;
+                if (rrec->resources != resources || rrec->oldResources)
+                    break;
             }
         }
-    }
-    return NULL;
+    } while (again);
 }
 
 void
 FreeClientNeverRetainResources(ClientPtr client)
 {
-    ResourcePtr *resources;
-    ResourcePtr this;
-    ResourcePtr *prev;
-    int j, elements;
-    int *eltptr;
-
     if (!client)
         return;
 
-    resources = clientTable[client->index].resources;
-    eltptr = &clientTable[client->index].elements;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        prev = &resources[j];
-        while ((this = *prev)) {
-            RESTYPE rtype = this->type;
-
-            if (rtype & RC_NEVERRETAIN) {
-#ifdef XSERVER_DTRACE
-                XSERVER_RESOURCE_FREE(this->id, this->type,
-                                      this->value, TypeNameString(this->type));
-#endif
-                *prev = this->next;
-                clientTable[client->index].elements--;
-                elements = *eltptr;
-
-                doFreeResource(this, FALSE);
-
-                if (*eltptr != elements)
-                    prev = &resources[j];       /* prev may no longer be valid */
-            }
-            else
-                prev = &this->next;
-        }
-    }
+    FreeClientResourcesByClass(&clientTable[client->index], RC_NEVERRETAIN);
 }
 
 void
 FreeClientResources(ClientPtr client)
 {
-    ResourcePtr *resources;
-    ResourcePtr this;
-    int j;
+    ClientResourceRec *rrec;
 
     /* This routine shouldn't be called with a null client, but just in
        case ... */
@@ -1120,35 +1352,14 @@ FreeClientResources(ClientPtr client)
 
     HandleSaveSet(client);
 
-    resources = clientTable[client->index].resources;
-    for (j = 0; j < clientTable[client->index].buckets; j++) {
-        /* It may seem silly to update the head of this resource list as
-           we delete the members, since the entire list will be deleted any way,
-           but there are some resource deletion functions "FreeClientPixels" for
-           one which do a LookupID on another resource id (a Colormap id in this
-           case), so the resource list must be kept valid up to the point that
-           it is deleted, so every time we delete a resource, we must update the
-           head, just like in FreeResource. I hope that this doesn't slow down
-           mass deletion appreciably. PRH */
-
-        ResourcePtr *head;
-
-        head = &resources[j];
-
-        for (this = *head; this; this = *head) {
-#ifdef XSERVER_DTRACE
-            XSERVER_RESOURCE_FREE(this->id, this->type,
-                                  this->value, TypeNameString(this->type));
-#endif
-            *head = this->next;
-            clientTable[client->index].elements--;
-
-            doFreeResource(this, FALSE);
-        }
-    }
-    free(clientTable[client->index].resources);
-    clientTable[client->index].resources = NULL;
-    clientTable[client->index].buckets = 0;
+    rrec = &clientTable[client->index];
+    FreeClientResourcesByClass(rrec, RC_ANY);
+    free(rrec->oldResources);
+    rrec->oldResources = NULL;
+    free(rrec->resources);
+    rrec->resources = NULL;
+    rrec->elements = 0;
+    rrec->last.type = RT_NONE;
 }
 
 void
@@ -1157,7 +1368,7 @@ FreeAllResources(void)
     int i;
 
     for (i = currentMaxClients; --i >= 0;) {
-        if (clientTable[i].buckets)
+        if (clientTable[i].resources)
             FreeClientResources(clients[i]);
     }
 }
@@ -1187,6 +1398,27 @@ LegalNewID(XID id, ClientPtr client)
     return FALSE;
 }
 
+/*
+ * Find a resource, trying the client's last successful lookup first:
+ * requests tend to name the same drawable or GC over and over.  Only a
+ * lookup by type uses it.  The entry it holds is the newest of its id and
+ * type, but a lookup by class could have to find a newer entry of another
+ * type in the class.
+ */
+static ResourcePtr
+LookupResource(int cid, XID id, RESTYPE type, RESTYPE rclass)
+{
+    ClientResourceRec *rrec = &clientTable[cid];
+    ResourcePtr res;
+
+    if (type && rrec->last.type == type && rrec->last.id == id)
+        return &rrec->last;
+    res = LookupSlot(rrec, id, type, rclass);
+    if (res)
+        rrec->last = *res;
+    return res;
+}
+
 int
 dixLookupResourceByType(void **result, XID id, RESTYPE rtype,
                         ClientPtr client, Mask mode)
@@ -1198,13 +1430,8 @@ dixLookupResourceByType(void **result, XID id, RESTYPE rtype,
     if ((rtype & TypeMask) > lastResourceType)
         return BadImplementation;
 
-    if ((cid < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if (res->id == id && res->type == rtype)
-                break;
-    }
+    if ((cid < LimitClients) && clientTable[cid].resources)
+        res = LookupResource(cid, id, rtype, 0);
     if (client) {
         client->errorValue = id;
     }
@@ -1233,13 +1460,8 @@ dixLookupResourceByClass(void **result, XID id, RESTYPE rclass,
 
     *result = NULL;
 
-    if ((cid < LimitClients) && clientTable[cid].buckets) {
-        res = clientTable[cid].resources[HashResourceID(id, clientTable[cid].hashsize)];
-
-        for (; res; res = res->next)
-            if (res->id == id && (res->type & rclass))
-                break;
-    }
+    if ((cid < LimitClients) && clientTable[cid].resources)
+        res = LookupResource(cid, id, RT_NONE, rclass);
     if (client) {
         client->errorValue = id;
     }
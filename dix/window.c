@@ -122,7 +122,7 @@ Equipment Corporation.
 #endif
 #include "dixevents.h"
 #include "globals.h"
-#include "mi.h"                 /* miPaintWindow */
+#include "mi.h"                 /* miPaintWindow, miPickWindowsChanged */
 #ifdef COMPOSITE
 #include "compint.h"
 #endif
@@ -601,6 +601,7 @@ CreateRootWindow(ScreenPtr pScreen)
     pWin->optional->otherClients = NULL;
     pWin->optional->passiveGrabs = NULL;
     pWin->optional->userProps = NULL;
+    pWin->optional->propIndex = NULL;
     pWin->optional->backingBitPlanes = ~0L;
     pWin->optional->backingPixel = 0;
     pWin->optional->boundingShape = NULL;
@@ -608,6 +609,7 @@ CreateRootWindow(ScreenPtr pScreen)
     pWin->optional->inputShape = NULL;
     pWin->optional->inputMasks = NULL;
     pWin->optional->deviceCursors = NULL;
+    pWin->optional->recipients = NULL;
     pWin->optional->colormap = pScreen->defColormap;
     pWin->optional->visual = pScreen->rootVisual;
 
@@ -999,6 +1001,7 @@ DisposeWindowOptional(WindowPtr pWin)
         pWin->optional->deviceCursors = NULL;
     }
 
+    InvalidateInputRecipients(pWin);
     free(pWin->optional);
     pWin->optional = NULL;
 }
@@ -1109,6 +1112,7 @@ DeleteWindow(void *value, XID wid)
     }
     else
         pWin->drawable.pScreen->root = NULL;
+    miPickWindowsChanged(pWin->drawable.pScreen);
     dixFreeObjectWithPrivates(pWin, PRIVATE_WINDOW);
     return Success;
 }
@@ -2172,6 +2176,7 @@ ReflectStackChange(WindowPtr pWin, WindowPtr pSib, VTKind kind)
         return;
 
     pFirstChange = MoveWindowInStack(pWin, pSib);
+    miPickWindowsChanged(pScreen);
 
     if (WasViewable) {
         anyMarked = (*pScreen->MarkOverlappedWindows) (pWin, pFirstChange,
@@ -2422,6 +2427,7 @@ ConfigureWindow(WindowPtr pWin, Mask mask, XID *vlist, ClientPtr client)
         (*pWin->drawable.pScreen->ResizeWindow) (pWin, x, y, w, h, pSib);
     else if (mask & CWStackMode)
         ReflectStackChange(pWin, pSib, VTOther);
+    miPickWindowsChanged(pWin->drawable.pScreen);
 
     if (action != RESTACK_WIN)
         CheckCursorConfinement(pWin);
@@ -2588,6 +2594,7 @@ ReparentWindow(WindowPtr pWin, WindowPtr pParent,
     /* clip to parent */
     SetWinSize(pWin);
     SetBorderSize(pWin);
+    miPickWindowsChanged(pScreen);
 
     if (pScreen->ReparentWindow)
         (*pScreen->ReparentWindow) (pWin, pPriorParent);
@@ -2686,6 +2693,7 @@ MapWindow(WindowPtr pWin, ClientPtr client)
                 return Success;
 
         pWin->mapped = TRUE;
+        miPickWindowsChanged(pScreen);
         if (SubStrSend(pWin, pParent))
             DeliverMapNotify(pWin);
 
@@ -2754,6 +2762,7 @@ MapSubwindows(WindowPtr pParent, ClientPtr client)
                     continue;
 
             pWin->mapped = TRUE;
+            miPickWindowsChanged(pScreen);
             if (parentNotify || StrSend(pWin))
                 DeliverMapNotify(pWin);
 
@@ -2870,6 +2879,7 @@ UnmapWindow(WindowPtr pWin, Bool fromConfigure)
         (*pScreen->MarkWindow) (pLayerWin->parent);
     }
     pWin->mapped = FALSE;
+    miPickWindowsChanged(pScreen);
     if (wasRealized)
         UnrealizeTree(pWin, fromConfigure);
     if (wasViewable) {
@@ -2921,6 +2931,7 @@ UnmapSubwindows(WindowPtr pWin)
                 anyMarked = TRUE;
             }
             pChild->mapped = FALSE;
+            miPickWindowsChanged(pScreen);
             if (pChild->realized)
                 UnrealizeTree(pChild, FALSE);
         }
@@ -2983,8 +2994,10 @@ HandleSaveSet(ClientPtr client)
                                pParent->drawable.x,
                                pWin->drawable.y - wBorderWidth(pWin) -
                                pParent->drawable.y, client);
-                if (!pWin->realized && pWin->mapped)
+                if (!pWin->realized && pWin->mapped) {
                     pWin->mapped = FALSE;
+                    miPickWindowsChanged(pWin->drawable.pScreen);
+                }
             }
             if (SaveSetShouldMap(client->saveSet[j]))
                 MapWindow(pWin, client);
@@ -3421,6 +3434,7 @@ MakeWindowOptional(WindowPtr pWin)
     optional->otherClients = NULL;
     optional->passiveGrabs = NULL;
     optional->userProps = NULL;
+    optional->propIndex = NULL;
     optional->backingBitPlanes = ~0L;
     optional->backingPixel = 0;
     optional->boundingShape = NULL;
@@ -3428,6 +3442,7 @@ MakeWindowOptional(WindowPtr pWin)
     optional->inputShape = NULL;
     optional->inputMasks = NULL;
     optional->deviceCursors = NULL;
+    optional->recipients = NULL;
 
     parentOptional = FindWindowWithOptional(pWin)->optional;
     optional->visual = parentOptional->visual;
@@ -665,9 +665,29 @@ fbPolyline32(DrawablePtr pDrawable,
 extern _X_EXPORT void
  fbPolySegment32(DrawablePtr pDrawable, GCPtr pGC, int nseg, xSegment * pseg);
 
+/*
+ * fbband.c
+ */
+typedef void (*FbBandProc) (void *closure, BoxPtr band);
+
+extern _X_EXPORT Bool
+ fbBandsWanted(BoxPtr pbox, int nbox, BoxPtr extents);
+
+extern _X_EXPORT void
+ fbRunBands(BoxPtr extents, FbBandProc proc, void *closure);
+
+extern _X_EXPORT void
+ fbRunColumns(BoxPtr extents, int bpp, int xoff, FbBandProc proc,
+              void *closure);
+
 /*
  * fbblt.c
  */
+extern _X_EXPORT Bool fbBltUseSimd;
+
+extern _X_EXPORT void
+ fbBltInit(void);
+
 extern _X_EXPORT void
 
 fbBlt(FbBits * src,
@@ -955,6 +975,23 @@ extern _X_EXPORT Bool
 extern _X_EXPORT void
 fbDestroyGlyphCache(void);
 
+typedef struct _FbGlyphAtlasStats {
+    unsigned long hits;         /* glyphs found in the atlas */
+    unsigned long misses;       /* glyphs copied into it */
+    unsigned long evictions;    /* glyphs dropped to make room */
+    unsigned long uncached;     /* glyphs composited from their picture */
+    unsigned long pages;        /* atlas pages allocated */
+} FbGlyphAtlasStatsRec, *FbGlyphAtlasStatsPtr;
+
+/* maximum number of atlas pages of each format per screen */
+extern _X_EXPORT int fbGlyphAtlasPages;
+
+extern _X_EXPORT void
+fbDestroyGlyphAtlas(ScreenPtr pScreen);
+
+extern _X_EXPORT Bool
+fbGetGlyphAtlasStats(ScreenPtr pScreen, FbGlyphAtlasStatsPtr stats);
+
 /*
  * fbpixmap.c
  */
@@ -0,0 +1,155 @@
+/*
+ * Copyright © 2026 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Splitting large fills and copies over the worker threads.
+ *
+ * fbBandsWanted says whether a list of boxes covers enough pixels to be
+ * worth it, WorkerThreadMinPixels (-workerpixels), which is 0 and so off
+ * by default.  fbRunBands then cuts the extents of the boxes into bands of
+ * rows and calls the band proc for each on the worker threads; the proc
+ * draws the parts of its boxes inside the band it is given.  Rows never
+ * share a word, so the bands can be drawn at the same time as long as no
+ * band reads what another one writes.  Copies within one pixmap that move
+ * things up or down can use fbRunColumns instead, which cuts the extents
+ * into columns that start on word boundaries.
+ *
+ * The access wrappers may not expect calls from other threads, so wfb
+ * always draws on the main thread.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include "fb.h"
+
+/* bands are at least this many rows, columns this many word boundaries */
+#define FB_BAND_MIN_ROWS        16
+#define FB_BAND_MIN_UNITS       64
+
+typedef struct _FbBands {
+    FbBandProc proc;
+    void *closure;
+    BoxRec extents;
+    Bool columns;
+    int size;                   /* rows or pixels per band */
+    int first;                  /* size of the first band */
+} FbBandsRec;
+
+/**
+ * Whether the boxes are worth splitting over the worker threads.  Sets
+ * extents to the extents of the boxes when they are.
+ */
+Bool
+fbBandsWanted(BoxPtr pbox, int nbox, BoxPtr extents)
+{
+#ifdef FB_ACCESS_WRAPPER
+    return FALSE;
+#else
+    unsigned long pixels = 0;
+    int i;
+
+    if (WorkerThreadMinPixels <= 0 || nbox <= 0 ||
+        WorkerThreadParallelism() < 2)
+        return FALSE;
+
+    *extents = pbox[0];
+    for (i = 0; i < nbox; i++) {
+        pixels += (unsigned long) (pbox[i].x2 - pbox[i].x1) *
+            (pbox[i].y2 - pbox[i].y1);
+        extents->x1 = min(extents->x1, pbox[i].x1);
+        extents->y1 = min(extents->y1, pbox[i].y1);
+        extents->x2 = max(extents->x2, pbox[i].x2);
+        extents->y2 = max(extents->y2, pbox[i].y2);
+    }
+    return pixels >= WorkerThreadMinPixels;
+#endif
+}
+
+static void
+fbRunBand(void *data, int i)
+{
+    FbBandsRec *bands = data;
+    BoxRec band = bands->extents;
+    int start = i ? bands->first + (i - 1) * bands->size : 0;
+    int size = i ? bands->size : bands->first;
+
+    if (bands->columns) {
+        band.x1 += start;
+        band.x2 = min(band.x2, band.x1 + size);
+    }
+    else {
+        band.y1 += start;
+        band.y2 = min(band.y2, band.y1 + size);
+    }
+    (*bands->proc) (bands->closure, &band);
+}
+
+static void
+fbRunSplit(FbBandsRec *bands, int length, int unit, int first, int least)
+{
+    int nbands = min(length / least, WorkerThreadParallelism() * 2);
+
+    if (nbands < 2) {
+        (*bands->proc) (bands->closure, &bands->extents);
+        return;
+    }
+
+    /* whole units per band, the first one ending on a unit */
+    bands->size = ((length + nbands - 1) / nbands + unit - 1) / unit * unit;
+    bands->first = first ? first : bands->size;
+    nbands = 1 + (length - bands->first + bands->size - 1) / bands->size;
+    WorkerThreadRun(fbRunBand, bands, nbands);
+}
+
+/**
+ * Call proc for bands of rows covering extents, on the worker threads.
+ */
+void
+fbRunBands(BoxPtr extents, FbBandProc proc, void *closure)
+{
+    FbBandsRec bands = { proc, closure, *extents, FALSE };
+
+    fbRunSplit(&bands, extents->y2 - extents->y1, 1, 0, FB_BAND_MIN_ROWS);
+}
+
+/**
+ * Call proc for columns covering extents, on the worker threads.  Columns
+ * start where (x + xoff) * bpp is a multiple of FB_UNIT, so that no two of
+ * them write the same word.
+ */
+void
+fbRunColumns(BoxPtr extents, int bpp, int xoff, FbBandProc proc,
+             void *closure)
+{
+    FbBandsRec bands = { proc, closure, *extents, TRUE };
+    int unit = 1, first;
+
+    /* pixels per word boundary: 32 at 1bpp, 4 at 24bpp, 1 at 32bpp */
+    while ((unit * bpp) & FB_MASK)
+        unit <<= 1;
+    first = unit - (extents->x1 + xoff) % unit;
+
+    fbRunSplit(&bands, extents->x2 - extents->x1, unit,
+               first == unit ? 0 : first, FB_BAND_MIN_UNITS * unit);
+}
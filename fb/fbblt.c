@@ -39,6 +39,158 @@
     } \
 }
 
+/*
+ * Kernels for the middle words of a row when fbBlt has to shift: GXcopy
+ * with all planes, which is what nearly every CopyArea, window move and
+ * scroll comes down to.  Each one does
+ *
+ *	dst[i] = FbScrLeft(src[i], leftShift) | FbScrRight(src[i + 1], rightShift)
+ *
+ * for i from 0 to n - 1, reading src[n] too.  fbBltInit picks the best
+ * one the CPU can run; the scalar one is always there, and is the only
+ * one when access to the frame buffer is wrapped.  Unshifted copies just
+ * use memcpy and memmove, which the C library already does this way.
+ *
+ * fbBltUseSimd turns all of this off, leaving the generic code alone.
+ */
+
+typedef void (*FbBltShiftProc) (FbBits *dst, const FbBits *src, int n,
+                                int leftShift, int rightShift);
+
+Bool fbBltUseSimd = TRUE;
+
+/* below this many middle words a row isn't worth the setup */
+#define FB_BLT_SHIFT_MIN	8
+
+#ifndef FB_ACCESS_WRAPPER
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FB_BLT_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define FB_BLT_NEON
+#include <arm_neon.h>
+#endif
+
+static void
+fbBltShiftC(FbBits *dst, const FbBits *src, int n,
+            int leftShift, int rightShift)
+{
+    while (n--) {
+        *dst++ = FbScrLeft(src[0], leftShift) | FbScrRight(src[1], rightShift);
+        src++;
+    }
+}
+
+#ifdef FB_BLT_X86
+
+#if BITMAP_BIT_ORDER == LSBFirst
+#define FbScrLeftSSE2(v, n)	_mm_srl_epi32(v, n)
+#define FbScrRightSSE2(v, n)	_mm_sll_epi32(v, n)
+#define FbScrLeftAVX2(v, n)	_mm256_srl_epi32(v, n)
+#define FbScrRightAVX2(v, n)	_mm256_sll_epi32(v, n)
+#else
+#define FbScrLeftSSE2(v, n)	_mm_sll_epi32(v, n)
+#define FbScrRightSSE2(v, n)	_mm_srl_epi32(v, n)
+#define FbScrLeftAVX2(v, n)	_mm256_sll_epi32(v, n)
+#define FbScrRightAVX2(v, n)	_mm256_srl_epi32(v, n)
+#endif
+
+__attribute__((target("sse2")))
+static void
+fbBltShiftSSE2(FbBits *dst, const FbBits *src, int n,
+               int leftShift, int rightShift)
+{
+    __m128i ls = _mm_cvtsi32_si128(leftShift);
+    __m128i rs = _mm_cvtsi32_si128(rightShift);
+    __m128i lo, hi;
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4) {
+        lo = _mm_loadu_si128((const __m128i *) src);
+        hi = _mm_loadu_si128((const __m128i *) (src + 1));
+        _mm_storeu_si128((__m128i *) dst,
+                         _mm_or_si128(FbScrLeftSSE2(lo, ls),
+                                      FbScrRightSSE2(hi, rs)));
+    }
+    fbBltShiftC(dst, src, n, leftShift, rightShift);
+}
+
+__attribute__((target("avx2")))
+static void
+fbBltShiftAVX2(FbBits *dst, const FbBits *src, int n,
+               int leftShift, int rightShift)
+{
+    __m128i ls = _mm_cvtsi32_si128(leftShift);
+    __m128i rs = _mm_cvtsi32_si128(rightShift);
+    __m256i lo, hi;
+
+    for (; n >= 8; n -= 8, src += 8, dst += 8) {
+        lo = _mm256_loadu_si256((const __m256i *) src);
+        hi = _mm256_loadu_si256((const __m256i *) (src + 1));
+        _mm256_storeu_si256((__m256i *) dst,
+                            _mm256_or_si256(FbScrLeftAVX2(lo, ls),
+                                            FbScrRightAVX2(hi, rs)));
+    }
+    /* not fbBltShiftSSE2: mixing in legacy SSE code costs more than this */
+    while (n--) {
+        *dst++ = FbScrLeft(src[0], leftShift) | FbScrRight(src[1], rightShift);
+        src++;
+    }
+}
+
+#endif /* FB_BLT_X86 */
+
+#ifdef FB_BLT_NEON
+
+static void
+fbBltShiftNEON(FbBits *dst, const FbBits *src, int n,
+               int leftShift, int rightShift)
+{
+    /* vshlq_u32 shifts right by negative counts */
+#if BITMAP_BIT_ORDER == LSBFirst
+    int32x4_t ls = vdupq_n_s32(-leftShift);
+    int32x4_t rs = vdupq_n_s32(rightShift);
+#else
+    int32x4_t ls = vdupq_n_s32(leftShift);
+    int32x4_t rs = vdupq_n_s32(-rightShift);
+#endif
+    uint32x4_t lo, hi;
+
+    for (; n >= 4; n -= 4, src += 4, dst += 4) {
+        lo = vld1q_u32(src);
+        hi = vld1q_u32(src + 1);
+        vst1q_u32(dst, vorrq_u32(vshlq_u32(lo, ls), vshlq_u32(hi, rs)));
+    }
+    fbBltShiftC(dst, src, n, leftShift, rightShift);
+}
+
+#endif /* FB_BLT_NEON */
+
+static FbBltShiftProc fbBltShift = fbBltShiftC;
+
+/* whether the kernel may run on this row: it reads src[0..n] */
+#define FbBltShiftOverlaps(dst, src, n) \
+    ((dst) <= (src) + (n) && (src) <= (dst) + (n) - 1)
+
+#endif /* FB_ACCESS_WRAPPER */
+
+/**
+ * Pick the fbBlt kernels for this CPU.  Called from fbSetupScreen.
+ */
+void
+fbBltInit(void)
+{
+#ifdef FB_BLT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        fbBltShift = fbBltShiftAVX2;
+    else if (__builtin_cpu_supports("sse2"))
+        fbBltShift = fbBltShiftSSE2;
+#elif defined(FB_BLT_NEON)
+    fbBltShift = fbBltShiftNEON;
+#endif
+}
+
 void
 fbBlt(FbBits * srcLine,
       FbStride srcStride,
@@ -56,6 +208,9 @@ fbBlt(FbBits * srcLine,
     int n, nmiddle;
     Bool destInvarient;
     int startbyte, endbyte;
+#ifndef FB_ACCESS_WRAPPER
+    Bool copy = fbBltUseSimd && alu == GXcopy && pm == FB_ALLONES;
+#endif
 
     FbDeclareMergeRop();
 
@@ -69,8 +224,8 @@ fbBlt(FbBits * srcLine,
         int             width_byte = (width >> 3);
 
         /* Make sure there's no overlap; we can't use memcpy in that
-         * case as it's not well defined, so fall through to the
-         * general code
+         * case as it's not well defined, so use memmove, or fall
+         * through to the general code when access is wrapped
          */
         if (src_byte + width_byte <= dst_byte ||
             dst_byte + width_byte <= src_byte)
@@ -90,6 +245,23 @@ fbBlt(FbBits * srcLine,
 
             return;
         }
+#ifndef FB_ACCESS_WRAPPER
+        else if (copy) {
+            int i;
+
+            /* rows are done in the order the caller asked for */
+            if (!upsidedown)
+                for (i = 0; i < height; i++)
+                    memmove(dst_byte + i * dst_byte_stride,
+                            src_byte + i * src_byte_stride, width_byte);
+            else
+                for (i = height - 1; i >= 0; i--)
+                    memmove(dst_byte + i * dst_byte_stride,
+                            src_byte + i * src_byte_stride, width_byte);
+
+            return;
+        }
+#endif
     }
 
     FbInitializeMergeRop(alu, pm);
@@ -127,6 +299,14 @@ fbBlt(FbBits * srcLine,
                     FbDoRightMaskByteMergeRop(dst, bits, endbyte, endmask);
                 }
                 n = nmiddle;
+#ifndef FB_ACCESS_WRAPPER
+                if (copy) {
+                    dst -= n;
+                    src -= n;
+                    memmove(dst, src, n * sizeof(FbBits));
+                }
+                else
+#endif
                 if (destInvarient) {
                     while (n--)
                         WRITE(--dst, FbDoDestInvarientMergeRop(READ(--src)));
@@ -151,6 +331,14 @@ fbBlt(FbBits * srcLine,
                     dst++;
                 }
                 n = nmiddle;
+#ifndef FB_ACCESS_WRAPPER
+                if (copy) {
+                    memmove(dst, src, n * sizeof(FbBits));
+                    dst += n;
+                    src += n;
+                }
+                else
+#endif
                 if (destInvarient) {
 #if 0
                     /*
@@ -221,6 +409,22 @@ fbBlt(FbBits * srcLine,
                 }
                 n = nmiddle;
                 if (destInvarient) {
+#ifndef FB_ACCESS_WRAPPER
+                    /* the first word may come from bits1 alone */
+                    if (copy && n > FB_BLT_SHIFT_MIN &&
+                        !FbBltShiftOverlaps(dst - n, src - n, n)) {
+                        bits = FbScrRight(bits1, rightShift);
+                        bits1 = READ(--src);
+                        bits |= FbScrLeft(bits1, leftShift);
+                        WRITE(--dst, bits);
+                        n--;
+                        src -= n;
+                        dst -= n;
+                        (*fbBltShift) (dst, src, n, leftShift, rightShift);
+                        bits1 = READ(src);
+                        n = 0;
+                    }
+#endif
                     while (n--) {
                         bits = FbScrRight(bits1, rightShift);
                         bits1 = READ(--src);
@@ -262,6 +466,21 @@ fbBlt(FbBits * srcLine,
                 }
                 n = nmiddle;
                 if (destInvarient) {
+#ifndef FB_ACCESS_WRAPPER
+                    if (copy && n > FB_BLT_SHIFT_MIN &&
+                        !FbBltShiftOverlaps(dst, src - 1, n)) {
+                        bits = FbScrLeft(bits1, leftShift);
+                        bits1 = READ(src++);
+                        bits |= FbScrRight(bits1, rightShift);
+                        WRITE(dst++, bits);
+                        n--;
+                        (*fbBltShift) (dst, src - 1, n, leftShift, rightShift);
+                        src += n;
+                        dst += n;
+                        bits1 = READ(src - 1);
+                        n = 0;
+                    }
+#endif
                     while (n--) {
                         bits = FbScrLeft(bits1, leftShift);
                         bits1 = READ(src++);
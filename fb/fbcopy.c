@@ -28,17 +28,7 @@
 
 #include "fb.h"
 
-void
-fbCopyNtoN(DrawablePtr pSrcDrawable,
-           DrawablePtr pDstDrawable,
-           GCPtr pGC,
-           BoxPtr pbox,
-           int nbox,
-           int dx,
-           int dy, Bool reverse, Bool upsidedown, Pixel bitplane, void *closure)
-{
-    CARD8 alu = pGC ? pGC->alu : GXcopy;
-    FbBits pm = pGC ? fbGetGCPrivate(pGC)->pm : FB_ALLONES;
+typedef struct _FbCopyNtoN {
     FbBits *src;
     FbStride srcStride;
     int srcBpp;
@@ -47,38 +37,127 @@ fbCopyNtoN(DrawablePtr pSrcDrawable,
     FbStride dstStride;
     int dstBpp;
     int dstXoff, dstYoff;
+    BoxPtr pbox;
+    int nbox;
+    int dx, dy;
+    Bool reverse, upsidedown;
+    CARD8 alu;
+    FbBits pm;
+} FbCopyNtoNRec;
 
-    fbGetDrawable(pSrcDrawable, src, srcStride, srcBpp, srcXoff, srcYoff);
-    fbGetDrawable(pDstDrawable, dst, dstStride, dstBpp, dstXoff, dstYoff);
+/* copy the parts of the boxes inside band */
+static void
+fbCopyNtoNBand(void *closure, BoxPtr band)
+{
+    FbCopyNtoNRec *copy = closure;
+    FbBits *src = copy->src, *dst = copy->dst;
+    FbStride srcStride = copy->srcStride, dstStride = copy->dstStride;
+    int srcBpp = copy->srcBpp, dstBpp = copy->dstBpp;
+    int srcXoff = copy->srcXoff, srcYoff = copy->srcYoff;
+    int dstXoff = copy->dstXoff, dstYoff = copy->dstYoff;
+    int dx = copy->dx, dy = copy->dy;
+    Bool reverse = copy->reverse, upsidedown = copy->upsidedown;
+    CARD8 alu = copy->alu;
+    FbBits pm = copy->pm;
+    int nbox = copy->nbox;
+    BoxPtr pbox;
+    BoxRec box;
 
-    while (nbox--) {
+    for (pbox = copy->pbox; nbox--; pbox++) {
+        box.x1 = max(pbox->x1, band->x1);
+        box.y1 = max(pbox->y1, band->y1);
+        box.x2 = min(pbox->x2, band->x2);
+        box.y2 = min(pbox->y2, band->y2);
+        if (box.x1 >= box.x2 || box.y1 >= box.y2)
+            continue;
 #ifndef FB_ACCESS_WRAPPER       /* pixman_blt() doesn't support accessors yet */
         if (pm == FB_ALLONES && alu == GXcopy && !reverse && !upsidedown) {
-            if (!pixman_blt
+            if (pixman_blt
                 ((uint32_t *) src, (uint32_t *) dst, srcStride, dstStride,
-                 srcBpp, dstBpp, (pbox->x1 + dx + srcXoff),
-                 (pbox->y1 + dy + srcYoff), (pbox->x1 + dstXoff),
-                 (pbox->y1 + dstYoff), (pbox->x2 - pbox->x1),
-                 (pbox->y2 - pbox->y1)))
-                goto fallback;
-            else
-                goto next;
+                 srcBpp, dstBpp, (box.x1 + dx + srcXoff),
+                 (box.y1 + dy + srcYoff), (box.x1 + dstXoff),
+                 (box.y1 + dstYoff), (box.x2 - box.x1),
+                 (box.y2 - box.y1)))
+                continue;
         }
- fallback:
 #endif
-        fbBlt(src + (pbox->y1 + dy + srcYoff) * srcStride,
+        fbBlt(src + (box.y1 + dy + srcYoff) * srcStride,
               srcStride,
-              (pbox->x1 + dx + srcXoff) * srcBpp,
-              dst + (pbox->y1 + dstYoff) * dstStride,
+              (box.x1 + dx + srcXoff) * srcBpp,
+              dst + (box.y1 + dstYoff) * dstStride,
               dstStride,
-              (pbox->x1 + dstXoff) * dstBpp,
-              (pbox->x2 - pbox->x1) * dstBpp,
-              (pbox->y2 - pbox->y1), alu, pm, dstBpp, reverse, upsidedown);
-#ifndef FB_ACCESS_WRAPPER
- next:
-#endif
-        pbox++;
+              (box.x1 + dstXoff) * dstBpp,
+              (box.x2 - box.x1) * dstBpp,
+              (box.y2 - box.y1), alu, pm, dstBpp, reverse, upsidedown);
+    }
+}
+
+/*
+ * Split up a copy whose bands mustn't read what other bands write.  That
+ * holds when the source and destination rows don't overlap, or when they
+ * do but every row is copied within itself.  Otherwise columns work if
+ * nothing moves sideways; anything else is done in one go.
+ */
+static void
+fbCopyNtoNThreaded(FbCopyNtoNRec *copy, BoxPtr extents)
+{
+    FbBits *srcFirst = copy->src +
+        (extents->y1 + copy->dy + copy->srcYoff) * copy->srcStride;
+    FbBits *srcLast = copy->src +
+        (extents->y2 + copy->dy + copy->srcYoff) * copy->srcStride;
+    FbBits *dstFirst = copy->dst +
+        (extents->y1 + copy->dstYoff) * copy->dstStride;
+    FbBits *dstLast = copy->dst +
+        (extents->y2 + copy->dstYoff) * copy->dstStride;
+
+    if (srcLast <= dstFirst || dstLast <= srcFirst)
+        fbRunBands(extents, fbCopyNtoNBand, copy);
+    else if (copy->src != copy->dst || copy->srcStride != copy->dstStride ||
+             copy->srcBpp != copy->dstBpp)
+        fbCopyNtoNBand(copy, extents);
+    else if (copy->dy + copy->srcYoff == copy->dstYoff)
+        fbRunBands(extents, fbCopyNtoNBand, copy);
+    else if (copy->dx + copy->srcXoff == copy->dstXoff)
+        fbRunColumns(extents, copy->dstBpp, copy->dstXoff,
+                     fbCopyNtoNBand, copy);
+    else
+        fbCopyNtoNBand(copy, extents);
+}
+
+void
+fbCopyNtoN(DrawablePtr pSrcDrawable,
+           DrawablePtr pDstDrawable,
+           GCPtr pGC,
+           BoxPtr pbox,
+           int nbox,
+           int dx,
+           int dy, Bool reverse, Bool upsidedown, Pixel bitplane, void *closure)
+{
+    FbCopyNtoNRec copy;
+    BoxRec extents;
+
+    copy.alu = pGC ? pGC->alu : GXcopy;
+    copy.pm = pGC ? fbGetGCPrivate(pGC)->pm : FB_ALLONES;
+    copy.pbox = pbox;
+    copy.nbox = nbox;
+    copy.dx = dx;
+    copy.dy = dy;
+    copy.reverse = reverse;
+    copy.upsidedown = upsidedown;
+
+    fbGetDrawable(pSrcDrawable, copy.src, copy.srcStride, copy.srcBpp,
+                  copy.srcXoff, copy.srcYoff);
+    fbGetDrawable(pDstDrawable, copy.dst, copy.dstStride, copy.dstBpp,
+                  copy.dstXoff, copy.dstYoff);
+
+    if (fbBandsWanted(pbox, nbox, &extents))
+        fbCopyNtoNThreaded(&copy, &extents);
+    else {
+        extents.x1 = extents.y1 = MINSHORT;
+        extents.x2 = extents.y2 = MAXSHORT;
+        fbCopyNtoNBand(&copy, &extents);
     }
+
     fbFinishAccess(pDstDrawable);
     fbFinishAccess(pSrcDrawable);
 }
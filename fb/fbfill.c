@@ -108,8 +108,9 @@ fbStipple(FbBits * dst, FbStride dstStride,
     }
 }
 
-void
-fbFill(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int width, int height)
+static void
+fbFillRect(DrawablePtr pDrawable, GCPtr pGC,
+           int x, int y, int width, int height)
 {
     FbBits *dst;
     FbStride dstStride;
@@ -220,6 +221,33 @@ fbFill(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int width, int height)
     fbFinishAccess(pDrawable);
 }
 
+typedef struct _FbFillBands {
+    DrawablePtr pDrawable;
+    GCPtr pGC;
+} FbFillBandsRec;
+
+/* tiles and stipples line up by themselves, they go by the pattern origin */
+static void
+fbFillBand(void *closure, BoxPtr band)
+{
+    FbFillBandsRec *fill = closure;
+
+    fbFillRect(fill->pDrawable, fill->pGC, band->x1, band->y1,
+               band->x2 - band->x1, band->y2 - band->y1);
+}
+
+void
+fbFill(DrawablePtr pDrawable, GCPtr pGC, int x, int y, int width, int height)
+{
+    BoxRec box = { x, y, x + width, y + height }, extents;
+    FbFillBandsRec fill = { pDrawable, pGC };
+
+    if (fbBandsWanted(&box, 1, &extents))
+        fbRunBands(&extents, fbFillBand, &fill);
+    else
+        fbFillRect(pDrawable, pGC, x, y, width, height);
+}
+
 void
 fbSolidBoxClipped(DrawablePtr pDrawable,
                   RegionPtr pClip,
@@ -70,26 +70,346 @@ fbComposite(CARD8 op,
     free_pixman_pict(pDst, dest);
 }
 
-static pixman_glyph_cache_t *glyphCache;
+/*
+ * Glyph atlas.
+ *
+ * Glyph pictures are copied into a few large images per screen, a8 pages
+ * for glyphs which are only alpha and a8r8g8b8 pages for colour glyphs,
+ * and are composited from a view of their cell in the page.  Cells are
+ * handed out from shelves of rows with heights rounded up to a multiple
+ * of FB_GLYPH_SHELF_ROUND.  Space isn't reclaimed glyph by glyph; once
+ * fbGlyphAtlasPages pages of a format are full the least recently used
+ * one is emptied, unless the current call is still compositing from it.
+ */
+
+#define FB_GLYPH_PAGE_SIZE	512
+#define FB_GLYPH_MAX_SIZE	128	/* bigger glyphs aren't cached */
+#define FB_GLYPH_SHELF_ROUND	4
+#define FB_GLYPH_MAX_PAGES	64
+
+int fbGlyphAtlasPages = 8;
+
+enum {
+    FB_GLYPH_ALPHA,
+    FB_GLYPH_COLOR,
+    FB_GLYPH_NUM_FORMATS
+};
+
+typedef struct _fbGlyphPage *FbGlyphPagePtr;
+
+typedef struct _fbGlyphEntry {
+    struct _fbGlyphEntry *next;	/* same glyph, other screens */
+    GlyphPtr glyph;
+    FbGlyphPagePtr page;
+    pixman_image_t *image;	/* view of the cell in page->image */
+    struct xorg_list link;	/* in page->entries */
+} FbGlyphEntryRec, *FbGlyphEntryPtr;
+
+typedef struct _fbGlyphShelf {
+    short y, height;
+    short x;			/* first free column */
+} FbGlyphShelfRec;
+
+typedef struct _fbGlyphPage {
+    struct _fbGlyphAtlas *atlas;
+    pixman_image_t *image;
+    CARD32 lastUse;		/* atlas serial of the last fbGlyphs using it */
+    int top;			/* first row not in a shelf */
+    int nshelves;
+    FbGlyphShelfRec shelves[FB_GLYPH_PAGE_SIZE / FB_GLYPH_SHELF_ROUND];
+    struct xorg_list entries;
+} FbGlyphPageRec;
+
+typedef struct _fbGlyphAtlas {
+    FbGlyphPagePtr pages[FB_GLYPH_NUM_FORMATS][FB_GLYPH_MAX_PAGES];
+    int npages[FB_GLYPH_NUM_FORMATS];
+    int maxPages;
+    CARD32 serial;
+    FbGlyphAtlasStatsRec stats;
+} FbGlyphAtlasRec, *FbGlyphAtlasPtr;
+
+static DevPrivateKeyRec fbGlyphAtlasScreenKeyRec;
+static DevPrivateKeyRec fbGlyphAtlasGlyphKeyRec;
+
+static const pixman_format_code_t fbGlyphPageFormats[FB_GLYPH_NUM_FORMATS] = {
+    PIXMAN_a8, PIXMAN_a8r8g8b8
+};
+
+static FbGlyphAtlasPtr
+fbGetGlyphAtlas(ScreenPtr pScreen)
+{
+    if (!dixPrivateKeyRegistered(&fbGlyphAtlasScreenKeyRec))
+	return NULL;
+    return dixLookupPrivate(&pScreen->devPrivates, &fbGlyphAtlasScreenKeyRec);
+}
+
+static FbGlyphEntryPtr *
+fbGlyphEntries(GlyphPtr glyph)
+{
+    return (FbGlyphEntryPtr *)
+	dixLookupPrivateAddr(&glyph->devPrivates, &fbGlyphAtlasGlyphKeyRec);
+}
+
+static FbGlyphEntryPtr *
+fbFindGlyphEntry(FbGlyphAtlasPtr atlas, GlyphPtr glyph)
+{
+    FbGlyphEntryPtr *prev;
+
+    for (prev = fbGlyphEntries(glyph); *prev; prev = &(*prev)->next)
+	if ((*prev)->page->atlas == atlas)
+	    return prev;
+    return NULL;
+}
+
+static void
+fbFreeGlyphEntry(FbGlyphEntryPtr *prev)
+{
+    FbGlyphEntryPtr entry = *prev;
+
+    *prev = entry->next;
+    xorg_list_del(&entry->link);
+    pixman_image_unref(entry->image);
+    free(entry);
+}
+
+static void
+fbEmptyGlyphPage(FbGlyphAtlasPtr atlas, FbGlyphPagePtr page)
+{
+    FbGlyphEntryPtr entry, tmp;
+    FbGlyphEntryPtr *prev;
+
+    xorg_list_for_each_entry_safe(entry, tmp, &page->entries, link) {
+	for (prev = fbGlyphEntries(entry->glyph); *prev != entry;
+	     prev = &(*prev)->next)
+	    ;
+	fbFreeGlyphEntry(prev);
+	atlas->stats.evictions++;
+    }
+    page->top = 0;
+    page->nshelves = 0;
+}
+
+static FbGlyphPagePtr
+fbCreateGlyphPage(FbGlyphAtlasPtr atlas, int format)
+{
+    FbGlyphPagePtr page;
+
+    if (!(page = calloc(1, sizeof(FbGlyphPageRec))))
+	return NULL;
+    page->image = pixman_image_create_bits(fbGlyphPageFormats[format],
+					   FB_GLYPH_PAGE_SIZE,
+					   FB_GLYPH_PAGE_SIZE, NULL, 0);
+    if (!page->image) {
+	free(page);
+	return NULL;
+    }
+    page->atlas = atlas;
+    xorg_list_init(&page->entries);
+    return page;
+}
+
+static Bool
+fbAllocGlyphCell(FbGlyphPagePtr page, int width, int height, int *x, int *y)
+{
+    FbGlyphShelfRec *shelf;
+    int i;
+
+    /* keep a8 rows of each cell 32-bit aligned */
+    width = (width + 3) & ~3;
+    height = (height + FB_GLYPH_SHELF_ROUND - 1) & ~(FB_GLYPH_SHELF_ROUND - 1);
+
+    for (i = 0; i < page->nshelves; i++) {
+	shelf = &page->shelves[i];
+	if (shelf->height == height &&
+	    shelf->x + width <= FB_GLYPH_PAGE_SIZE)
+	    goto found;
+    }
+
+    if (page->top + height > FB_GLYPH_PAGE_SIZE)
+	return FALSE;
+    shelf = &page->shelves[page->nshelves++];
+    shelf->y = page->top;
+    shelf->height = height;
+    shelf->x = 0;
+    page->top += height;
+
+found:
+    *x = shelf->x;
+    *y = shelf->y;
+    shelf->x += width;
+    return TRUE;
+}
+
+/*
+ * Find room for a glyph, creating a page or emptying the least recently
+ * used one if the pages of this format are full.
+ */
+static FbGlyphPagePtr
+fbPlaceGlyph(FbGlyphAtlasPtr atlas, int format, int width, int height,
+	     int *x, int *y)
+{
+    FbGlyphPagePtr *pages = atlas->pages[format];
+    FbGlyphPagePtr page, lru = NULL;
+    int p;
+
+    for (p = 0; p < atlas->npages[format]; p++) {
+	page = pages[p];
+	if (fbAllocGlyphCell(page, width, height, x, y))
+	    return page;
+	if (page->lastUse != atlas->serial &&
+	    (!lru || (int) (page->lastUse - lru->lastUse) < 0))
+	    lru = page;
+    }
+
+    if (atlas->npages[format] < atlas->maxPages &&
+	(page = fbCreateGlyphPage(atlas, format))) {
+	pages[atlas->npages[format]++] = page;
+	atlas->stats.pages++;
+    }
+    else if (lru) {
+	page = lru;
+	fbEmptyGlyphPage(atlas, page);
+    }
+    else
+	return NULL;
+
+    if (!fbAllocGlyphCell(page, width, height, x, y))
+	return NULL;
+    return page;
+}
+
+/*
+ * Copy a glyph into the atlas.  Returns NULL if it didn't fit, in which
+ * case the caller composites straight from the glyph picture.
+ */
+static FbGlyphEntryPtr
+fbCacheGlyph(FbGlyphAtlasPtr atlas, GlyphPtr glyph, PicturePtr pPicture)
+{
+    FbGlyphEntryPtr entry;
+    FbGlyphPagePtr page;
+    pixman_image_t *src;
+    int width = glyph->info.width, height = glyph->info.height;
+    int format, x, y, xoff, yoff, stride;
+    char *bits;
+
+    if (width > FB_GLYPH_MAX_SIZE || height > FB_GLYPH_MAX_SIZE)
+	return NULL;
+
+    format = PICT_FORMAT_RGB(pPicture->format) ? FB_GLYPH_COLOR : FB_GLYPH_ALPHA;
+    if (!(page = fbPlaceGlyph(atlas, format, width, height, &x, &y)))
+	return NULL;
+
+    if (!(entry = calloc(1, sizeof(FbGlyphEntryRec))))
+	return NULL;
+
+    stride = pixman_image_get_stride(page->image);
+    bits = (char *) pixman_image_get_data(page->image) + y * stride +
+	x * (PIXMAN_FORMAT_BPP(fbGlyphPageFormats[format]) >> 3);
+    entry->image = pixman_image_create_bits(fbGlyphPageFormats[format],
+					    width, height,
+					    (uint32_t *) bits, stride);
+    if (!entry->image ||
+	!(src = image_from_pict(pPicture, FALSE, &xoff, &yoff))) {
+	if (entry->image)
+	    pixman_image_unref(entry->image);
+	free(entry);
+	return NULL;
+    }
+
+    pixman_image_composite(PIXMAN_OP_SRC, src, NULL, entry->image,
+			   xoff, yoff, 0, 0, 0, 0, width, height);
+    free_pixman_pict(pPicture, src);
+    pixman_image_set_component_alpha(entry->image, pPicture->componentAlpha);
+
+    entry->glyph = glyph;
+    entry->page = page;
+    xorg_list_add(&entry->link, &page->entries);
+    entry->next = *fbGlyphEntries(glyph);
+    *fbGlyphEntries(glyph) = entry;
+    return entry;
+}
+
+static Bool
+fbGlyphAtlasInit(ScreenPtr pScreen)
+{
+    FbGlyphAtlasPtr atlas;
+
+    if (!dixRegisterPrivateKey(&fbGlyphAtlasScreenKeyRec, PRIVATE_SCREEN, 0) ||
+	!dixRegisterPrivateKey(&fbGlyphAtlasGlyphKeyRec, PRIVATE_GLYPH,
+			       sizeof(FbGlyphEntryPtr)))
+	return FALSE;
+
+    if (!(atlas = calloc(1, sizeof(FbGlyphAtlasRec))))
+	return FALSE;
+    atlas->maxPages = min(max(fbGlyphAtlasPages, 1), FB_GLYPH_MAX_PAGES);
+    dixSetPrivate(&pScreen->devPrivates, &fbGlyphAtlasScreenKeyRec, atlas);
+    return TRUE;
+}
 
 void
-fbDestroyGlyphCache(void)
+fbDestroyGlyphAtlas(ScreenPtr pScreen)
 {
-    if (glyphCache)
-    {
-	pixman_glyph_cache_destroy (glyphCache);
-	glyphCache = NULL;
+    FbGlyphAtlasPtr atlas = fbGetGlyphAtlas(pScreen);
+    int f, p;
+
+    if (!atlas)
+	return;
+
+    LogMessageVerb(X_INFO, 3, "fb: screen %d glyph atlas: %lu hits, "
+		   "%lu misses, %lu evictions, %lu uncached, %lu pages\n",
+		   pScreen->myNum, atlas->stats.hits, atlas->stats.misses,
+		   atlas->stats.evictions, atlas->stats.uncached,
+		   atlas->stats.pages);
+
+    for (f = 0; f < FB_GLYPH_NUM_FORMATS; f++) {
+	for (p = 0; p < atlas->npages[f]; p++) {
+	    fbEmptyGlyphPage(atlas, atlas->pages[f][p]);
+	    pixman_image_unref(atlas->pages[f][p]->image);
+	    free(atlas->pages[f][p]);
+	}
     }
+    free(atlas);
+    dixSetPrivate(&pScreen->devPrivates, &fbGlyphAtlasScreenKeyRec, NULL);
+}
+
+void
+fbDestroyGlyphCache(void)
+{
+    int i;
+
+    for (i = 0; i < screenInfo.numScreens; i++)
+	fbDestroyGlyphAtlas(screenInfo.screens[i]);
+}
+
+Bool
+fbGetGlyphAtlasStats(ScreenPtr pScreen, FbGlyphAtlasStatsPtr stats)
+{
+    FbGlyphAtlasPtr atlas = fbGetGlyphAtlas(pScreen);
+
+    if (!atlas)
+	return FALSE;
+    *stats = atlas->stats;
+    return TRUE;
 }
 
 static void
 fbUnrealizeGlyph(ScreenPtr pScreen,
 		 GlyphPtr pGlyph)
 {
-    if (glyphCache)
-	pixman_glyph_cache_remove (glyphCache, pGlyph, NULL);
+    FbGlyphAtlasPtr atlas = fbGetGlyphAtlas(pScreen);
+    FbGlyphEntryPtr *prev;
+
+    if (atlas && (prev = fbFindGlyphEntry(atlas, pGlyph)))
+	fbFreeGlyphEntry(prev);
 }
 
+typedef struct _fbGlyphItem {
+    int x, y;			/* top left corner, relative to the first list */
+    int width, height;
+    pixman_image_t *image;
+    Bool owned;			/* not in the atlas, unref when done */
+} FbGlyphItemRec, *FbGlyphItemPtr;
+
 void
 fbGlyphs(CARD8 op,
 	 PicturePtr pSrc,
@@ -102,12 +422,13 @@ fbGlyphs(CARD8 op,
 {
 #define N_STACK_GLYPHS 512
     ScreenPtr pScreen = pDst->pDrawable->pScreen;
-    pixman_glyph_t stack_glyphs[N_STACK_GLYPHS];
-    pixman_glyph_t *pglyphs = stack_glyphs;
+    FbGlyphAtlasPtr atlas = fbGetGlyphAtlas(pScreen);
+    FbGlyphItemRec stack_items[N_STACK_GLYPHS];
+    FbGlyphItemPtr items = stack_items, item;
     pixman_image_t *srcImage, *dstImage;
     int srcXoff, srcYoff, dstXoff, dstYoff;
     GlyphPtr glyph;
-    int n_glyphs;
+    int n_glyphs, nitems;
     int x, y;
     int i, n;
     int xDst = list->xOff, yDst = list->yOff;
@@ -118,56 +439,67 @@ fbGlyphs(CARD8 op,
     for (i = 0; i < nlist; ++i)
 	n_glyphs += list[i].len;
 
-    if (!glyphCache)
-	glyphCache = pixman_glyph_cache_create();
-
-    pixman_glyph_cache_freeze (glyphCache);
-
     if (n_glyphs > N_STACK_GLYPHS) {
-	if (!(pglyphs = xallocarray(n_glyphs, sizeof(pixman_glyph_t))))
-	    goto out;
+	if (!(items = ScratchAllocArray(n_glyphs, sizeof(FbGlyphItemRec))))
+	    return;
     }
 
-    i = 0;
+    /* pages holding glyphs of this call are not evicted by it */
+    if (atlas)
+	atlas->serial++;
+
+    nitems = 0;
     x = y = 0;
     while (nlist--) {
         x += list->xOff;
         y += list->yOff;
         n = list->len;
         while (n--) {
-	    const void *g;
+	    FbGlyphEntryPtr *prev, entry = NULL;
+	    PicturePtr pPicture;
 
             glyph = *glyphs++;
 
-	    if (!(g = pixman_glyph_cache_lookup (glyphCache, glyph, NULL))) {
-		pixman_image_t *glyphImage;
-		PicturePtr pPicture;
-		int xoff, yoff;
+	    if (!glyph->info.width || !glyph->info.height)
+		goto next;
+
+	    item = &items[nitems];
+	    item->owned = FALSE;
 
+	    if (atlas && (prev = fbFindGlyphEntry(atlas, glyph))) {
+		entry = *prev;
+		atlas->stats.hits++;
+	    }
+	    else {
 		pPicture = GetGlyphPicture(glyph, pScreen);
-		if (!pPicture) {
-		    n_glyphs--;
+		if (!pPicture)
 		    goto next;
-		}
-
-		if (!(glyphImage = image_from_pict(pPicture, FALSE, &xoff, &yoff)))
-		    goto out;
 
-		g = pixman_glyph_cache_insert(glyphCache, glyph, NULL,
-					      glyph->info.x,
-					      glyph->info.y,
-					      glyphImage);
-
-		free_pixman_pict(pPicture, glyphImage);
-
-		if (!g)
-		    goto out;
+		if (atlas) {
+		    atlas->stats.misses++;
+		    entry = fbCacheGlyph(atlas, glyph, pPicture);
+		}
+		if (!entry) {
+		    int xoff, yoff;
+
+		    if (atlas)
+			atlas->stats.uncached++;
+		    item->image = image_from_pict(pPicture, FALSE, &xoff, &yoff);
+		    if (!item->image)
+			goto out;
+		    item->owned = TRUE;
+		}
 	    }
 
-	    pglyphs[i].x = x;
-	    pglyphs[i].y = y;
-	    pglyphs[i].glyph = g;
-	    i++;
+	    if (entry) {
+		entry->page->lastUse = atlas->serial;
+		item->image = entry->image;
+	    }
+	    item->x = x - glyph->info.x;
+	    item->y = y - glyph->info.y;
+	    item->width = glyph->info.width;
+	    item->height = glyph->info.height;
+	    nitems++;
 
 	next:
             x += glyph->info.xOff;
@@ -175,6 +507,8 @@ fbGlyphs(CARD8 op,
 	}
 	list++;
     }
+    if (!nitems)
+	goto out;
 
     if (!(srcImage = image_from_pict(pSrc, FALSE, &srcXoff, &srcYoff)))
 	goto out;
@@ -184,25 +518,52 @@ fbGlyphs(CARD8 op,
 
     if (maskFormat) {
 	pixman_format_code_t format;
-	pixman_box32_t extents;
+	pixman_image_t *maskImage;
+	int x1, y1, x2, y2;
 
 	format = maskFormat->format | (maskFormat->depth << 24);
 
-	pixman_glyph_get_extents(glyphCache, n_glyphs, pglyphs, &extents);
+	x1 = y1 = INT_MAX;
+	x2 = y2 = INT_MIN;
+	for (i = 0; i < nitems; i++) {
+	    item = &items[i];
+	    x1 = min(x1, item->x);
+	    y1 = min(y1, item->y);
+	    x2 = max(x2, item->x + item->width);
+	    y2 = max(y2, item->y + item->height);
+	}
+
+	maskImage = pixman_image_create_bits(format, x2 - x1, y2 - y1, NULL, 0);
+	if (maskImage) {
+	    if (PIXMAN_FORMAT_A(format) && PIXMAN_FORMAT_RGB(format))
+		pixman_image_set_component_alpha(maskImage, TRUE);
+
+	    for (i = 0; i < nitems; i++) {
+		item = &items[i];
+		pixman_image_composite(PIXMAN_OP_ADD, item->image, NULL,
+				       maskImage, 0, 0, 0, 0,
+				       item->x - x1, item->y - y1,
+				       item->width, item->height);
+	    }
 
-	pixman_composite_glyphs(op, srcImage, dstImage, format,
-				xSrc + srcXoff + extents.x1 - xDst, ySrc + srcYoff + extents.y1 - yDst,
-				extents.x1, extents.y1,
-				extents.x1 + dstXoff, extents.y1 + dstYoff,
-				extents.x2 - extents.x1,
-				extents.y2 - extents.y1,
-				glyphCache, n_glyphs, pglyphs);
+	    pixman_image_composite(op, srcImage, maskImage, dstImage,
+				   xSrc + srcXoff + x1 - xDst,
+				   ySrc + srcYoff + y1 - yDst,
+				   0, 0, x1 + dstXoff, y1 + dstYoff,
+				   x2 - x1, y2 - y1);
+	    pixman_image_unref(maskImage);
+	}
     }
     else {
-	pixman_composite_glyphs_no_mask(op, srcImage, dstImage,
-					xSrc + srcXoff - xDst, ySrc + srcYoff - yDst,
-					dstXoff, dstYoff,
-					glyphCache, n_glyphs, pglyphs);
+	for (i = 0; i < nitems; i++) {
+	    item = &items[i];
+	    pixman_image_composite(op, srcImage, item->image, dstImage,
+				   xSrc + srcXoff + item->x - xDst,
+				   ySrc + srcYoff + item->y - yDst,
+				   0, 0,
+				   item->x + dstXoff, item->y + dstYoff,
+				   item->width, item->height);
+	}
     }
 
     free_pixman_pict(pDst, dstImage);
@@ -211,9 +572,11 @@ out_free_src:
     free_pixman_pict(pSrc, srcImage);
 
 out:
-    pixman_glyph_cache_thaw(glyphCache);
-    if (pglyphs != stack_glyphs)
-	free(pglyphs);
+    for (i = 0; i < nitems; i++)
+	if (items[i].owned)
+	    pixman_image_unref(items[i].image);
+    if (items != stack_items)
+	ScratchFree(items);
 }
 
 static pixman_image_t *
@@ -502,6 +865,8 @@ fbPictureInit(ScreenPtr pScreen, PictFormatPtr formats, int nformats)
 
     if (!miPictureInit(pScreen, formats, nformats))
         return FALSE;
+    if (!fbGlyphAtlasInit(pScreen))
+        return FALSE;
     ps = GetPictureScreen(pScreen);
     ps->Composite = fbComposite;
     ps->Glyphs = fbGlyphs;
@@ -32,7 +32,7 @@ fbCloseScreen(ScreenPtr pScreen)
     int d;
     DepthPtr depths = pScreen->allowedDepths;
 
-    fbDestroyGlyphCache();
+    fbDestroyGlyphAtlas(pScreen);
     for (d = 0; d < pScreen->numDepths; d++)
         free(depths[d].vids);
     free(depths);
@@ -99,6 +99,7 @@ fbSetupScreen(ScreenPtr pScreen, void *pbits, /* pointer to screen bitmap */
 {                               /* bits per pixel for screen */
     if (!fbAllocatePrivates(pScreen))
         return FALSE;
+    fbBltInit();
     pScreen->defColormap = FakeClientID(0);
     /* let CreateDefColormap do whatever it wants for pixels */
     pScreen->blackPixel = pScreen->whitePixel = (Pixel) 0;
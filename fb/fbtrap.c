@@ -80,6 +80,169 @@ fbAddTriangles(PicturePtr pPicture,
     free_pixman_pict(pPicture, image);
 }
 
+/*
+ * Trapezoids drawn through a mask can be rasterized on the worker threads.
+ * The mask is cut into bands of rows, the trapezoids are binned by the
+ * rows they cover, and each band rasterizes its own trapezoids into its
+ * part of the mask; then the mask is composited in one go, as
+ * pixman_composite_trapezoids would.  Rasterizing adds coverage, and
+ * pixman steps the edges exactly, so a trapezoid cut by a band edge adds
+ * the same values either way and the mask comes out the same.
+ *
+ * That only covers operators for which the area outside the trapezoids is
+ * left alone; for the others pixman composites the whole destination.
+ * Triangles get here as pairs of trapezoids.
+ */
+
+#define FB_TRAP_BAND_MIN_ROWS   16
+
+typedef struct _FbTrapBands {
+    const xTrapezoid *traps;
+    pixman_image_t **images;    /* one per band, sharing the mask bits */
+    int *first;                 /* first entry in index for each band */
+    int *index;                 /* the trapezoids of each band, in order */
+    int x, y;                   /* mask origin */
+    int rows;                   /* rows per band */
+} FbTrapBandsRec;
+
+static Bool
+fbTrapBandsWanted(CARD8 op, PictFormatPtr maskFormat)
+{
+#ifdef FB_ACCESS_WRAPPER
+    return FALSE;
+#else
+    return maskFormat && (op == PictOpOver || op == PictOpAdd) &&
+        WorkerThreadMinPixels > 0 && WorkerThreadParallelism() > 1;
+#endif
+}
+
+static void
+fbTrapBand(void *data, int i)
+{
+    FbTrapBandsRec *bands = data;
+    int j;
+
+    for (j = bands->first[i]; j < bands->first[i + 1]; j++)
+        pixman_rasterize_trapezoid(bands->images[i],
+                                   (const pixman_trapezoid_t *)
+                                   &bands->traps[bands->index[j]],
+                                   -bands->x, -(bands->y + i * bands->rows));
+}
+
+/* The rows of the mask, from 0, that a trapezoid touches */
+static Bool
+fbTrapRows(const xTrapezoid *trap, int y, int height, int *y1, int *y2)
+{
+    if (!xTrapezoidValid(trap))
+        return FALSE;
+    *y1 = max(xFixedToInt(trap->top) - y, 0);
+    *y2 = min(xFixedToInt(xFixedCeil(trap->bottom)) - y, height);
+    return *y1 < *y2;
+}
+
+/**
+ * Composite the trapezoids through a mask rasterized in bands on the
+ * worker threads.  Returns FALSE, having drawn nothing, when that isn't
+ * worth it or memory runs out.
+ */
+static Bool
+fbTrapezoidBands(pixman_op_t op, pixman_image_t *src, pixman_image_t *dst,
+                 pixman_format_code_t format, PicturePtr pDst,
+                 int x_src, int y_src, int x_dst, int y_dst,
+                 int ntrap, const xTrapezoid *traps)
+{
+    FbTrapBandsRec bands = { traps };
+    BoxRec box, extents;
+    pixman_image_t *mask;
+    char *bits;
+    int stride, width, height, nbands, nindex, i, j, y1, y2;
+    Bool ret = FALSE;
+
+    /* the trapezoids, within the clip, in picture coordinates */
+    miTrapezoidBounds(ntrap, (xTrapezoid *) traps, &box);
+    extents = *RegionExtents(pDst->pCompositeClip);
+    box.x1 = max(box.x1, extents.x1 - pDst->pDrawable->x);
+    box.y1 = max(box.y1, extents.y1 - pDst->pDrawable->y);
+    box.x2 = min(box.x2, extents.x2 - pDst->pDrawable->x);
+    box.y2 = min(box.y2, extents.y2 - pDst->pDrawable->y);
+    if (box.x1 >= box.x2 || box.y1 >= box.y2)
+        return TRUE;
+    if (!fbBandsWanted(&box, 1, &extents))
+        return FALSE;
+
+    width = box.x2 - box.x1;
+    height = box.y2 - box.y1;
+    nbands = min(height / FB_TRAP_BAND_MIN_ROWS,
+                 WorkerThreadParallelism() * 4);
+    if (nbands < 2)
+        return FALSE;
+    bands.rows = (height + nbands - 1) / nbands;
+    nbands = (height + bands.rows - 1) / bands.rows;
+    bands.x = box.x1;
+    bands.y = box.y1;
+
+    mask = pixman_image_create_bits(format, width, height, NULL, 0);
+    bands.images = calloc(nbands, sizeof(pixman_image_t *));
+    bands.first = calloc(nbands + 1, sizeof(int));
+    if (!mask || !bands.images || !bands.first)
+        goto bail;
+
+    /* count the trapezoids in each band, then list them */
+    for (i = 0; i < ntrap; i++)
+        if (fbTrapRows(&traps[i], box.y1, height, &y1, &y2))
+            for (j = y1 / bands.rows; j <= (y2 - 1) / bands.rows; j++)
+                bands.first[j + 1]++;
+    for (j = 0; j < nbands; j++)
+        bands.first[j + 1] += bands.first[j];
+    nindex = bands.first[nbands];
+    if (!nindex) {
+        ret = TRUE;
+        goto bail;
+    }
+    bands.index = xallocarray(nindex, sizeof(int));
+    if (!bands.index)
+        goto bail;
+    for (i = 0; i < ntrap; i++)
+        if (fbTrapRows(&traps[i], box.y1, height, &y1, &y2))
+            for (j = y1 / bands.rows; j <= (y2 - 1) / bands.rows; j++)
+                bands.index[bands.first[j]++] = i;
+    /* each first now points at the start of the next band */
+    memmove(bands.first + 1, bands.first, nbands * sizeof(int));
+    bands.first[0] = 0;
+
+    bits = (char *) pixman_image_get_data(mask);
+    stride = pixman_image_get_stride(mask);
+    for (j = 0; j < nbands; j++) {
+        bands.images[j] =
+            pixman_image_create_bits(format, width,
+                                     min(bands.rows, height - j * bands.rows),
+                                     (uint32_t *) (bits +
+                                                   j * bands.rows * stride),
+                                     stride);
+        if (!bands.images[j])
+            goto bail;
+    }
+
+    WorkerThreadRun(fbTrapBand, &bands, nbands);
+
+    pixman_image_composite(op, src, mask, dst,
+                           x_src + box.x1, y_src + box.y1, 0, 0,
+                           x_dst + box.x1, y_dst + box.y1, width, height);
+    ret = TRUE;
+
+ bail:
+    if (bands.images)
+        for (j = 0; j < nbands; j++)
+            if (bands.images[j])
+                pixman_image_unref(bands.images[j]);
+    free(bands.images);
+    free(bands.first);
+    free(bands.index);
+    if (mask)
+        pixman_image_unref(mask);
+    return ret;
+}
+
 typedef void (*CompositeShapesFunc) (pixman_op_t op,
                                      pixman_image_t * src,
                                      pixman_image_t * dst,
@@ -142,9 +305,16 @@ fbShapes(CompositeShapesFunc composite,
                 break;
             }
 
-            composite(op, src, dst, format,
-                      xSrc + src_xoff,
-                      ySrc + src_yoff, dst_xoff, dst_yoff, nshapes, shapes);
+            if (composite != (CompositeShapesFunc) pixman_composite_trapezoids
+                || !fbTrapBandsWanted(op, maskFormat)
+                || !fbTrapezoidBands(op, src, dst, format, pDst,
+                                     xSrc + src_xoff, ySrc + src_yoff,
+                                     dst_xoff, dst_yoff, nshapes,
+                                     (const xTrapezoid *) shapes))
+                composite(op, src, dst, format,
+                          xSrc + src_xoff,
+                          ySrc + src_yoff, dst_xoff, dst_yoff, nshapes,
+                          shapes);
         }
 
         DamageRegionProcessPending(pDst->pDrawable);
@@ -169,6 +339,54 @@ fbTrapezoids(CARD8 op,
              xSrc, ySrc, ntrap, sizeof(xTrapezoid), (const uint8_t *) traps);
 }
 
+/* Split a triangle into the two trapezoids above and below its middle
+ * point, as pixman_composite_triangles does */
+static void
+fbTriangleToTrapezoids(const xTriangle *tri, xTrapezoid *traps)
+{
+    const xPointFixed *top = &tri->p1, *left = &tri->p2, *right = &tri->p3;
+    const xPointFixed *tmp;
+
+    if (left->y < top->y) {
+        tmp = left;
+        left = top;
+        top = tmp;
+    }
+    if (right->y < top->y) {
+        tmp = right;
+        right = top;
+        top = tmp;
+    }
+    /* left is the one whose edge from the top runs further left */
+    if ((int64_t) (left->x - top->x) * (right->y - top->y) -
+        (int64_t) (left->y - top->y) * (right->x - top->x) > 0) {
+        tmp = right;
+        right = left;
+        left = tmp;
+    }
+
+    traps[0].top = top->y;
+    traps[0].bottom = min(left->y, right->y);
+    traps[0].left.p1 = *top;
+    traps[0].left.p2 = *left;
+    traps[0].right.p1 = *top;
+    traps[0].right.p2 = *right;
+
+    traps[1] = traps[0];
+    if (right->y < left->y) {
+        traps[1].top = right->y;
+        traps[1].bottom = left->y;
+        traps[1].right.p1 = *right;
+        traps[1].right.p2 = *left;
+    }
+    else {
+        traps[1].top = left->y;
+        traps[1].bottom = right->y;
+        traps[1].left.p1 = *left;
+        traps[1].left.p2 = *right;
+    }
+}
+
 void
 fbTriangles(CARD8 op,
             PicturePtr pSrc,
@@ -179,6 +397,21 @@ fbTriangles(CARD8 op,
     xSrc -= (tris[0].p1.x >> 16);
     ySrc -= (tris[0].p1.y >> 16);
 
+    if (fbTrapBandsWanted(op, maskFormat)) {
+        xTrapezoid *traps = xallocarray(ntris, 2 * sizeof(xTrapezoid));
+        int i;
+
+        if (traps) {
+            for (i = 0; i < ntris; i++)
+                fbTriangleToTrapezoids(&tris[i], &traps[2 * i]);
+            fbShapes((CompositeShapesFunc) pixman_composite_trapezoids,
+                     op, pSrc, pDst, maskFormat, xSrc, ySrc, 2 * ntris,
+                     sizeof(xTrapezoid), (const uint8_t *) traps);
+            free(traps);
+            return;
+        }
+    }
+
     fbShapes((CompositeShapesFunc) pixman_composite_triangles,
              op, pSrc, pDst, maskFormat,
              xSrc, ySrc, ntris, sizeof(xTriangle), (const uint8_t *) tris);
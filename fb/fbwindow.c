@@ -151,45 +151,83 @@ fbChangeWindowAttributes(WindowPtr pWin, unsigned long mask)
     return TRUE;
 }
 
-void
-fbFillRegionSolid(DrawablePtr pDrawable,
-                  RegionPtr pRegion, FbBits and, FbBits xor)
-{
+typedef struct _FbFillRegion {
+    DrawablePtr pDrawable;
     FbBits *dst;
     FbStride dstStride;
     int dstBpp;
     int dstXoff, dstYoff;
-    int n = RegionNumRects(pRegion);
-    BoxPtr pbox = RegionRects(pRegion);
+    BoxPtr pbox;
+    int nbox;
+    FbBits and, xor;
+} FbFillRegionRec;
+
+/* fill the parts of the boxes inside band */
+static void
+fbFillRegionBand(void *closure, BoxPtr band)
+{
+    FbFillRegionRec *fill = closure;
+    FbBits *dst = fill->dst;
+    FbStride dstStride = fill->dstStride;
+    int dstBpp = fill->dstBpp;
+    int n = fill->nbox;
+    BoxPtr pbox = fill->pbox;
+    BoxRec box;
 
 #ifndef FB_ACCESS_WRAPPER
     int try_mmx = 0;
 
-    if (!and)
+    if (!fill->and)
         try_mmx = 1;
 #endif
 
-    fbGetDrawable(pDrawable, dst, dstStride, dstBpp, dstXoff, dstYoff);
-
-    while (n--) {
+    for (; n--; pbox++) {
+        box.x1 = max(pbox->x1, band->x1);
+        box.y1 = max(pbox->y1, band->y1);
+        box.x2 = min(pbox->x2, band->x2);
+        box.y2 = min(pbox->y2, band->y2);
+        if (box.x1 >= box.x2 || box.y1 >= box.y2)
+            continue;
 #ifndef FB_ACCESS_WRAPPER
         if (!try_mmx || !pixman_fill((uint32_t *) dst, dstStride, dstBpp,
-                                     pbox->x1 + dstXoff, pbox->y1 + dstYoff,
-                                     (pbox->x2 - pbox->x1),
-                                     (pbox->y2 - pbox->y1), xor)) {
+                                     box.x1 + fill->dstXoff,
+                                     box.y1 + fill->dstYoff,
+                                     (box.x2 - box.x1),
+                                     (box.y2 - box.y1), fill->xor)) {
 #endif
-            fbSolid(dst + (pbox->y1 + dstYoff) * dstStride,
+            fbSolid(dst + (box.y1 + fill->dstYoff) * dstStride,
                     dstStride,
-                    (pbox->x1 + dstXoff) * dstBpp,
+                    (box.x1 + fill->dstXoff) * dstBpp,
                     dstBpp,
-                    (pbox->x2 - pbox->x1) * dstBpp,
-                    pbox->y2 - pbox->y1, and, xor);
+                    (box.x2 - box.x1) * dstBpp,
+                    box.y2 - box.y1, fill->and, fill->xor);
 #ifndef FB_ACCESS_WRAPPER
         }
 #endif
-        fbValidateDrawable(pDrawable);
-        pbox++;
+        fbValidateDrawable(fill->pDrawable);
     }
+}
+
+void
+fbFillRegionSolid(DrawablePtr pDrawable,
+                  RegionPtr pRegion, FbBits and, FbBits xor)
+{
+    FbFillRegionRec fill;
+    BoxRec extents;
+
+    fill.pDrawable = pDrawable;
+    fill.pbox = RegionRects(pRegion);
+    fill.nbox = RegionNumRects(pRegion);
+    fill.and = and;
+    fill.xor = xor;
+
+    fbGetDrawable(pDrawable, fill.dst, fill.dstStride, fill.dstBpp,
+                  fill.dstXoff, fill.dstYoff);
+
+    if (fbBandsWanted(fill.pbox, fill.nbox, &extents))
+        fbRunBands(&extents, fbFillRegionBand, &fill);
+    else
+        fbFillRegionBand(&fill, RegionExtents(pRegion));
 
     fbFinishAccess(pDrawable);
 }
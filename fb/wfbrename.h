@@ -4,10 +4,13 @@
 #define fbArc16 wfbArc16
 #define fbArc32 wfbArc32
 #define fbArc8 wfbArc8
+#define fbBandsWanted wfbBandsWanted
 #define fbBlt wfbBlt
+#define fbBltInit wfbBltInit
 #define fbBltOne wfbBltOne
 #define fbBltPlane wfbBltPlane
 #define fbBltStip wfbBltStip
+#define fbBltUseSimd wfbBltUseSimd
 #define fbBres wfbBres
 #define fbBresDash wfbBresDash
 #define fbBresDash16 wfbBresDash16
@@ -35,6 +38,7 @@
 #define fbCreateGC wfbCreateGC
 #define fbCreatePixmap wfbCreatePixmap
 #define fbCreateWindow wfbCreateWindow
+#define fbDestroyGlyphAtlas wfbDestroyGlyphAtlas
 #define fbDestroyGlyphCache wfbDestroyGlyphCache
 #define fbDestroyPixmap wfbDestroyPixmap
 #define fbDestroyWindow wfbDestroyWindow
@@ -51,6 +55,7 @@
 #define fbGCFuncs wfbGCFuncs
 #define fbGCOps wfbGCOps
 #define fbGeneration wfbGeneration
+#define fbGetGlyphAtlasStats wfbGetGlyphAtlasStats
 #define fbGetImage wfbGetImage
 #define fbGetScreenPrivateKey wfbGetScreenPrivateKey
 #define fbGetSpans wfbGetSpans
@@ -58,6 +63,7 @@
 #define fbGlyph16 wfbGlyph16
 #define fbGlyph32 wfbGlyph32
 #define fbGlyph8 wfbGlyph8
+#define fbGlyphAtlasPages wfbGlyphAtlasPages
 #define fbGlyphs wfbGlyphs
 #define fbImageGlyphBlt wfbImageGlyphBlt
 #define fbIn wfbIn
@@ -106,6 +112,8 @@
 #define fbRealizeFont wfbRealizeFont
 #define fbReplicatePixel wfbReplicatePixel
 #define fbResolveColor wfbResolveColor
+#define fbRunBands wfbRunBands
+#define fbRunColumns wfbRunColumns
 #define fbScreenPrivateKeyRec wfbScreenPrivateKeyRec
 #define fbSegment wfbSegment
 #define fbSelectBres wfbSelectBres
@@ -464,16 +464,16 @@ glamor_init(ScreenPtr screen, unsigned int flags)
 
     glamor_set_screen_private(screen, glamor_priv);
 
-    if (!dixRegisterPrivateKey(&glamor_pixmap_private_key, PRIVATE_PIXMAP,
-                               sizeof(struct glamor_pixmap_private))) {
+    if (!dixRegisterHotPrivateKey(&glamor_pixmap_private_key, PRIVATE_PIXMAP,
+                                  sizeof(struct glamor_pixmap_private))) {
         LogMessage(X_WARNING,
                    "glamor%d: Failed to allocate pixmap private\n",
                    screen->myNum);
         goto free_glamor_private;
     }
 
-    if (!dixRegisterPrivateKey(&glamor_gc_private_key, PRIVATE_GC,
-                               sizeof (glamor_gc_private))) {
+    if (!dixRegisterHotPrivateKey(&glamor_gc_private_key, PRIVATE_GC,
+                                  sizeof (glamor_gc_private))) {
         LogMessage(X_WARNING,
                    "glamor%d: Failed to allocate gc private\n",
                    screen->myNum);
@@ -242,6 +242,8 @@ ddxUseMsg(void)
     ErrorF("-linebias n            adjust thin line pixelization\n");
     ErrorF("-blackpixel n          pixel value for black\n");
     ErrorF("-whitepixel n          pixel value for white\n");
+    ErrorF("-glyphatlas n          glyph atlas pages per format (default %d)\n",
+           fbGlyphAtlasPages);
 
 #ifdef HAVE_MMAP
     ErrorF
@@ -356,6 +358,12 @@ ddxProcessArgument(int argc, char *argv[], int i)
         return 2;
     }
 
+    if (strcmp(argv[i], "-glyphatlas") == 0) {  /* -glyphatlas n */
+        CHECK_FOR_REQUIRED_ARGUMENTS(1);
+        fbGlyphAtlasPages = atoi(argv[++i]);
+        return 2;
+    }
+
     if (strcmp(argv[i], "-linebias") == 0) {    /* -linebias n */
         CHECK_FOR_REQUIRED_ARGUMENTS(1);
         currentScreen->lineBias = atoi(argv[++i]);
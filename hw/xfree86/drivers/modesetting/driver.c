@@ -1352,6 +1352,8 @@ CreateScreenResources(ScreenPtr pScreen)
         if (!shadowAdd(pScreen, rootPixmap, msUpdatePacked, msShadowWindow,
                        0, 0))
             return FALSE;
+        /* msShadowWindow only computes an address in the front buffer */
+        shadowSetThreaded(pScreen, TRUE);
     }
 
     err = drmModeDirtyFB(ms->fd, ms->drmmode.fb_id, NULL, 0);
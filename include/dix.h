@@ -459,6 +459,9 @@ FixKeyState(DeviceEvent * /* event */ ,
 extern void
 RecalculateDeliverableEvents(WindowPtr /* pWin */ );
 
+extern void
+InvalidateInputRecipients(WindowPtr /* pWin */ );
+
 extern _X_EXPORT int
 OtherClientGone(void *value,
                 XID id);
@@ -73,6 +73,35 @@ typedef struct _saveSet {
 #define SaveSetAssignToRoot(ss,tr)  ((ss).toRoot = (tr))
 #define SaveSetAssignMap(ss,m)      ((ss).map = (m))
 
+/*
+ * Scheduling classes, lowest to highest rank.  A class which has used up
+ * its budget for the current period ranks below all the others until the
+ * period ends.
+ */
+typedef enum _SmartScheduleClass {
+    SMART_CLASS_BULK,
+    SMART_CLASS_NORMAL,
+    SMART_CLASS_INTERACTIVE,
+    SMART_CLASS_COMPOSITOR,
+    SMART_NUM_CLASSES
+} SmartScheduleClass;
+
+typedef struct _SmartScheduleClassRec {
+    const char *name;
+    long slice;                 /* ms per turn, 0 for SmartScheduleSlice */
+    long budget;                /* ms per period, 0 for unlimited */
+    long used;                  /* ms used in the current period */
+} SmartScheduleClassRec, *SmartScheduleClassPtr;
+
+/* per-client scheduler statistics, all times in ms */
+typedef struct _SmartScheduleStats {
+    unsigned long turns;        /* times picked to run */
+    unsigned long exhausted;    /* turns cut short by the slice */
+    unsigned long run_time;
+    unsigned long wait_time;    /* ready but waiting for other clients */
+    unsigned long max_wait;
+} SmartScheduleStatsRec, *SmartScheduleStatsPtr;
+
 typedef struct _Client {
     void *requestBuffer;
     void *osPrivate;             /* for OS layer, including scheduler */
@@ -108,6 +137,11 @@ typedef struct _Client {
 
     int smart_start_tick;
     int smart_stop_tick;
+    int smart_ready_tick;       /* when the client last started waiting */
+    unsigned char smart_class;  /* SmartScheduleClass */
+    Bool smart_class_fixed;     /* class set explicitly, not by heuristics */
+    int smart_redirects;        /* manual Composite redirects held */
+    SmartScheduleStatsRec smart_stats;
 
     DeviceIntPtr clientPtr;
     ClientIdPtr clientIds;
@@ -182,8 +216,33 @@ static inline Bool any_output_pending(void) {
 #define SMART_MAX_PRIORITY  (20)
 #define SMART_MIN_PRIORITY  (-20)
 
+/* clients whose smart_priority sinks this far are treated as bulk */
+#define SMART_BULK_PRIORITY (-10)
+
 extern void SmartScheduleInit(void);
 
+extern Bool SmartScheduleClassesEnable;
+extern SmartScheduleClassRec SmartScheduleClasses[SMART_NUM_CLASSES];
+
+extern void SmartScheduleSetClientClass(ClientPtr client,
+                                        SmartScheduleClass class);
+extern void SmartScheduleCompositorRedirect(ClientPtr client, Bool hold);
+extern void SmartScheduleLogStats(ClientPtr client);
+extern Bool SmartScheduleParseClass(const char *name, const char *slice,
+                                    const char *budget);
+
+/*
+ * Request statistics, see dix/reqstats.c
+ */
+extern Bool RequestStatsEnabled;
+extern volatile Bool RequestStatsPending;
+
+extern void RequestStatsInit(void);
+extern void RequestStatsFini(void);
+extern uint64_t RequestStatsTime(void);
+extern void RequestStatsDone(ClientPtr client, uint64_t start);
+extern void RequestStatsSignaled(void);
+
 /* This prototype is used pervasively in Xext, dix */
 #define DISPATCH_PROC(func) int func(ClientPtr /* client */)
 
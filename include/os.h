@@ -127,6 +127,22 @@ extern _X_EXPORT void SetCriticalOutputPending(void);
 extern _X_EXPORT int WriteToClient(ClientPtr /*who */ , int /*count */ ,
                                    const void * /*buf */ );
 
+typedef struct _OsBuffer *OsBufferPtr;
+
+extern _X_EXPORT OsBufferPtr OsBufferAlloc(int /*size */ );
+
+extern _X_EXPORT void *OsBufferData(OsBufferPtr /*buffer */ );
+
+extern _X_EXPORT void OsBufferRef(OsBufferPtr /*buffer */ );
+
+extern _X_EXPORT void OsBufferUnref(OsBufferPtr /*buffer */ );
+
+extern _X_EXPORT Bool OsBufferIsShared(OsBufferPtr /*buffer */ );
+
+extern _X_EXPORT int WriteBufferToClient(ClientPtr /*who */ , int /*count */ ,
+                                         const void * /*buf */ ,
+                                         OsBufferPtr /*buffer */ );
+
 extern _X_EXPORT void ResetOsBuffers(void);
 
 extern _X_EXPORT void InitConnectionLimits(void);
@@ -194,6 +210,8 @@ typedef CARD32 (*OsTimerCallback) (OsTimerPtr timer,
                                    CARD32 time,
                                    void *arg);
 
+extern _X_EXPORT int TimerSlack;
+
 extern _X_EXPORT void TimerInit(void);
 
 extern _X_EXPORT Bool TimerForce(OsTimerPtr /* timer */ );
@@ -718,4 +736,59 @@ os_move_fd(int fd);
 extern _X_EXPORT int
 xthread_sigmask(int how, const sigset_t *set, sigset_t *oldest);
 
+extern _X_EXPORT int ReaderThreadCount;
+
+extern _X_EXPORT Bool OsPollUring;
+
+extern void
+ReaderThreadInit(void);
+
+extern void
+ReaderThreadFini(void);
+
+extern _X_EXPORT int WorkerThreadCount;
+extern _X_EXPORT int WorkerThreadMinPixels;
+
+typedef void (*WorkerThreadProc) (void *data, int job);
+
+extern _X_EXPORT int
+WorkerThreadParallelism(void);
+
+extern _X_EXPORT void
+WorkerThreadRun(WorkerThreadProc proc, void *data, int njobs);
+
+extern void
+WorkerThreadFini(void);
+
+/*
+ * Memory for use within one request, all freed by ScratchReset.  Main
+ * thread only.
+ */
+extern _X_EXPORT unsigned long ScratchAllocCount;
+extern _X_EXPORT unsigned long ScratchMallocCount;
+
+extern _X_EXPORT void *
+ScratchAlloc(size_t size);
+
+extern _X_EXPORT void *
+ScratchAllocArray(size_t nmemb, size_t size);
+
+extern _X_EXPORT void
+ScratchFree(void *ptr);
+
+extern void
+ScratchReset(void);
+
+/* Where the arena was, to free everything allocated since at once */
+typedef struct _ScratchMark {
+    void *chunk;
+    char *top;
+} ScratchMarkRec, *ScratchMarkPtr;
+
+extern _X_EXPORT void
+ScratchMark(ScratchMarkPtr mark);
+
+extern _X_EXPORT void
+ScratchRelease(ScratchMarkPtr mark);
+
 #endif                          /* OS_H */
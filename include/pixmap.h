@@ -112,6 +112,12 @@ extern _X_EXPORT PixmapPtr AllocatePixmap(ScreenPtr /*pScreen */ ,
 
 extern _X_EXPORT void FreePixmap(PixmapPtr /*pPixmap */ );
 
+extern size_t PixmapPoolLimit;
+
+extern void FreePixmapPool(void);
+
+extern void PixmapPoolLogStats(void);
+
 extern _X_EXPORT PixmapPtr
 PixmapShareToSlave(PixmapPtr pixmap, ScreenPtr slave);
 
@@ -100,6 +100,22 @@ typedef struct _DevScreenPrivateKeyRec {
 extern _X_EXPORT Bool
  dixRegisterPrivateKey(DevPrivateKey key, DevPrivateType type, unsigned size);
 
+#define HAS_DIXREGISTERHOTPRIVATEKEY	1
+
+/*
+ * Register a private key like dixRegisterPrivateKey, for a private that is
+ * used on nearly every operation on the object, like a wrapper's GC or
+ * pixmap private.  Hot privates are kept together at the start of the
+ * private storage, ahead of all the others, so they share cache lines.
+ *
+ * Only types whose objects are all created after their keys are
+ * registered have hot privates; for screens, clients, extensions,
+ * colormaps and devices this is the same as dixRegisterPrivateKey.
+ */
+extern _X_EXPORT Bool
+ dixRegisterHotPrivateKey(DevPrivateKey key, DevPrivateType type,
+                          unsigned size);
+
 /*
  * Check whether a private key has been registered
  */
@@ -336,6 +352,12 @@ extern _X_EXPORT int
 extern void
  dixPrivateUsage(void);
 
+/*
+ * Log the offset and size of each private, by type, at the given verbosity
+ */
+extern void
+ dixPrivateLayout(int verb);
+
 /*
  * Resets the privates subsystem.  dixResetPrivates is called from the main loop
  * before each server generation.  This function must only be called by main().
@@ -212,6 +212,9 @@ RegionNull(RegionPtr _pReg)
 
 extern _X_EXPORT void InitRegions(void);
 
+/* FALSE forces the scalar band kernels in dix/region.c */
+extern _X_EXPORT Bool regionUseSimd;
+
 extern _X_EXPORT RegionPtr RegionCreate(BoxPtr /*rect */ ,
                                         int /*size */ );
 
@@ -78,6 +78,14 @@ extern _X_EXPORT void miPolyArc(DrawablePtr /*pDraw */ ,
                                 xArc *  /*parcs */
     );
 
+extern _X_EXPORT Bool miArcCacheEnabled;
+extern _X_EXPORT unsigned long miArcCacheHits;
+extern _X_EXPORT unsigned long miArcCacheMisses;
+
+extern _X_EXPORT void miArcCacheFlush(void);
+
+extern _X_EXPORT void miArcCacheLogStats(void);
+
 /* mibitblt.c */
 
 extern _X_EXPORT RegionPtr miCopyArea(DrawablePtr /*pSrcDrawable */ ,
@@ -406,6 +414,17 @@ extern _X_EXPORT int miValidateTree(WindowPtr /*pParent */ ,
                                     VTKind      /*kind */
     );
 
+typedef struct _miValidateStats {
+    unsigned int revalidated;   /* windows whose clips were recomputed */
+    unsigned int skipped;       /* marked subtrees left untouched */
+} miValidateStatsRec;
+
+/* counts for the most recent miValidateTree call */
+extern _X_EXPORT miValidateStatsRec miValidateTreeStats;
+
+/* FALSE makes miValidateTree recompute every marked window */
+extern _X_EXPORT Bool miValidateTreeIncremental;
+
 extern _X_EXPORT void miWideLine(DrawablePtr /*pDrawable */ ,
                                  GCPtr /*pGC */ ,
                                  int /*mode */ ,
@@ -480,6 +499,12 @@ extern _X_EXPORT void miMarkUnrealizedWindow(WindowPtr /*pChild */ ,
 
 extern _X_EXPORT WindowPtr miSpriteTrace(SpritePtr pSprite, int x, int y);
 
+extern _X_EXPORT void miPickWindowsChanged(ScreenPtr pScreen);
+
+extern Bool miPickScreenInit(ScreenPtr pScreen);
+
+extern void miPickScreenClose(ScreenPtr pScreen);
+
 extern _X_EXPORT WindowPtr miXYToWindow(ScreenPtr pScreen, SpritePtr pSprite, int x, int y);
 
 /* mizerarc.c */
@@ -58,6 +58,7 @@ SOFTWARE.
 #include "scrnintstr.h"
 #include "pixmapstr.h"
 #include "windowstr.h"
+#include "list.h"
 #include "mifpoly.h"
 #include "mi.h"
 #include "mifillarc.h"
@@ -225,7 +226,24 @@ typedef struct {
     char top, bot, hole;
 } miArcSpanData;
 
-static void fillSpans(DrawablePtr pDrawable, GCPtr pGC);
+typedef struct _miArcCacheKey {
+    int width, height;
+    int angle1, angle2;
+    int lineWidth;
+    Bool filled;                /* spans of miFillWideEllipse, unsorted */
+} miArcCacheKeyRec, *miArcCacheKeyPtr;
+
+typedef struct _miArcCacheEntry {
+    struct xorg_list list;
+    miArcCacheKeyRec key;
+    miArcFaceRec bounds[2];
+    int nspans;
+    DDXPointPtr points;         /* relative to the x and y of the arc */
+    int *widths;
+} miArcCacheEntryRec, *miArcCacheEntryPtr;
+
+static miArcCacheEntryPtr fillSpans(DrawablePtr pDrawable, GCPtr pGC,
+                                    miArcCacheKeyPtr key, int xorg, int yorg);
 static void newFinalSpan(int y, int xmin, int xmax);
 static miArcSpanData *drawArc(xArc * tarc, int l, int a0, int a1,
                               miArcFacePtr right, miArcFacePtr left,
@@ -767,6 +785,158 @@ miComputeWideEllipse(int lw, xArc * parc)
     return spdata;
 }
 
+/*
+ * The spans of arcs drawn on their own are kept in a small cache, most
+ * recently used first, so that drawing the same marker or radio button
+ * over and over rasterizes it once.  An arc covers the same pixels
+ * wherever it is drawn, so the spans are kept relative to its x and y and
+ * moved into place when filled.  The faces at the ends of the arc are
+ * relative to its center already and are kept as they are; caps and joins
+ * are drawn from them as before.
+ */
+
+#define MI_ARC_CACHE_ENTRIES    32
+#define MI_ARC_CACHE_MAX_SPANS  2048
+
+static struct xorg_list miArcCache = {
+    .next = &miArcCache,
+    .prev = &miArcCache,
+};
+static int miArcCacheCount;
+
+Bool miArcCacheEnabled = TRUE;
+unsigned long miArcCacheHits;
+unsigned long miArcCacheMisses;
+
+static void
+miArcCacheKey(miArcCacheKeyPtr key, xArc * parc, int lw, Bool filled)
+{
+    memset(key, 0, sizeof(*key));
+    key->width = parc->width;
+    key->height = parc->height;
+    if (!filled) {
+        key->angle1 = parc->angle1;
+        key->angle2 = parc->angle2;
+    }
+    key->lineWidth = lw;
+    key->filled = filled;
+}
+
+static miArcCacheEntryPtr
+miArcCacheLookup(miArcCacheKeyPtr key)
+{
+    miArcCacheEntryPtr entry;
+
+    if (!miArcCacheEnabled)
+        return NULL;
+    xorg_list_for_each_entry(entry, &miArcCache, list) {
+        if (memcmp(&entry->key, key, sizeof(*key)) == 0) {
+            xorg_list_del(&entry->list);
+            xorg_list_add(&entry->list, &miArcCache);
+            miArcCacheHits++;
+            return entry;
+        }
+    }
+    miArcCacheMisses++;
+    return NULL;
+}
+
+/*
+ * Keep a copy of the spans of an arc at xorg, yorg, dropping the least
+ * recently used arc when the cache is full.
+ */
+static miArcCacheEntryPtr
+miArcCacheStore(miArcCacheKeyPtr key, int nspans, DDXPointPtr points,
+                int *widths, int xorg, int yorg)
+{
+    miArcCacheEntryPtr entry;
+    int i;
+
+    if (!miArcCacheEnabled || nspans > MI_ARC_CACHE_MAX_SPANS)
+        return NULL;
+    if (miArcCacheCount == MI_ARC_CACHE_ENTRIES) {
+        entry = xorg_list_last_entry(&miArcCache, miArcCacheEntryRec, list);
+        xorg_list_del(&entry->list);
+        free(entry);
+        miArcCacheCount--;
+    }
+    entry = malloc(sizeof(miArcCacheEntryRec) +
+                   nspans * (sizeof(DDXPointRec) + sizeof(int)));
+    if (!entry)
+        return NULL;
+    entry->key = *key;
+    memset(entry->bounds, 0, sizeof(entry->bounds));
+    entry->nspans = nspans;
+    entry->points = (DDXPointPtr) (entry + 1);
+    entry->widths = (int *) (entry->points + nspans);
+    for (i = 0; i < nspans; i++) {
+        entry->points[i].x = points[i].x - xorg;
+        entry->points[i].y = points[i].y - yorg;
+        entry->widths[i] = widths[i];
+    }
+    xorg_list_add(&entry->list, &miArcCache);
+    miArcCacheCount++;
+    return entry;
+}
+
+/*
+ * Fill the spans of a cached arc at xorg, yorg.
+ */
+static void
+miArcCacheFill(DrawablePtr pDraw, GCPtr pGC, miArcCacheEntryPtr entry,
+               int xorg, int yorg)
+{
+    DDXPointPtr points;
+    int *widths;
+    int i;
+
+    if (!entry->nspans)
+        return;
+    points = ScratchAllocArray(entry->nspans, sizeof(DDXPointRec));
+    widths = ScratchAllocArray(entry->nspans, sizeof(int));
+    if (points && widths) {
+        for (i = 0; i < entry->nspans; i++) {
+            points[i].x = entry->points[i].x + xorg;
+            points[i].y = entry->points[i].y + yorg;
+            widths[i] = entry->widths[i];
+        }
+        (*pGC->ops->FillSpans) (pDraw, pGC, entry->nspans, points, widths,
+                                !entry->key.filled);
+    }
+    ScratchFree(widths);
+    ScratchFree(points);
+}
+
+/**
+ * Free the cached arcs at server reset.
+ */
+void
+miArcCacheFlush(void)
+{
+    miArcCacheEntryPtr entry, tmp;
+
+    xorg_list_for_each_entry_safe(entry, tmp, &miArcCache, list) {
+        xorg_list_del(&entry->list);
+        free(entry);
+    }
+    miArcCacheCount = 0;
+}
+
+/**
+ * Log how well the arc span cache has done since the server started.
+ */
+void
+miArcCacheLogStats(void)
+{
+    unsigned long lookups = miArcCacheHits + miArcCacheMisses;
+
+    if (!lookups)
+        return;
+    LogMessageVerb(X_INFO, 0,
+                   "Arc span cache: %lu of %lu arcs reused (%.1f%%)\n",
+                   miArcCacheHits, lookups, 100.0 * miArcCacheHits / lookups);
+}
+
 static void
 miFillWideEllipse(DrawablePtr pDraw, GCPtr pGC, xArc * parc)
 {
@@ -776,9 +946,25 @@ miFillWideEllipse(DrawablePtr pDraw, GCPtr pGC, xArc * parc)
     int *wids;
     miArcSpanData *spdata;
     miArcSpan *span;
+    miArcCacheKeyRec key;
+    miArcCacheEntryPtr cached;
+    int x, y;
     int xorg, yorgu, yorgl;
     int n;
 
+    x = parc->x;
+    y = parc->y;
+    if (pGC->miTranslate) {
+        x += pDraw->x;
+        y += pDraw->y;
+    }
+    miArcCacheKey(&key, parc, pGC->lineWidth, TRUE);
+    cached = miArcCacheLookup(&key);
+    if (cached) {
+        miArcCacheFill(pDraw, pGC, cached, x, y);
+        return;
+    }
+
     yorgu = parc->height + pGC->lineWidth;
     n = (sizeof(int) * 2) * yorgu;
     widths = malloc(n + (sizeof(DDXPointRec) * 2) * yorgu);
@@ -869,6 +1055,8 @@ miFillWideEllipse(DrawablePtr pDraw, GCPtr pGC, xArc * parc)
         }
     }
     free(spdata);
+    if (pts > points)
+        miArcCacheStore(&key, pts - points, points, widths, x, y);
     (*pGC->ops->FillSpans) (pDraw, pGC, pts - points, points, widths, FALSE);
 
     free(widths);
@@ -911,7 +1099,7 @@ miWideArc(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs)
             spdata = miArcSegment(pDraw, pGC, *parc, NULL, NULL, NULL);
             free(spdata);
         }
-        fillSpans(pDraw, pGC);
+        fillSpans(pDraw, pGC, NULL, 0, 0);
         return;
     }
 
@@ -1036,21 +1224,54 @@ miWideArc(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs)
         }
         for (i = 0; i < polyArcs[iphase].narcs; i++) {
             miArcDataPtr arcData;
+            miArcCacheKeyRec key;
+            miArcCacheKeyPtr keyp = NULL;
+            miArcCacheEntryPtr cached = NULL;
+            int xorg = 0, yorg = 0;
 
             arcData = &polyArcs[iphase].arcs[i];
-            if (spdata) {
-                if (lastArc.width != arcData->arc.width ||
-                    lastArc.height != arcData->arc.height) {
-                    free(spdata);
-                    spdata = NULL;
+            /* an arc filled on its own can come from the cache */
+            if (arcData->render &&
+                (i == 0 || polyArcs[iphase].arcs[i - 1].render) &&
+                arcData->arc.width && arcData->arc.height) {
+                miArcCacheKey(&key, &arcData->arc, width, FALSE);
+                keyp = &key;
+                xorg = arcData->arc.x;
+                yorg = arcData->arc.y;
+                if (pGCTo->miTranslate) {
+                    xorg += pDrawTo->x;
+                    yorg += pDrawTo->y;
+                }
+                cached = miArcCacheLookup(&key);
+            }
+            if (cached) {
+                memcpy(arcData->bounds, cached->bounds,
+                       sizeof(arcData->bounds));
+                miArcCacheFill(pDrawTo, pGCTo, cached, xorg, yorg);
+            }
+            else {
+                if (spdata) {
+                    if (lastArc.width != arcData->arc.width ||
+                        lastArc.height != arcData->arc.height) {
+                        free(spdata);
+                        spdata = NULL;
+                    }
                 }
+                memcpy(&lastArc, &arcData->arc, sizeof(xArc));
+                spdata = miArcSegment(pDrawTo, pGCTo, arcData->arc,
+                                      &arcData->bounds[RIGHT_END],
+                                      &arcData->bounds[LEFT_END], spdata);
+                /* out of memory: nothing drawn, and no faces to keep */
+                if (!spdata)
+                    keyp = NULL;
             }
-            memcpy(&lastArc, &arcData->arc, sizeof(xArc));
-            spdata = miArcSegment(pDrawTo, pGCTo, arcData->arc,
-                                  &arcData->bounds[RIGHT_END],
-                                  &arcData->bounds[LEFT_END], spdata);
             if (polyArcs[iphase].arcs[i].render) {
-                fillSpans(pDrawTo, pGCTo);
+                if (!cached) {
+                    cached = fillSpans(pDrawTo, pGCTo, keyp, xorg, yorg);
+                    if (cached)
+                        memcpy(cached->bounds, arcData->bounds,
+                               sizeof(cached->bounds));
+                }
                 /* don't cap self-joining arcs */
                 if (polyArcs[iphase].arcs[i].selfJoin &&
                     cap[iphase] < polyArcs[iphase].arcs[i].cap)
@@ -2218,7 +2439,8 @@ miComputeArcs(xArc * parcs, int narcs, GCPtr pGC)
                 iphase = iphaseStart;
                 dashRemaining = dashRemainingStart;
             }
-            nextk = arcs[iphase].narcs;
+            if (iphase == 0 || isDoubleDash)
+                nextk = arcs[iphase].narcs;
             if (nexti == start) {
                 nextk = 0;
                 iDash = iDashStart;
@@ -3072,9 +3294,16 @@ disposeFinalSpans(void)
     finalSpans = 0;
 }
 
-static void
-fillSpans(DrawablePtr pDrawable, GCPtr pGC)
+/*
+ * Fill the final spans and forget them.  When key is given, the spans are
+ * also kept in the cache, relative to xorg and yorg, and the entry is
+ * returned; arcs that left no spans are not kept.
+ */
+static miArcCacheEntryPtr
+fillSpans(DrawablePtr pDrawable, GCPtr pGC, miArcCacheKeyPtr key,
+          int xorg, int yorg)
 {
+    miArcCacheEntryPtr entry = NULL;
     struct finalSpan *span;
     DDXPointPtr xSpan;
     int *xWidth;
@@ -3085,7 +3314,7 @@ fillSpans(DrawablePtr pDrawable, GCPtr pGC)
     int *xWidths;
 
     if (nspans == 0)
-        return;
+        return NULL;
     xSpan = xSpans = xallocarray(nspans, sizeof(DDXPointRec));
     xWidth = xWidths = xallocarray(nspans, sizeof(int));
     if (xSpans && xWidths) {
@@ -3102,6 +3331,8 @@ fillSpans(DrawablePtr pDrawable, GCPtr pGC)
                 ++i;
             }
         }
+        if (key)
+            entry = miArcCacheStore(key, i, xSpans, xWidths, xorg, yorg);
         (*pGC->ops->FillSpans) (pDrawable, pGC, i, xSpans, xWidths, TRUE);
     }
     disposeFinalSpans();
@@ -3111,6 +3342,7 @@ fillSpans(DrawablePtr pDrawable, GCPtr pGC)
     finalMaxy = -1;
     finalSize = 0;
     nspans = 0;
+    return entry;
 }
 
 #define SPAN_REALLOC	100
@@ -61,7 +61,6 @@ in this Software without prior written authorization from The Open Group.
 
 /* Maximum size should be initial size multiplied by a power of 2 */
 #define QUEUE_INITIAL_SIZE                 512
-#define QUEUE_RESERVED_SIZE                 64
 #define QUEUE_MAXIMUM_SIZE                4096
 #define QUEUE_DROP_BACKTRACE_FREQUENCY     100
 #define QUEUE_DROP_BACKTRACE_MAX            10
@@ -69,90 +68,115 @@ in this Software without prior written authorization from The Open Group.
 #define EnqueueScreen(dev) dev->spriteInfo->sprite->pEnqueueScreen
 #define DequeueScreen(dev) dev->spriteInfo->sprite->pDequeueScreen
 
+/*
+ * The queue is written by mieqEnqueue with input_lock held, usually from
+ * the input thread, and read by mieqProcessInputEvents on the main thread
+ * without taking the lock.  head and tail count events ever dequeued and
+ * queued; the slot for a position is found by masking it with the size
+ * of the ring that holds it.
+ *
+ * Growing the queue doesn't move anything: mieqEnqueue links a ring
+ * twice the size after the full one and carries on there, and the
+ * reader frees the old ring once it has drained it.
+ *
+ * Each slot has a state so that mieqEnqueue can still fold a motion
+ * event into the last one queued: it may only rewrite a slot the reader
+ * hasn't taken yet.
+ */
+#define mieqLoad(p)             __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define mieqStore(p, v)         __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+enum EventState {
+    EVENT_FREE,
+    EVENT_READY,                /* queued, not yet taken by the reader */
+    EVENT_TAKEN,                /* being copied out by the reader */
+    EVENT_WRITING,              /* a motion event is being folded in */
+};
+
 typedef struct _Event {
     InternalEvent *events;
     ScreenPtr pScreen;
     DeviceIntPtr pDev;          /* device this event _originated_ from */
+    int state;                  /* enum EventState */
 } EventRec, *EventPtr;
 
+typedef struct _EventRing {
+    EventRec *events;           /* our queue as an array */
+    InternalEvent *storage;     /* one event for each of them */
+    unsigned int nevents;       /* the number of buckets, a power of 2 */
+    unsigned int start;         /* position of the first event queued here */
+    struct _EventRing *next;    /* where mieqEnqueue went once this filled */
+} EventRingRec, *EventRingPtr;
+
 typedef struct _EventQueue {
     HWEventQueueType head, tail;        /* long for SetInputCheck */
     CARD32 lastEventTime;       /* to avoid time running backwards */
     int lastMotion;             /* device ID if last event motion? */
-    EventRec *events;           /* our queue as an array */
-    size_t nevents;             /* the number of buckets in our queue */
+    EventRingPtr enqueue;       /* ring mieqEnqueue writes to */
+    EventRingPtr dequeue;       /* ring mieqProcessInputEvents reads from */
     size_t dropped;             /* counter for number of consecutive dropped events */
     mieqHandler handlers[128];  /* custom event handler */
 } EventQueueRec, *EventQueuePtr;
 
 static EventQueueRec miEventQueue;
 
-static size_t
-mieqNumEnqueued(EventQueuePtr eventQueue)
+static Bool
+mieqChangeState(EventPtr e, int from, int to)
 {
-    size_t n_enqueued = 0;
+    return __atomic_compare_exchange_n(&e->state, &from, to, FALSE,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
 
-    if (eventQueue->nevents) {
-        /* % is not well-defined with negative numbers... sigh */
-        n_enqueued = eventQueue->tail - eventQueue->head + eventQueue->nevents;
-        if (n_enqueued >= eventQueue->nevents)
-            n_enqueued -= eventQueue->nevents;
-    }
-    return n_enqueued;
+static void
+mieqFreeRing(EventRingPtr ring)
+{
+    FreeEventList(ring->storage, ring->nevents);
+    free(ring->events);
+    free(ring);
 }
 
 /* Pre-condition: Called with input_lock held */
 static Bool
-mieqGrowQueue(EventQueuePtr eventQueue, size_t new_nevents)
+mieqGrowQueue(EventQueuePtr eventQueue, unsigned int new_nevents)
 {
-    size_t i, n_enqueued, first_hunk;
-    EventRec *new_events;
+    EventRingPtr ring;
+    unsigned int i;
 
     if (!eventQueue) {
         ErrorF("[mi] mieqGrowQueue called with a NULL eventQueue\n");
         return FALSE;
     }
 
-    if (new_nevents <= eventQueue->nevents)
+    if (eventQueue->enqueue && new_nevents <= eventQueue->enqueue->nevents)
         return FALSE;
 
-    new_events = calloc(new_nevents, sizeof(EventRec));
-    if (new_events == NULL) {
+    ring = calloc(1, sizeof(EventRingRec));
+    if (ring) {
+        ring->events = calloc(new_nevents, sizeof(EventRec));
+        ring->storage = InitEventList(new_nevents);
+    }
+    if (!ring || !ring->events || !ring->storage) {
         ErrorF("[mi] mieqGrowQueue memory allocation error.\n");
+        if (ring) {
+            free(ring->events);
+            FreeEventList(ring->storage, new_nevents);
+            free(ring);
+        }
         return FALSE;
     }
 
-    n_enqueued = mieqNumEnqueued(eventQueue);
-
-    /* First copy the existing events */
-    first_hunk = eventQueue->nevents - eventQueue->head;
-    memcpy(new_events,
-           &eventQueue->events[eventQueue->head],
-           first_hunk * sizeof(EventRec));
-    memcpy(&new_events[first_hunk],
-           eventQueue->events, eventQueue->head * sizeof(EventRec));
-
-    /* Initialize the new portion */
-    for (i = eventQueue->nevents; i < new_nevents; i++) {
-        InternalEvent *evlist = InitEventList(1);
-
-        if (!evlist) {
-            size_t j;
-
-            for (j = 0; j < i; j++)
-                FreeEventList(new_events[j].events, 1);
-            free(new_events);
-            return FALSE;
-        }
-        new_events[i].events = evlist;
-    }
+    for (i = 0; i < new_nevents; i++)
+        ring->events[i].events = &ring->storage[i];
+    ring->nevents = new_nevents;
+    ring->start = eventQueue->tail;
 
-    /* And update our record */
-    eventQueue->tail = n_enqueued;
-    eventQueue->head = 0;
-    eventQueue->nevents = new_nevents;
-    free(eventQueue->events);
-    eventQueue->events = new_events;
+    /* Nothing more is queued to the old ring, so the reader moves on
+     * once it gets to our start */
+    if (eventQueue->enqueue)
+        mieqStore(&eventQueue->enqueue->next, ring);
+    else
+        eventQueue->dequeue = ring;
+    eventQueue->enqueue = ring;
 
     return TRUE;
 }
@@ -175,15 +199,44 @@ mieqInit(void)
 void
 mieqFini(void)
 {
-    int i;
+    EventRingPtr ring, next;
+
+    for (ring = miEventQueue.dequeue; ring; ring = next) {
+        next = ring->next;
+        mieqFreeRing(ring);
+    }
+    miEventQueue.enqueue = miEventQueue.dequeue = NULL;
+}
+
+static void
+mieqDropped(void)
+{
+    size_t dropped;
 
-    for (i = 0; i < miEventQueue.nevents; i++) {
-        if (miEventQueue.events[i].events != NULL) {
-            FreeEventList(miEventQueue.events[i].events, 1);
-            miEventQueue.events[i].events = NULL;
+    /* Toss events which come in late.  Usually this means your server's
+     * stuck in an infinite loop in the main thread.
+     */
+    dropped = __atomic_add_fetch(&miEventQueue.dropped, 1, __ATOMIC_RELAXED);
+    if (dropped == 1) {
+        ErrorFSigSafe("[mi] EQ overflowing.  Additional events will be "
+                      "discarded until existing events are processed.\n");
+        xorg_backtrace();
+        ErrorFSigSafe("[mi] These backtraces from mieqEnqueue may point to "
+                      "a culprit higher up the stack.\n");
+        ErrorFSigSafe("[mi] mieq is *NOT* the cause.  It is a victim.\n");
+    }
+    else if (dropped % QUEUE_DROP_BACKTRACE_FREQUENCY == 0 &&
+             dropped / QUEUE_DROP_BACKTRACE_FREQUENCY <=
+             QUEUE_DROP_BACKTRACE_MAX) {
+        ErrorFSigSafe("[mi] EQ overflow continuing.  %zu events have been "
+                      "dropped.\n", dropped);
+        if (dropped / QUEUE_DROP_BACKTRACE_FREQUENCY ==
+            QUEUE_DROP_BACKTRACE_MAX) {
+            ErrorFSigSafe("[mi] No further overflow reports will be "
+                          "reported until the clog is cleared.\n");
         }
+        xorg_backtrace();
     }
-    free(miEventQueue.events);
 }
 
 /*
@@ -194,58 +247,46 @@ mieqFini(void)
 void
 mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
 {
-    unsigned int oldtail = miEventQueue.tail;
+    EventRingPtr ring = miEventQueue.enqueue;
+    unsigned int tail = miEventQueue.tail;
+    unsigned int head = mieqLoad(&miEventQueue.head);
+    EventPtr slot = NULL;
     InternalEvent *evt;
+    Bool fold = FALSE;
     int isMotion = 0;
     int evlen;
     Time time;
-    size_t n_enqueued;
 
     verify_internal_event(e);
 
-    n_enqueued = mieqNumEnqueued(&miEventQueue);
+    /* the reader may still be draining older rings */
+    if ((int) (head - ring->start) < 0)
+        head = ring->start;
 
     /* avoid merging events from different devices */
     if (e->any.type == ET_Motion)
         isMotion = pDev->id;
 
-    if (isMotion && isMotion == miEventQueue.lastMotion &&
-        oldtail != miEventQueue.head) {
-        oldtail = (oldtail - 1) % miEventQueue.nevents;
+    if (isMotion && isMotion == miEventQueue.lastMotion && tail != head) {
+        slot = &ring->events[(tail - 1) & (ring->nevents - 1)];
+        /* too late if the reader took it already; queue a new one */
+        fold = mieqChangeState(slot, EVENT_READY, EVENT_WRITING);
     }
-    else if (n_enqueued + 1 == miEventQueue.nevents) {
-        if (!mieqGrowQueue(&miEventQueue, miEventQueue.nevents << 1)) {
-            /* Toss events which come in late.  Usually this means your server's
-             * stuck in an infinite loop in the main thread.
-             */
-            miEventQueue.dropped++;
-            if (miEventQueue.dropped == 1) {
-                ErrorFSigSafe("[mi] EQ overflowing.  Additional events will be "
-                              "discarded until existing events are processed.\n");
-                xorg_backtrace();
-                ErrorFSigSafe("[mi] These backtraces from mieqEnqueue may point to "
-                              "a culprit higher up the stack.\n");
-                ErrorFSigSafe("[mi] mieq is *NOT* the cause.  It is a victim.\n");
-            }
-            else if (miEventQueue.dropped % QUEUE_DROP_BACKTRACE_FREQUENCY == 0 &&
-                     miEventQueue.dropped / QUEUE_DROP_BACKTRACE_FREQUENCY <=
-                     QUEUE_DROP_BACKTRACE_MAX) {
-                ErrorFSigSafe("[mi] EQ overflow continuing.  %zu events have been "
-                              "dropped.\n", miEventQueue.dropped);
-                if (miEventQueue.dropped / QUEUE_DROP_BACKTRACE_FREQUENCY ==
-                    QUEUE_DROP_BACKTRACE_MAX) {
-                    ErrorFSigSafe("[mi] No further overflow reports will be "
-                                  "reported until the clog is cleared.\n");
-                }
-                xorg_backtrace();
+
+    if (!fold) {
+        if (tail - head == ring->nevents) {
+            if (ring->nevents >= QUEUE_MAXIMUM_SIZE ||
+                !mieqGrowQueue(&miEventQueue, ring->nevents << 1)) {
+                mieqDropped();
+                return;
             }
-            return;
+            ring = miEventQueue.enqueue;
         }
-        oldtail = miEventQueue.tail;
+        slot = &ring->events[tail & (ring->nevents - 1)];
     }
 
     evlen = e->any.length;
-    evt = miEventQueue.events[oldtail].events;
+    evt = slot->events;
     memcpy(evt, e, evlen);
 
     time = e->any.time;
@@ -256,11 +297,47 @@ mieqEnqueue(DeviceIntPtr pDev, InternalEvent *e)
         e->any.time = miEventQueue.lastEventTime;
 
     miEventQueue.lastEventTime = evt->any.time;
-    miEventQueue.events[oldtail].pScreen = pDev ? EnqueueScreen(pDev) : NULL;
-    miEventQueue.events[oldtail].pDev = pDev;
+    slot->pScreen = pDev ? EnqueueScreen(pDev) : NULL;
+    slot->pDev = pDev;
 
     miEventQueue.lastMotion = isMotion;
-    miEventQueue.tail = (oldtail + 1) % miEventQueue.nevents;
+    mieqStore(&slot->state, EVENT_READY);
+    if (!fold)
+        mieqStore(&miEventQueue.tail, tail + 1);
+}
+
+/*
+ * Copy the oldest queued event out of the queue.  Called on the main
+ * thread only, without input_lock.
+ */
+static Bool
+mieqDequeue(InternalEvent *event, DeviceIntPtr *dev, ScreenPtr *screen)
+{
+    EventRingPtr ring = miEventQueue.dequeue, next;
+    unsigned int head = miEventQueue.head;
+    EventPtr e;
+
+    if (head == (unsigned int) mieqLoad(&miEventQueue.tail))
+        return FALSE;
+
+    while ((next = mieqLoad(&ring->next)) && head == next->start) {
+        miEventQueue.dequeue = next;
+        mieqFreeRing(ring);
+        ring = next;
+    }
+
+    e = &ring->events[head & (ring->nevents - 1)];
+    /* only spins while mieqEnqueue folds a motion event into it */
+    while (!mieqChangeState(e, EVENT_READY, EVENT_TAKEN))
+        ;
+
+    *event = *e->events;
+    *dev = e->pDev;
+    *screen = e->pScreen;
+
+    mieqStore(&e->state, EVENT_FREE);
+    mieqStore(&miEventQueue.head, head + 1);
+    return TRUE;
 }
 
 /**
@@ -501,14 +578,12 @@ mieqProcessDeviceEvent(DeviceIntPtr dev, InternalEvent *event, ScreenPtr screen)
 void
 mieqProcessInputEvents(void)
 {
-    EventRec *e = NULL;
     ScreenPtr screen;
     InternalEvent event;
     DeviceIntPtr dev = NULL, master = NULL;
+    size_t dropped;
     static Bool inProcessInputEvents = FALSE;
 
-    input_lock();
-
     /*
      * report an error if mieqProcessInputEvents() is called recursively;
      * this can happen, e.g., if something in the mieqProcessDeviceEvent()
@@ -517,25 +592,15 @@ mieqProcessInputEvents(void)
     BUG_WARN_MSG(inProcessInputEvents, "[mi] mieqProcessInputEvents() called recursively.\n");
     inProcessInputEvents = TRUE;
 
-    if (miEventQueue.dropped) {
+    dropped = __atomic_exchange_n(&miEventQueue.dropped, 0, __ATOMIC_RELAXED);
+    if (dropped) {
         ErrorF("[mi] EQ processing has resumed after %lu dropped events.\n",
-               (unsigned long) miEventQueue.dropped);
+               (unsigned long) dropped);
         ErrorF
             ("[mi] This may be caused by a misbehaving driver monopolizing the server's resources.\n");
-        miEventQueue.dropped = 0;
     }
 
-    while (miEventQueue.head != miEventQueue.tail) {
-        e = &miEventQueue.events[miEventQueue.head];
-
-        event = *e->events;
-        dev = e->pDev;
-        screen = e->pScreen;
-
-        miEventQueue.head = (miEventQueue.head + 1) % miEventQueue.nevents;
-
-        input_unlock();
-
+    while (mieqDequeue(&event, &dev, &screen)) {
         master = (dev) ? GetMaster(dev, MASTER_ATTACHED) : NULL;
 
         if (screenIsSaved == SCREEN_SAVER_ON)
@@ -557,11 +622,7 @@ mieqProcessInputEvents(void)
                event.any.type == ET_TouchUpdate) &&
               event.device_event.flags & TOUCH_POINTER_EMULATED)))
             miPointerUpdateSprite(dev);
-
-        input_lock();
     }
 
     inProcessInputEvents = FALSE;
-
-    input_unlock();
 }
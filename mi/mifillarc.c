@@ -667,8 +667,8 @@ miPolyFillArc(DrawablePtr pDraw, GCPtr pGC, int narcs_all, xArc * parcs)
                 nspans += (arc->height + 1) >> 1;
         }
 
-        pts = points = malloc (sizeof (DDXPointRec) * nspans +
-                               sizeof(int) * nspans);
+        pts = points = ScratchAlloc(sizeof (DDXPointRec) * nspans +
+                                    sizeof(int) * nspans);
         if (points) {
             wids = widths = (int *) (points + nspans);
 
@@ -696,7 +696,7 @@ miPolyFillArc(DrawablePtr pDraw, GCPtr pGC, int narcs_all, xArc * parcs)
             if (nspans)
                 (*pGC->ops->FillSpans) (pDraw, pGC, nspans, points,
                                         widths, FALSE);
-            free (points);
+            ScratchFree(points);
         }
         parcs += narcs;
         narcs_all -= narcs;
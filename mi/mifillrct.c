@@ -100,11 +100,11 @@ miPolyFillRect(DrawablePtr pDrawable, GCPtr pGC, int nrectFill, /* number of rec
             maxheight = max(maxheight, prect->height);
     }
 
-    pptFirst = xallocarray(maxheight, sizeof(DDXPointRec));
-    pwFirst = xallocarray(maxheight, sizeof(int));
+    pptFirst = ScratchAllocArray(maxheight, sizeof(DDXPointRec));
+    pwFirst = ScratchAllocArray(maxheight, sizeof(int));
     if (!pptFirst || !pwFirst) {
-        free(pwFirst);
-        free(pptFirst);
+        ScratchFree(pwFirst);
+        ScratchFree(pptFirst);
         return;
     }
 
@@ -127,6 +127,6 @@ miPolyFillRect(DrawablePtr pDrawable, GCPtr pGC, int nrectFill, /* number of rec
                                 prect->height, pptFirst, pwFirst, 1);
         prect++;
     }
-    free(pwFirst);
-    free(pptFirst);
+    ScratchFree(pwFirst);
+    ScratchFree(pptFirst);
 }
@@ -412,11 +412,11 @@ miFillConvexPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
     dy = ymax - ymin + 1;
     if ((count < 3) || (dy < 0))
         return TRUE;
-    ptsOut = FirstPoint = xallocarray(dy, sizeof(DDXPointRec));
-    width = FirstWidth = xallocarray(dy, sizeof(int));
+    ptsOut = FirstPoint = ScratchAllocArray(dy, sizeof(DDXPointRec));
+    width = FirstWidth = ScratchAllocArray(dy, sizeof(int));
     if (!FirstPoint || !FirstWidth) {
-        free(FirstWidth);
-        free(FirstPoint);
+        ScratchFree(FirstWidth);
+        ScratchFree(FirstPoint);
         return FALSE;
     }
 
@@ -480,8 +480,8 @@ miFillConvexPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
         i = min(ptsIn[nextleft].y, ptsIn[nextright].y) - y;
         /* in case we're called with non-convex polygon */
         if (i < 0) {
-            free(FirstWidth);
-            free(FirstPoint);
+            ScratchFree(FirstWidth);
+            ScratchFree(FirstPoint);
             return TRUE;
         }
         while (i-- > 0) {
@@ -511,8 +511,8 @@ miFillConvexPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
      */
     (*pgc->ops->FillSpans) (dst, pgc,
                             ptsOut - FirstPoint, FirstPoint, FirstWidth, 1);
-    free(FirstWidth);
-    free(FirstPoint);
+    ScratchFree(FirstWidth);
+    ScratchFree(FirstPoint);
     return TRUE;
 }
 
@@ -544,12 +544,12 @@ miFillGeneralPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
     if (count < 3)
         return TRUE;
 
-    if (!(pETEs = malloc(sizeof(EdgeTableEntry) * count)))
+    if (!(pETEs = ScratchAllocArray(count, sizeof(EdgeTableEntry))))
         return FALSE;
     ptsOut = FirstPoint;
     width = FirstWidth;
     if (!miCreateETandAET(count, ptsIn, &ET, &AET, pETEs, &SLLBlock)) {
-        free(pETEs);
+        ScratchFree(pETEs);
         return FALSE;
     }
     pSLL = ET.scanlines.next;
@@ -663,7 +663,7 @@ miFillGeneralPoly(DrawablePtr dst, GCPtr pgc, int count, DDXPointPtr ptsIn)
      *     Get any spans that we missed by buffering
      */
     (*pgc->ops->FillSpans) (dst, pgc, nPts, FirstPoint, FirstWidth, 1);
-    free(pETEs);
+    ScratchFree(pETEs);
     miFreeStorage(SLLBlock.next);
     return TRUE;
 }
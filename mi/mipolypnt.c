@@ -67,7 +67,7 @@ miPolyPoint(DrawablePtr pDrawable, GCPtr pGC, int mode, /* Origin or Previous */
     int i;
     xPoint *ppt;
 
-    if (!(pwidthInit = xallocarray(npt, sizeof(int))))
+    if (!(pwidthInit = ScratchAllocArray(npt, sizeof(int))))
         return;
 
     /* make pointlist origin relative */
@@ -108,5 +108,5 @@ miPolyPoint(DrawablePtr pDrawable, GCPtr pGC, int mode, /* Origin or Previous */
         ChangeGC(NullClient, pGC, GCFillStyle, &fsOld);
         ValidateGC(pDrawable, pGC);
     }
-    free(pwidthInit);
+    ScratchFree(pwidthInit);
 }
@@ -88,7 +88,7 @@ miPolyRectangle(DrawablePtr pDraw, GCPtr pGC, int nrects, xRectangle *pRects)
         offset2 = pGC->lineWidth;
         offset1 = offset2 >> 1;
         offset3 = offset2 - offset1;
-        tmp = xallocarray(ntmp, sizeof(xRectangle));
+        tmp = ScratchAllocArray(ntmp, sizeof(xRectangle));
         if (!tmp)
             return;
         t = tmp;
@@ -148,7 +148,7 @@ miPolyRectangle(DrawablePtr pDraw, GCPtr pGC, int nrects, xRectangle *pRects)
             }
         }
         (*pGC->ops->PolyFillRect) (pDraw, pGC, t - tmp, tmp);
-        free((void *) tmp);
+        ScratchFree(tmp);
     }
     else {
 
@@ -121,6 +121,7 @@ miModifyPixmapHeader(PixmapPtr pPixmap, int width, int height, int depth,
 static Bool
 miCloseScreen(ScreenPtr pScreen)
 {
+    miPickScreenClose(pScreen);
     return ((*pScreen->DestroyPixmap) ((PixmapPtr) pScreen->devPrivate));
 }
 
@@ -276,6 +277,9 @@ miScreenInit(ScreenPtr pScreen, void *pbits,  /* pointer to screen bits */
 
     miSetZeroLineBias(pScreen, DEFAULTZEROLINEBIAS);
 
+    if (!miPickScreenInit(pScreen))
+        return FALSE;
+
     return miScreenDevPrivateInit(pScreen, width, pbits);
 }
 
@@ -177,6 +177,67 @@ miShapedWindowIn(RegionPtr universe, RegionPtr bounding,
 				    HasBorder(w) && \
 				    (w)->backgroundState == ParentRelative)
 
+Bool miValidateTreeIncremental = TRUE;
+miValidateStatsRec miValidateTreeStats;
+
+/*
+ * A marked window which has not itself been moved, resized or reshaped
+ * and whose new borderClip is the same as the old one keeps the clips
+ * of its whole subtree: nothing inside it has changed position relative
+ * to anything else.  This is the common case for the siblings swept up
+ * by MarkOverlappedWindows on a restack, so avoid recursing into them.
+ */
+static Bool
+miClipsUnchanged(WindowPtr pWin, RegionPtr universe, VTKind kind)
+{
+    ValidatePtr val = pWin->valdata;
+
+    if (!miValidateTreeIncremental || kind == VTBroken)
+        return FALSE;
+    if (pWin->visibility == VisibilityNotViewable ||
+        val->before.resized || val->before.borderVisible ||
+        val->before.oldAbsCorner.x != pWin->drawable.x ||
+        val->before.oldAbsCorner.y != pWin->drawable.y)
+        return FALSE;
+#ifdef COMPOSITE
+    if (pWin->redirectDraw != RedirectDrawNone)
+        return FALSE;
+#endif
+    return RegionEqual(universe, &pWin->borderClip);
+}
+
+/*
+ * Retire the validation data of a subtree whose clips are unchanged,
+ * leaving nothing to expose for miHandleValidateExposures.
+ */
+static void
+miSkipComputeClips(WindowPtr pParent)
+{
+    WindowPtr pChild;
+
+    miValidateTreeStats.skipped++;
+    pChild = pParent;
+    while (1) {
+        if (pChild->viewable) {
+            if (pChild->valdata) {
+                if (pChild->valdata->before.borderVisible)
+                    RegionDestroy(pChild->valdata->before.borderVisible);
+                RegionNull(&pChild->valdata->after.borderExposed);
+                RegionNull(&pChild->valdata->after.exposed);
+            }
+            if (pChild->firstChild) {
+                pChild = pChild->firstChild;
+                continue;
+            }
+        }
+        while (!pChild->nextSib && (pChild != pParent))
+            pChild = pChild->parent;
+        if (pChild == pParent)
+            break;
+        pChild = pChild->nextSib;
+    }
+}
+
 /*
  *-----------------------------------------------------------------------
  * miComputeClips --
@@ -207,6 +268,8 @@ miComputeClips(WindowPtr pParent,
     Bool overlap;
     RegionPtr borderVisible;
 
+    miValidateTreeStats.revalidated++;
+
     /*
      * Figure out the new visibility of this window.
      * The extent of the universe should be the same as the extent of
@@ -425,8 +488,11 @@ miComputeClips(WindowPtr pParent,
                      */
                     RegionIntersect(&childUniverse,
                                     universe, &pChild->borderSize);
-                    miComputeClips(pChild, pScreen, &childUniverse, kind,
-                                   exposed);
+                    if (miClipsUnchanged(pChild, &childUniverse, kind))
+                        miSkipComputeClips(pChild);
+                    else
+                        miComputeClips(pChild, pScreen, &childUniverse, kind,
+                                       exposed);
                 }
                 /*
                  * Once the child has been processed, we remove its extents
@@ -529,6 +595,10 @@ getBorderClip(WindowPtr pWin)
  *	each marked window are altered.
  *
  * Notes:
+ *	Marked windows whose clips turn out to be unchanged are not
+ *	recomputed, see miClipsUnchanged; miValidateTreeStats records how
+ *	many windows were recomputed and how many subtrees were skipped.
+ *
  *	This routine assumes that all affected windows have been marked
  *	(valdata created) and their winSize and borderSize regions
  *	adjusted to correspond to their new positions. The borderClip and
@@ -571,6 +641,9 @@ miValidateTree(WindowPtr pParent,       /* Parent to validate */
     if (pChild == NullWindow)
         pChild = pParent->firstChild;
 
+    miValidateTreeStats.revalidated = 0;
+    miValidateTreeStats.skipped = 0;
+
     RegionNull(&childClip);
     RegionNull(&exposed);
 
@@ -678,7 +751,10 @@ miValidateTree(WindowPtr pParent,       /* Parent to validate */
         if (pWin->viewable) {
             if (pWin->valdata) {
                 RegionIntersect(&childClip, &totalClip, &pWin->borderSize);
-                miComputeClips(pWin, pScreen, &childClip, kind, &exposed);
+                if (miClipsUnchanged(pWin, &childClip, kind))
+                    miSkipComputeClips(pWin);
+                else
+                    miComputeClips(pWin, pScreen, &childClip, kind, &exposed);
                 if (overlap && !TreatAsTransparent(pWin)) {
                     RegionSubtract(&totalClip, &totalClip, &pWin->borderSize);
                 }
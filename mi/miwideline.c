@@ -189,18 +189,19 @@ miSubtractSpans(SpanGroup * spanGroup, Spans * sub)
                                 int *newwid;
 
 #define EXTRA 8
-                                newPt = reallocarray(spans->points,
-                                                     spans->count + EXTRA,
-                                                     sizeof(DDXPointRec));
-                                if (!newPt)
+                                /* the old ones go with the span data */
+                                newPt = ScratchAllocArray(spans->count + EXTRA,
+                                                          sizeof(DDXPointRec));
+                                newwid = ScratchAllocArray(spans->count + EXTRA,
+                                                           sizeof(int));
+                                if (!newPt || !newwid)
                                     break;
+                                memcpy(newPt, spans->points,
+                                       spans->count * sizeof(DDXPointRec));
+                                memcpy(newwid, spans->widths,
+                                       spans->count * sizeof(int));
                                 spansPt = newPt + (spansPt - spans->points);
                                 spans->points = newPt;
-                                newwid = reallocarray(spans->widths,
-                                                      spans->count + EXTRA,
-                                                      sizeof(int));
-                                if (!newwid)
-                                    break;
                                 spansWid = newwid + (spansWid - spans->widths);
                                 spans->widths = newwid;
                                 extra = EXTRA;
@@ -236,9 +237,16 @@ miAppendSpans(SpanGroup * spanGroup, SpanGroup * otherGroup, Spans * spans)
     spansCount = spans->count;
     if (spansCount > 0) {
         if (spanGroup->size == spanGroup->count) {
+            Spans *group = ScratchAllocArray((spanGroup->size + 8) * 2,
+                                             sizeof(Spans));
+
+            if (!group)
+                return;
+            if (spanGroup->count)
+                memcpy(group, spanGroup->group,
+                       spanGroup->count * sizeof(Spans));
             spanGroup->size = (spanGroup->size + 8) * 2;
-            spanGroup->group =
-                reallocarray(spanGroup->group, sizeof(Spans), spanGroup->size);
+            spanGroup->group = group;
         }
 
         spanGroup->group[spanGroup->count] = *spans;
@@ -254,17 +262,11 @@ miAppendSpans(SpanGroup * spanGroup, SpanGroup * otherGroup, Spans * spans)
         }
     }
     else {
-        free(spans->points);
-        free(spans->widths);
+        ScratchFree(spans->widths);
+        ScratchFree(spans->points);
     }
 }                               /* AppendSpans */
 
-static void
-miFreeSpanGroup(SpanGroup * spanGroup)
-{
-    free(spanGroup->group);
-}
-
 static void
 QuickSortSpansX(DDXPointRec points[], int widths[], int numSpans)
 {
@@ -405,27 +407,44 @@ UniquifySpansX(Spans * spans, DDXPointRec * newPoints, int *newWidths)
     return (newWidths - startNewWidths) + 1;
 }                               /* UniquifySpansX */
 
+/*
+ * Spans come in the order the pieces of the line were drawn, so for a row
+ * they are mostly in order already, and insertion sort takes one pass.
+ * Once it has had to move too much, leave the rest to quicksort.
+ */
 static void
-miDisposeSpanGroup(SpanGroup * spanGroup)
+SortSpansX(DDXPointRec points[], int widths[], int numSpans)
 {
-    int i;
-    Spans *spans;
+    int i, j, moves = 0;
+
+    for (i = 1; i < numSpans; i++) {
+        DDXPointRec tpt = points[i];
+        int tw = widths[i];
 
-    for (i = 0; i < spanGroup->count; i++) {
-        spans = spanGroup->group + i;
-        free(spans->points);
-        free(spans->widths);
+        if (points[i - 1].x <= tpt.x)
+            continue;
+        for (j = i; j && points[j - 1].x > tpt.x; j--) {
+            points[j] = points[j - 1];
+            widths[j] = widths[j - 1];
+        }
+        points[j] = tpt;
+        widths[j] = tw;
+
+        moves += i - j;
+        if (moves > 4 * numSpans) {
+            QuickSortSpansX(points, widths, numSpans);
+            return;
+        }
     }
 }
 
 static void
 miFillUniqueSpanGroup(DrawablePtr pDraw, GCPtr pGC, SpanGroup * spanGroup)
 {
-    int i;
+    int i, j;
     Spans *spans;
-    Spans *yspans;
-    int *ysizes;
-    int ymin, ylength;
+    int *yend;
+    int ymin, ylength, start;
 
     /* Outgoing spans for one big call to FillSpans */
     DDXPointPtr points;
@@ -440,125 +459,76 @@ miFillUniqueSpanGroup(DrawablePtr pDraw, GCPtr pGC, SpanGroup * spanGroup)
         spans = spanGroup->group;
         (*pGC->ops->FillSpans)
             (pDraw, pGC, spans->count, spans->points, spans->widths, TRUE);
-        free(spans->points);
-        free(spans->widths);
     }
     else {
-        /* Yuck.  Gross.  Radix sort into y buckets, then sort x and uniquify */
-        /* This seems to be the fastest thing to do.  I've tried sorting on
-           both x and y at the same time rather than creating into all those
-           y buckets, but it was somewhat slower. */
+        /* Count the spans on each row, then copy them into their rows of
+           the outgoing list in the order they came; each row is then
+           sorted by x and uniquified in place. */
 
         ymin = spanGroup->ymin;
         ylength = spanGroup->ymax - ymin + 1;
 
-        /* Allocate Spans for y buckets */
-        yspans = xallocarray(ylength, sizeof(Spans));
-        ysizes = xallocarray(ylength, sizeof(int));
+        count = 0;
+        for (i = 0, spans = spanGroup->group; i != spanGroup->count;
+             i++, spans++)
+            count += spans->count;
 
-        if (!yspans || !ysizes) {
-            free(yspans);
-            free(ysizes);
-            miDisposeSpanGroup(spanGroup);
-            return;
-        }
+        yend = ScratchAllocArray(ylength, sizeof(int));
+        points = ScratchAllocArray(count, sizeof(DDXPointRec));
+        widths = ScratchAllocArray(count, sizeof(int));
+        if (!yend || !points || !widths)
+            goto bail;
 
-        for (i = 0; i != ylength; i++) {
-            ysizes[i] = 0;
-            yspans[i].count = 0;
-            yspans[i].points = NULL;
-            yspans[i].widths = NULL;
-        }
+        memset(yend, 0, ylength * sizeof(int));
+        for (i = 0, spans = spanGroup->group; i != spanGroup->count;
+             i++, spans++)
+            for (j = 0; j != spans->count; j++) {
+                int index = spans->points[j].y - ymin;
+
+                if (index >= 0 && index < ylength - 1)
+                    yend[index + 1]++;
+            }
+        /* now where each row starts */
+        for (i = 1; i < ylength; i++)
+            yend[i] += yend[i - 1];
+
+        /* afterwards yend[i] is where row i ends */
+        for (i = 0, spans = spanGroup->group; i != spanGroup->count;
+             i++, spans++) {
+            for (j = 0; j != spans->count; j++) {
+                int index = spans->points[j].y - ymin;
 
-        /* Go through every single span and put it into the correct bucket */
-        count = 0;
-        for (i = 0, spans = spanGroup->group;
-             i != spanGroup->count; i++, spans++) {
-            int index;
-            int j;
-
-            for (j = 0, points = spans->points, widths = spans->widths;
-                 j != spans->count; j++, points++, widths++) {
-                index = points->y - ymin;
                 if (index >= 0 && index < ylength) {
-                    Spans *newspans = &(yspans[index]);
-
-                    if (newspans->count == ysizes[index]) {
-                        DDXPointPtr newpoints;
-                        int *newwidths;
-
-                        ysizes[index] = (ysizes[index] + 8) * 2;
-                        newpoints = reallocarray(newspans->points,
-                                                 ysizes[index],
-                                                 sizeof(DDXPointRec));
-                        newwidths = reallocarray(newspans->widths,
-                                                 ysizes[index], sizeof(int));
-                        if (!newpoints || !newwidths) {
-                            for (i = 0; i < ylength; i++) {
-                                free(yspans[i].points);
-                                free(yspans[i].widths);
-                            }
-                            free(yspans);
-                            free(ysizes);
-                            free(newpoints);
-                            free(newwidths);
-                            miDisposeSpanGroup(spanGroup);
-                            return;
-                        }
-                        newspans->points = newpoints;
-                        newspans->widths = newwidths;
-                    }
-                    newspans->points[newspans->count] = *points;
-                    newspans->widths[newspans->count] = *widths;
-                    (newspans->count)++;
-                }               /* if y value of span in range */
-            }                   /* for j through spans */
-            count += spans->count;
-            free(spans->points);
-            spans->points = NULL;
-            free(spans->widths);
-            spans->widths = NULL;
-        }                       /* for i thorough Spans */
-
-        /* Now sort by x and uniquify each bucket into the final array */
-        points = xallocarray(count, sizeof(DDXPointRec));
-        widths = xallocarray(count, sizeof(int));
-        if (!points || !widths) {
-            for (i = 0; i < ylength; i++) {
-                free(yspans[i].points);
-                free(yspans[i].widths);
+                    points[yend[index]] = spans->points[j];
+                    widths[yend[index]] = spans->widths[j];
+                    yend[index]++;
+                }
             }
-            free(yspans);
-            free(ysizes);
-            free(points);
-            free(widths);
-            return;
         }
+
+        /* rows only shrink, so they can be written over the ones done */
         count = 0;
-        for (i = 0; i != ylength; i++) {
-            int ycount = yspans[i].count;
-
-            if (ycount > 0) {
-                if (ycount > 1) {
-                    QuickSortSpansX(yspans[i].points, yspans[i].widths, ycount);
-                    count += UniquifySpansX
-                        (&(yspans[i]), &(points[count]), &(widths[count]));
-                }
-                else {
-                    points[count] = yspans[i].points[0];
-                    widths[count] = yspans[i].widths[0];
-                    count++;
-                }
-                free(yspans[i].points);
-                free(yspans[i].widths);
+        for (i = 0, start = 0; i != ylength; start = yend[i++]) {
+            int ycount = yend[i] - start;
+
+            if (ycount > 1) {
+                Spans row = { ycount, points + start, widths + start };
+
+                SortSpansX(row.points, row.widths, ycount);
+                count += UniquifySpansX(&row, &points[count], &widths[count]);
+            }
+            else if (ycount) {
+                points[count] = points[start];
+                widths[count] = widths[start];
+                count++;
             }
         }
 
         (*pGC->ops->FillSpans) (pDraw, pGC, count, points, widths, TRUE);
-        free(points);
-        free(widths);
-        free(yspans);
-        free(ysizes);           /* use (DE)xalloc for these? */
+ bail:
+        ScratchFree(widths);
+        ScratchFree(points);
+        ScratchFree(yend);
     }
 
     spanGroup->count = 0;
@@ -566,15 +536,19 @@ miFillUniqueSpanGroup(DrawablePtr pDraw, GCPtr pGC, SpanGroup * spanGroup)
     spanGroup->ymax = MINSHORT;
 }
 
+/*
+ * Spans are scratch memory.  Those kept in span groups are freed all at
+ * once by miCleanupSpanData; the others as soon as they're filled.
+ */
 static Bool
 InitSpans(Spans * spans, size_t nspans)
 {
-    spans->points = xallocarray(nspans, sizeof(*spans->points));
+    spans->points = ScratchAllocArray(nspans, sizeof(*spans->points));
     if (!spans->points)
         return FALSE;
-    spans->widths = xallocarray(nspans, sizeof(*spans->widths));
+    spans->widths = ScratchAllocArray(nspans, sizeof(*spans->widths));
     if (!spans->widths) {
-        free(spans->points);
+        ScratchFree(spans->points);
         return FALSE;
     }
     return TRUE;
@@ -586,6 +560,7 @@ InitSpans(Spans * spans, size_t nspans)
 
 typedef struct _SpanData {
     SpanGroup fgGroup, bgGroup;
+    ScratchMarkRec mark;        /* where their memory starts */
 } SpanDataRec, *SpanDataPtr;
 
 static void
@@ -631,8 +606,8 @@ fillSpans(DrawablePtr pDrawable, GCPtr pGC, unsigned long pixel, Spans * spans,
         }
         (*pGC->ops->FillSpans) (pDrawable, pGC, spans->count, spans->points,
                                 spans->widths, TRUE);
-        free(spans->widths);
-        free(spans->points);
+        ScratchFree(spans->widths);
+        ScratchFree(spans->points);
         if (pixel != oldPixel.val) {
             ChangeGC(NullClient, pGC, GCForeground, &oldPixel);
             ValidateGC(pDrawable, pGC);
@@ -1868,6 +1843,7 @@ miSetupSpanData(GCPtr pGC, SpanDataPtr spanData, int npt)
     if (pGC->lineStyle == LineDoubleDash)
         miInitSpanGroup(&spanData->bgGroup);
     miInitSpanGroup(&spanData->fgGroup);
+    ScratchMark(&spanData->mark);
     return spanData;
 }
 
@@ -1884,14 +1860,13 @@ miCleanupSpanData(DrawablePtr pDrawable, GCPtr pGC, SpanDataPtr spanData)
             ValidateGC(pDrawable, pGC);
         }
         miFillUniqueSpanGroup(pDrawable, pGC, &spanData->bgGroup);
-        miFreeSpanGroup(&spanData->bgGroup);
         if (pixel.val != oldPixel.val) {
             ChangeGC(NullClient, pGC, GCForeground, &oldPixel);
             ValidateGC(pDrawable, pGC);
         }
     }
     miFillUniqueSpanGroup(pDrawable, pGC, &spanData->fgGroup);
-    miFreeSpanGroup(&spanData->fgGroup);
+    ScratchRelease(&spanData->mark);
 }
 
 void
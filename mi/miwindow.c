@@ -745,21 +745,116 @@ miMarkUnrealizedWindow(WindowPtr pChild, WindowPtr pWin, Bool fromConfigure)
     }
 }
 
-WindowPtr
-miSpriteTrace(SpritePtr pSprite, int x, int y)
+/*
+ * Picking the window under the pointer walks the children of each window
+ * on the way down, which gets slow with many siblings.  For parents with
+ * lots of mapped children we keep a grid over the children's border
+ * boxes, listing in each cell the children that overlap it, topmost
+ * first, so only those need the full hit test.
+ *
+ * The grids are built the second time a parent is picked through and
+ * thrown away whenever windows are mapped, unmapped, moved, resized,
+ * restacked, reparented or destroyed on the screen; see
+ * miPickWindowsChanged.  Shapes and unhittable are still checked on
+ * every pick, so changing them needs no invalidation.
+ */
+
+#define PICK_MIN_CHILDREN       16      /* just walk fewer children */
+#define PICK_CACHE_SIZE         8       /* parents with a grid per screen */
+#define PICK_MAX_CELLS          64      /* per axis */
+#define PICK_MAX_ENTRIES        32      /* cell entries per child, on average */
+
+/* border boxes don't fit in a BoxRec */
+typedef struct _miPickBox {
+    int x1, y1, x2, y2;
+} miPickBoxRec, *miPickBoxPtr;
+
+enum {
+    PICK_SEEN,                  /* picked through once */
+    PICK_GRID,
+    PICK_WALK,                  /* too few children, or no memory */
+};
+
+typedef struct _miPickGrid {
+    WindowPtr pParent;
+    unsigned int serial;
+    unsigned int lastUse;
+    int state;
+    miPickBoxRec extents;       /* of all the mapped children */
+    int nx, ny, cellw, cellh;
+    int *cellStart;             /* nx * ny + 1 offsets into cellWins */
+    WindowPtr *cellWins;
+    int cellSize, winsSize;     /* allocated lengths of the above */
+} miPickGridRec, *miPickGridPtr;
+
+typedef struct _miPickScreen {
+    unsigned int serial;
+    unsigned int clock;
+    miPickGridRec grids[PICK_CACHE_SIZE];
+} miPickScreenRec, *miPickScreenPtr;
+
+static DevPrivateKeyRec miPickScreenKeyRec;
+
+#define miPickGetScreen(s) ((miPickScreenPtr) \
+    dixLookupPrivateAddr(&(s)->devPrivates, &miPickScreenKeyRec))
+
+Bool
+miPickScreenInit(ScreenPtr pScreen)
 {
-    WindowPtr pWin;
+    return dixRegisterPrivateKey(&miPickScreenKeyRec, PRIVATE_SCREEN,
+                                 sizeof(miPickScreenRec));
+}
+
+void
+miPickScreenClose(ScreenPtr pScreen)
+{
+    miPickScreenPtr pPick;
+    int i;
+
+    if (!dixPrivateKeyRegistered(&miPickScreenKeyRec))
+        return;
+
+    pPick = miPickGetScreen(pScreen);
+    for (i = 0; i < PICK_CACHE_SIZE; i++) {
+        free(pPick->grids[i].cellStart);
+        free(pPick->grids[i].cellWins);
+    }
+    memset(pPick, 0, sizeof(*pPick));
+}
+
+/**
+ * Throw away the pick grids of a screen.  Must be called after anything
+ * that changes which windows are mapped, where they are or how they're
+ * stacked.
+ */
+void
+miPickWindowsChanged(ScreenPtr pScreen)
+{
+    if (dixPrivateKeyRegistered(&miPickScreenKeyRec))
+        miPickGetScreen(pScreen)->serial++;
+}
+
+static void
+miPickBorderBox(WindowPtr pWin, miPickBoxPtr box)
+{
+    int bw = wBorderWidth(pWin);
+
+    box->x1 = pWin->drawable.x - bw;
+    box->y1 = pWin->drawable.y - bw;
+    box->x2 = pWin->drawable.x + (int) pWin->drawable.width + bw;
+    box->y2 = pWin->drawable.y + (int) pWin->drawable.height + bw;
+}
+
+static Bool
+miPickHit(WindowPtr pWin, int x, int y)
+{
+    miPickBoxRec border;
     BoxRec box;
 
-    pWin = DeepestSpriteWin(pSprite)->firstChild;
-    while (pWin) {
-        if ((pWin->mapped) &&
-            (x >= pWin->drawable.x - wBorderWidth(pWin)) &&
-            (x < pWin->drawable.x + (int) pWin->drawable.width +
-             wBorderWidth(pWin)) &&
-            (y >= pWin->drawable.y - wBorderWidth(pWin)) &&
-            (y < pWin->drawable.y + (int) pWin->drawable.height +
-             wBorderWidth(pWin))
+    miPickBorderBox(pWin, &border);
+    return (pWin->mapped &&
+            x >= border.x1 && x < border.x2 &&
+            y >= border.y1 && y < border.y2
             /* When a window is shaped, a further check
              * is made to see if the point is inside
              * borderSize
@@ -773,18 +868,214 @@ miSpriteTrace(SpritePtr pSprite, int x, int y)
              * they're in X's stack. (E.g. if the native window system
              * implements some form of virtual desktop system).
              */
-            && !pWin->unhittable) {
-            if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
-                pSprite->spriteTraceSize += 10;
-                pSprite->spriteTrace = reallocarray(pSprite->spriteTrace,
-                                                    pSprite->spriteTraceSize,
-                                                    sizeof(WindowPtr));
-            }
-            pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
-            pWin = pWin->firstChild;
+            && !pWin->unhittable);
+}
+
+static void
+miPickCells(miPickGridPtr grid, miPickBoxPtr box, int *cx1, int *cy1,
+            int *cx2, int *cy2)
+{
+    *cx1 = (box->x1 - grid->extents.x1) / grid->cellw;
+    *cy1 = (box->y1 - grid->extents.y1) / grid->cellh;
+    *cx2 = (box->x2 - 1 - grid->extents.x1) / grid->cellw;
+    *cy2 = (box->y2 - 1 - grid->extents.y1) / grid->cellh;
+}
+
+/*
+ * Fill in the grid for the mapped children of grid->pParent.  Returns
+ * FALSE if the children should just be walked instead.
+ */
+static Bool
+miPickBuildGrid(miPickGridPtr grid)
+{
+    WindowPtr pChild;
+    miPickBoxRec box;
+    int n = 0, side, ncells, nwins = 0;
+    int cx1, cy1, cx2, cy2, cx, cy, c;
+    int *start;
+
+    for (pChild = grid->pParent->firstChild; pChild; pChild = pChild->nextSib) {
+        if (!pChild->mapped)
+            continue;
+        miPickBorderBox(pChild, &box);
+        if (box.x1 >= box.x2 || box.y1 >= box.y2)
+            continue;
+        if (!n++)
+            grid->extents = box;
+        else {
+            grid->extents.x1 = min(grid->extents.x1, box.x1);
+            grid->extents.y1 = min(grid->extents.y1, box.y1);
+            grid->extents.x2 = max(grid->extents.x2, box.x2);
+            grid->extents.y2 = max(grid->extents.y2, box.y2);
         }
-        else
-            pWin = pWin->nextSib;
+    }
+    if (n < PICK_MIN_CHILDREN)
+        return FALSE;
+
+    for (side = 1; side * side < n && side < PICK_MAX_CELLS; side++)
+        ;
+    grid->nx = grid->ny = side;
+    grid->cellw = (grid->extents.x2 - grid->extents.x1 + grid->nx - 1) /
+        grid->nx;
+    grid->cellh = (grid->extents.y2 - grid->extents.y1 + grid->ny - 1) /
+        grid->ny;
+    ncells = grid->nx * grid->ny;
+
+    if (grid->cellSize < ncells + 1) {
+        start = reallocarray(grid->cellStart, ncells + 1, sizeof(int));
+        if (!start)
+            return FALSE;
+        grid->cellStart = start;
+        grid->cellSize = ncells + 1;
+    }
+    start = grid->cellStart;
+    memset(start, 0, (ncells + 1) * sizeof(int));
+
+    /* count the children in each cell, in start[cell + 1] */
+    for (pChild = grid->pParent->firstChild; pChild; pChild = pChild->nextSib) {
+        if (!pChild->mapped)
+            continue;
+        miPickBorderBox(pChild, &box);
+        if (box.x1 >= box.x2 || box.y1 >= box.y2)
+            continue;
+        miPickCells(grid, &box, &cx1, &cy1, &cx2, &cy2);
+        nwins += (cx2 - cx1 + 1) * (cy2 - cy1 + 1);
+        if (nwins > n * PICK_MAX_ENTRIES)
+            return FALSE;
+        for (cy = cy1; cy <= cy2; cy++)
+            for (cx = cx1; cx <= cx2; cx++)
+                start[cy * grid->nx + cx + 1]++;
+    }
+
+    if (grid->winsSize < nwins) {
+        WindowPtr *wins = reallocarray(grid->cellWins, nwins,
+                                       sizeof(WindowPtr));
+
+        if (!wins)
+            return FALSE;
+        grid->cellWins = wins;
+        grid->winsSize = nwins;
+    }
+
+    for (c = 0; c < ncells; c++)
+        start[c + 1] += start[c];
+
+    /* children go in top to bottom, using start[cell] as the cursor */
+    for (pChild = grid->pParent->firstChild; pChild; pChild = pChild->nextSib) {
+        if (!pChild->mapped)
+            continue;
+        miPickBorderBox(pChild, &box);
+        if (box.x1 >= box.x2 || box.y1 >= box.y2)
+            continue;
+        miPickCells(grid, &box, &cx1, &cy1, &cx2, &cy2);
+        for (cy = cy1; cy <= cy2; cy++)
+            for (cx = cx1; cx <= cx2; cx++)
+                grid->cellWins[start[cy * grid->nx + cx]++] = pChild;
+    }
+
+    /* which left each start[cell] at the start of the next one */
+    for (c = ncells; c > 0; c--)
+        start[c] = start[c - 1];
+    start[0] = 0;
+
+    return TRUE;
+}
+
+/*
+ * Find the grid for pParent, building it if it was picked through before
+ * since the last change.  Returns NULL if the children should be walked.
+ */
+static miPickGridPtr
+miPickLookupGrid(WindowPtr pParent)
+{
+    miPickScreenPtr pPick;
+    miPickGridPtr grid, victim = NULL;
+    int i;
+
+    if (!dixPrivateKeyRegistered(&miPickScreenKeyRec))
+        return NULL;
+
+    pPick = miPickGetScreen(pParent->drawable.pScreen);
+    for (i = 0; i < PICK_CACHE_SIZE; i++) {
+        grid = &pPick->grids[i];
+        if (grid->pParent == pParent && grid->serial == pPick->serial) {
+            grid->lastUse = ++pPick->clock;
+            /* Only build grids for parents that keep getting picked
+             * through, or we'd rebuild on every motion event while
+             * windows are being moved around */
+            if (grid->state == PICK_SEEN)
+                grid->state = miPickBuildGrid(grid) ? PICK_GRID : PICK_WALK;
+            return grid->state == PICK_GRID ? grid : NULL;
+        }
+    }
+
+    /* replace a grid from before the last change, or the oldest one */
+    for (i = 0; i < PICK_CACHE_SIZE; i++) {
+        grid = &pPick->grids[i];
+        if (grid->serial != pPick->serial) {
+            victim = grid;
+            break;
+        }
+        if (!victim || grid->lastUse < victim->lastUse)
+            victim = grid;
+    }
+
+    victim->pParent = pParent;
+    victim->serial = pPick->serial;
+    victim->lastUse = ++pPick->clock;
+    victim->state = PICK_SEEN;
+    return NULL;
+}
+
+/*
+ * The topmost child of pParent that contains x, y, or NULL.
+ */
+static WindowPtr
+miPickChild(WindowPtr pParent, int x, int y)
+{
+    miPickGridPtr grid;
+    WindowPtr pWin;
+    int i, cell;
+
+    /* the first few are quicker to walk than to look up */
+    for (pWin = pParent->firstChild, i = 0; pWin && i < PICK_MIN_CHILDREN;
+         pWin = pWin->nextSib, i++) {
+        if (miPickHit(pWin, x, y))
+            return pWin;
+    }
+
+    if (!pWin || !(grid = miPickLookupGrid(pParent))) {
+        for (; pWin; pWin = pWin->nextSib)
+            if (miPickHit(pWin, x, y))
+                return pWin;
+        return NULL;
+    }
+
+    if (x < grid->extents.x1 || x >= grid->extents.x2 ||
+        y < grid->extents.y1 || y >= grid->extents.y2)
+        return NULL;
+
+    cell = (y - grid->extents.y1) / grid->cellh * grid->nx +
+        (x - grid->extents.x1) / grid->cellw;
+    for (i = grid->cellStart[cell]; i < grid->cellStart[cell + 1]; i++)
+        if (miPickHit(grid->cellWins[i], x, y))
+            return grid->cellWins[i];
+    return NULL;
+}
+
+WindowPtr
+miSpriteTrace(SpritePtr pSprite, int x, int y)
+{
+    WindowPtr pWin = DeepestSpriteWin(pSprite);
+
+    while ((pWin = miPickChild(pWin, x, y))) {
+        if (pSprite->spriteTraceGood >= pSprite->spriteTraceSize) {
+            pSprite->spriteTraceSize += 10;
+            pSprite->spriteTrace = reallocarray(pSprite->spriteTrace,
+                                                pSprite->spriteTraceSize,
+                                                sizeof(WindowPtr));
+        }
+        pSprite->spriteTrace[pSprite->spriteTraceGood++] = pWin;
     }
     return DeepestSpriteWin(pSprite);
 }
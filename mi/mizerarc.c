@@ -671,7 +671,7 @@ miZeroPolyArc(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs)
     numPts = maxPts << 2;
     dospans = (pGC->fillStyle != FillSolid);
     if (dospans) {
-        widths = xallocarray(numPts, sizeof(int));
+        widths = ScratchAllocArray(numPts, sizeof(int));
         if (!widths)
             return;
         maxw = 0;
@@ -687,10 +687,10 @@ miZeroPolyArc(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs)
                    (unsigned char *) pGC->dash, (int) pGC->numInDashList,
                    &dinfo.dashOffsetInit);
     }
-    points = xallocarray(numPts, sizeof(DDXPointRec));
+    points = ScratchAllocArray(numPts, sizeof(DDXPointRec));
     if (!points) {
         if (dospans) {
-            free(widths);
+            ScratchFree(widths);
         }
         return;
     }
@@ -760,8 +760,8 @@ miZeroPolyArc(DrawablePtr pDraw, GCPtr pGC, int narcs, xArc * parcs)
             }
         }
     }
-    free(points);
+    ScratchFree(points);
     if (dospans) {
-        free(widths);
+        ScratchFree(widths);
     }
 }
@@ -150,11 +150,11 @@ miZeroLine(DrawablePtr pDraw, GCPtr pGC, int mode,      /* Origin or Previous */
     width = xright - xleft + 1;
     height = ybottom - ytop + 1;
     list_len = (height >= width) ? height : width;
-    pspanInit = xallocarray(list_len, sizeof(DDXPointRec));
-    pwidthInit = xallocarray(list_len, sizeof(int));
+    pspanInit = ScratchAllocArray(list_len, sizeof(DDXPointRec));
+    pwidthInit = ScratchAllocArray(list_len, sizeof(int));
     if (!pspanInit || !pwidthInit) {
-        free(pspanInit);
-        free(pwidthInit);
+        ScratchFree(pwidthInit);
+        ScratchFree(pspanInit);
         return;
     }
     Nspans = 0;
@@ -342,8 +342,8 @@ miZeroLine(DrawablePtr pDraw, GCPtr pGC, int mode,      /* Origin or Previous */
         (*pGC->ops->FillSpans) (pDraw, pGC, Nspans, pspanInit,
                                 pwidthInit, FALSE);
 
-    free(pwidthInit);
-    free(pspanInit);
+    ScratchFree(pwidthInit);
+    ScratchFree(pspanInit);
 }
 
 void
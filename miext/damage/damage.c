@@ -82,6 +82,71 @@ static DevPrivateKeyRec damageWinPrivateKeyRec;
 
 #define damageWinPrivateKey (&damageWinPrivateKeyRec)
 
+/*
+ * Damage with a cap on the number of rectangles trades precision for
+ * cheaper region operations: only the extents of each drawn region are
+ * added, and once the accumulated region has more than maxRects
+ * rectangles they're widened out to a grid, doubling the tile size until
+ * few enough are left.  The result always covers the exact damage.
+ */
+#define DAMAGE_TILE_SHIFT	5
+
+static void
+damageSnapBox(BoxPtr pBox, int mask)
+{
+    pBox->x1 &= ~mask;
+    pBox->y1 &= ~mask;
+    pBox->x2 = min((pBox->x2 + mask) & ~mask, MAXSHORT);
+    pBox->y2 = min((pBox->y2 + mask) & ~mask, MAXSHORT);
+}
+
+static void
+damageApproximate(RegionPtr pRegion, int maxRects)
+{
+    int shift, i;
+    BoxPtr pBox;
+    BoxRec extents;
+    Bool overlap;
+
+    for (shift = DAMAGE_TILE_SHIFT; RegionNumRects(pRegion) > maxRects;
+         shift++) {
+        if (shift > 15) {
+            extents = *RegionExtents(pRegion);
+            RegionReset(pRegion, &extents);
+            break;
+        }
+        pBox = RegionRects(pRegion);
+        for (i = 0; i < RegionNumRects(pRegion); i++)
+            damageSnapBox(&pBox[i], (1 << shift) - 1);
+        /* the snapped boxes overlap; empty extents make RegionValidate
+         * merge them rather than trust them */
+        pRegion->extents.x1 = pRegion->extents.x2 = 0;
+        RegionValidate(pRegion, &overlap);
+    }
+}
+
+static void
+damageAccumulate(DamagePtr pDamage, RegionPtr pDst, RegionPtr pSrc)
+{
+    RegionRec extents;
+
+    if (!pDamage->maxRects) {
+        RegionUnion(pDst, pDst, pSrc);
+        return;
+    }
+
+    if (!RegionNotEmpty(pSrc) ||
+        RegionContainsRect(pDst, RegionExtents(pSrc)) == rgnIN)
+        return;
+
+    RegionInit(&extents, RegionExtents(pSrc), 1);
+    RegionUnion(pDst, pDst, &extents);
+    RegionUninit(&extents);
+
+    if (RegionNumRects(pDst) > pDamage->maxRects)
+        damageApproximate(pDst, pDamage->maxRects);
+}
+
 static DamagePtr *
 getDrawableDamageRef(DrawablePtr pDrawable)
 {
@@ -257,15 +322,14 @@ damageRegionAppend(DrawablePtr pDrawable, RegionPtr pRegion, Bool clip,
 
         /* Store damage region if needed after submission. */
         if (pDamage->reportAfter)
-            RegionUnion(&pDamage->pendingDamage,
-                        &pDamage->pendingDamage, pDamageRegion);
+            damageAccumulate(pDamage, &pDamage->pendingDamage, pDamageRegion);
 
         /* Report damage now, if desired. */
         if (!pDamage->reportAfter) {
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, pDamageRegion);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+                damageAccumulate(pDamage, &pDamage->damage, pDamageRegion);
         }
 
         /*
@@ -293,8 +357,8 @@ damageRegionProcessPending(DrawablePtr pDrawable)
             if (pDamage->damageReport)
                 DamageReportDamage(pDamage, &pDamage->pendingDamage);
             else
-                RegionUnion(&pDamage->damage, &pDamage->damage,
-                            &pDamage->pendingDamage);
+                damageAccumulate(pDamage, &pDamage->damage,
+                                 &pDamage->pendingDamage);
         }
 
         if (pDamage->reportAfter)
@@ -1652,14 +1716,14 @@ DamageSetup(ScreenPtr pScreen)
     if (dixLookupPrivate(&pScreen->devPrivates, damageScrPrivateKey))
         return TRUE;
 
-    if (!dixRegisterPrivateKey
+    if (!dixRegisterHotPrivateKey
         (&damageGCPrivateKeyRec, PRIVATE_GC, sizeof(DamageGCPrivRec)))
         return FALSE;
 
-    if (!dixRegisterPrivateKey(&damagePixPrivateKeyRec, PRIVATE_PIXMAP, 0))
+    if (!dixRegisterHotPrivateKey(&damagePixPrivateKeyRec, PRIVATE_PIXMAP, 0))
         return FALSE;
 
-    if (!dixRegisterPrivateKey(&damageWinPrivateKeyRec, PRIVATE_WINDOW, 0))
+    if (!dixRegisterHotPrivateKey(&damageWinPrivateKeyRec, PRIVATE_WINDOW, 0))
         return FALSE;
 
     pScrPriv = malloc(sizeof(DamageScrPrivRec));
@@ -1903,6 +1967,18 @@ DamageSetReportAfterOp(DamagePtr pDamage, Bool reportAfter)
     pDamage->reportAfter = reportAfter;
 }
 
+void
+DamageSetMaxRects(DamagePtr pDamage, int maxRects)
+{
+    pDamage->maxRects = max(maxRects, 0);
+    if (pDamage->maxRects) {
+        if (RegionNumRects(&pDamage->damage) > pDamage->maxRects)
+            damageApproximate(&pDamage->damage, pDamage->maxRects);
+        if (RegionNumRects(&pDamage->pendingDamage) > pDamage->maxRects)
+            damageApproximate(&pDamage->pendingDamage, pDamage->maxRects);
+    }
+}
+
 DamageScreenFuncsPtr
 DamageGetScreenFuncs(ScreenPtr pScreen)
 {
@@ -1919,21 +1995,34 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
 
     switch (pDamage->damageLevel) {
     case DamageReportRawRegion:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, &pDamage->damage, pDamageRegion);
         (*pDamage->damageReport) (pDamage, pDamageRegion, pDamage->closure);
         break;
     case DamageReportDeltaRegion:
         RegionNull(&tmpRegion);
-        RegionSubtract(&tmpRegion, pDamageRegion, &pDamage->damage);
+        if (pDamage->maxRects) {
+            /* report whatever the approximation adds, too */
+            RegionRec newRegion;
+
+            RegionNull(&newRegion);
+            RegionCopy(&newRegion, &pDamage->damage);
+            damageAccumulate(pDamage, &newRegion, pDamageRegion);
+            RegionSubtract(&tmpRegion, &newRegion, &pDamage->damage);
+            RegionUninit(&pDamage->damage);
+            pDamage->damage = newRegion;
+        }
+        else
+            RegionSubtract(&tmpRegion, pDamageRegion, &pDamage->damage);
         if (RegionNotEmpty(&tmpRegion)) {
-            RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+            if (!pDamage->maxRects)
+                damageAccumulate(pDamage, &pDamage->damage, pDamageRegion);
             (*pDamage->damageReport) (pDamage, &tmpRegion, pDamage->closure);
         }
         RegionUninit(&tmpRegion);
         break;
     case DamageReportBoundingBox:
         tmpBox = *RegionExtents(&pDamage->damage);
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, &pDamage->damage, pDamageRegion);
         if (!BOX_SAME(&tmpBox, RegionExtents(&pDamage->damage))) {
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
                                       pDamage->closure);
@@ -1941,14 +2030,14 @@ DamageReportDamage(DamagePtr pDamage, RegionPtr pDamageRegion)
         break;
     case DamageReportNonEmpty:
         was_empty = !RegionNotEmpty(&pDamage->damage);
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, &pDamage->damage, pDamageRegion);
         if (was_empty && RegionNotEmpty(&pDamage->damage)) {
             (*pDamage->damageReport) (pDamage, &pDamage->damage,
                                       pDamage->closure);
         }
         break;
     case DamageReportNone:
-        RegionUnion(&pDamage->damage, &pDamage->damage, pDamageRegion);
+        damageAccumulate(pDamage, &pDamage->damage, pDamageRegion);
         break;
     }
 }
@@ -110,6 +110,10 @@ extern _X_EXPORT void
 extern _X_EXPORT void
  DamageSetReportAfterOp(DamagePtr pDamage, Bool reportAfter);
 
+/* Keep the damage to at most maxRects boxes by over-reporting; 0 is exact. */
+extern _X_EXPORT void
+ DamageSetMaxRects(DamagePtr pDamage, int maxRects);
+
 extern _X_EXPORT DamageScreenFuncsPtr DamageGetScreenFuncs(ScreenPtr);
 
 #endif                          /* _DAMAGE_H_ */
@@ -48,6 +48,7 @@ typedef struct _damage {
 
     Bool reportAfter;
     RegionRec pendingDamage;    /* will be flushed post submission at the latest */
+    int maxRects;               /* approximate beyond this many boxes, 0 = exact */
     ScreenPtr pScreen;
 } DamageRec;
 
@@ -141,6 +141,7 @@ shadowSetup(ScreenPtr pScreen)
     pBuf->pPixmap = 0;
     pBuf->closure = 0;
     pBuf->randr = 0;
+    pBuf->threaded = FALSE;
 
     dixSetPrivate(&pScreen->devPrivates, shadowScrPrivateKey, pBuf);
     return TRUE;
@@ -179,6 +180,86 @@ shadowAdd(ScreenPtr pScreen, PixmapPtr pPixmap, ShadowUpdateProc update,
     return TRUE;
 }
 
+void
+shadowSetThreaded(ScreenPtr pScreen, Bool threaded)
+{
+    shadowBuf(pScreen);
+
+    pBuf->threaded = threaded;
+}
+
+/*
+ * Updates smaller than this many pixels aren't worth handing to other
+ * threads; larger ones are split into bands of SHADOW_BAND_ROWS rows.
+ */
+#define SHADOW_THREADED_PIXELS  (256 * 256)
+#define SHADOW_BAND_ROWS        64
+
+typedef struct _shadowBands {
+    ScreenPtr pScreen;
+    shadowBufPtr pBuf;
+    ShadowUpdateProc update;
+    BoxRec extents;
+} shadowBandsRec;
+
+static void
+shadowUpdateBand(void *data, int band)
+{
+    shadowBandsRec *bands = data;
+    shadowBufRec buf = *bands->pBuf;
+    DamageRec damage;
+    BoxRec box = bands->extents;
+
+    box.y1 += band * SHADOW_BAND_ROWS;
+    box.y2 = min(box.y2, box.y1 + SHADOW_BAND_ROWS);
+
+    /* the update procs only look at the damaged region */
+    memset(&damage, 0, sizeof(damage));
+    RegionInit(&damage.damage, &box, 1);
+    RegionIntersect(&damage.damage, &damage.damage,
+                    DamageRegion(bands->pBuf->pDamage));
+
+    if (RegionNotEmpty(&damage.damage)) {
+        buf.pDamage = &damage;
+        buf.threaded = FALSE;
+        (*bands->update) (bands->pScreen, &buf);
+    }
+    RegionUninit(&damage.damage);
+}
+
+/*
+ * Run update over bands of the damage on several threads.  Returns FALSE
+ * if the update should just be done in one go.  The update procs call
+ * this first; the copies of pBuf they get called back with aren't
+ * threaded, so they go on with the actual copy.
+ */
+Bool
+shadowUpdateThreaded(ScreenPtr pScreen, shadowBufPtr pBuf,
+                     ShadowUpdateProc update)
+{
+    RegionPtr damage = DamageRegion(pBuf->pDamage);
+    BoxPtr extents = RegionExtents(damage);
+    shadowBandsRec bands;
+    int nbands;
+
+    if (!pBuf->threaded || WorkerThreadParallelism() < 2)
+        return FALSE;
+
+    nbands = (extents->y2 - extents->y1 + SHADOW_BAND_ROWS - 1) /
+        SHADOW_BAND_ROWS;
+    if (nbands < 2 ||
+        (extents->x2 - extents->x1) * (extents->y2 - extents->y1) <
+        SHADOW_THREADED_PIXELS)
+        return FALSE;
+
+    bands.pScreen = pScreen;
+    bands.pBuf = pBuf;
+    bands.update = update;
+    bands.extents = *extents;
+    WorkerThreadRun(shadowUpdateBand, &bands, nbands);
+    return TRUE;
+}
+
 void
 shadowRemove(ScreenPtr pScreen, PixmapPtr pPixmap)
 {
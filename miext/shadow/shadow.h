@@ -55,6 +55,8 @@ typedef struct _shadowBuf {
     GetImageProcPtr GetImage;
     CloseScreenProcPtr CloseScreen;
     ScreenBlockHandlerProcPtr BlockHandler;
+
+    Bool threaded;              /* window may be called from several threads */
 } shadowBufRec;
 
 /* Match defines from randr extension */
@@ -81,6 +83,18 @@ shadowAdd(ScreenPtr pScreen,
 extern _X_EXPORT void
  shadowRemove(ScreenPtr pScreen, PixmapPtr pPixmap);
 
+/*
+ * Let the update procs split large updates into bands of rows copied by
+ * worker threads; only for window procs which are safe to call from
+ * several threads at once.
+ */
+extern _X_EXPORT void
+ shadowSetThreaded(ScreenPtr pScreen, Bool threaded);
+
+extern _X_EXPORT Bool
+ shadowUpdateThreaded(ScreenPtr pScreen, shadowBufPtr pBuf,
+                      ShadowUpdateProc update);
+
 extern _X_EXPORT void
  shadowUpdateAfb4(ScreenPtr pScreen, shadowBufPtr pBuf);
 
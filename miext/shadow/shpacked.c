@@ -57,6 +57,9 @@ shadowUpdatePacked(ScreenPtr pScreen, shadowBufPtr pBuf)
     FbBits *winBase = NULL, *win;
     CARD32 winSize;
 
+    if (shadowUpdateThreaded(pScreen, pBuf, shadowUpdatePacked))
+        return;
+
     fbGetDrawable(&pShadow->drawable, shaBase, shaStride, shaBpp, shaXoff,
                   shaYoff);
     while (nbox--) {
@@ -111,6 +111,9 @@ FUNC(ScreenPtr pScreen, shadowBufPtr pBuf)
     Data *winBase = NULL, *win;
     CARD32 winSize;
 
+    if (shadowUpdateThreaded(pScreen, pBuf, FUNC))
+        return;
+
     fbGetDrawable(&pShadow->drawable, shaBits, shaStride, shaBpp, shaXoff,
                   shaYoff);
     shaBase = (Data *) shaBits;
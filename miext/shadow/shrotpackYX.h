@@ -69,6 +69,9 @@ FUNC(ScreenPtr pScreen, shadowBufPtr pBuf)
     Data *winBase, *win, *winLine;
     CARD32 winSize;
 
+    if (shadowUpdateThreaded(pScreen, pBuf, FUNC))
+        return;
+
     fbGetDrawable(&pShadow->drawable, shaBits, shaStride, shaBpp, shaXoff,
                   shaYoff);
     shaBase = (Data *) shaBits;
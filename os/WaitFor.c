@@ -112,26 +112,39 @@ mffs(fd_mask mask)
 #include <X11/extensions/dpmsconst.h>
 #endif
 
+/*
+ * Pending timers are kept in a binary heap ordered by expiry time, so
+ * that setting and cancelling a timer take O(log n) however many there
+ * are.  Timers expiring at the same time run in the order they were set.
+ * The heap has room for every timer allocated, so setting one can't fail,
+ * and is only touched with input_lock held.
+ */
 struct _OsTimerRec {
-    struct xorg_list list;
+    int index;                  /* in timer_heap, or -1 if not pending */
+    CARD32 seq;                 /* orders timers with the same expiry */
     CARD32 expires;
     CARD32 delta;
     OsTimerCallback callback;
     void *arg;
 };
 
+/*
+ * How many milliseconds a timer may run late, so that timers expiring
+ * close together run on one wakeup.  Set with -timerslack.
+ */
+int TimerSlack = 0;
+
 static void DoTimer(OsTimerPtr timer, CARD32 now);
 static void DoTimers(CARD32 now);
 static void CheckAllTimers(void);
-static volatile struct xorg_list timers;
+static OsTimerPtr *timer_heap;
+static int timer_count, timer_size, timers_allocated;
+static CARD32 timer_seq;
 
 static inline OsTimerPtr
 first_timer(void)
 {
-    /* inline xorg_list_is_empty which can't handle volatile */
-    if (timers.next == &timers)
-        return NULL;
-    return xorg_list_first_entry(&timers, struct _OsTimerRec, list);
+    return timer_count ? timer_heap[0] : NULL;
 }
 
 /*
@@ -142,25 +155,28 @@ static int
 check_timers(void)
 {
     OsTimerPtr timer;
+    int timeout = -1;
 
+    input_lock();
     if ((timer = first_timer()) != NULL) {
         CARD32 now = GetTimeInMillis();
-        int timeout = timer->expires - now;
 
+        timeout = timer->expires - now;
         if (timeout <= 0) {
             DoTimers(now);
+            timeout = 0;
+        } else if (timeout < timer->delta + 250) {
+            /* Make sure the timeout is sane, then let the timers that
+             * expire soon after this one run on the same wakeup */
+            timeout += TimerSlack;
         } else {
-            /* Make sure the timeout is sane */
-            if (timeout < timer->delta + 250)
-                return timeout;
-
             /* time has rewound.  reset the timers. */
             CheckAllTimers();
+            timeout = 0;
         }
-
-        return 0;
     }
-    return -1;
+    input_unlock();
+    return timeout;
 }
 
 /*****************
@@ -261,22 +277,107 @@ AdjustWaitForDelay(void *waitTime, int newdelay)
 }
 
 static inline Bool timer_pending(OsTimerPtr timer) {
-    return !xorg_list_is_empty(&timer->list);
+    return timer->index >= 0;
+}
+
+static inline Bool
+timer_before(OsTimerPtr a, OsTimerPtr b)
+{
+    int d = a->expires - b->expires;
+
+    return d < 0 || (d == 0 && (int) (a->seq - b->seq) < 0);
+}
+
+static inline void
+timer_heap_put(OsTimerPtr timer, int i)
+{
+    timer_heap[i] = timer;
+    timer->index = i;
+}
+
+static void
+timer_heap_up(OsTimerPtr timer, int i)
+{
+    while (i > 0 && timer_before(timer, timer_heap[(i - 1) / 2])) {
+        timer_heap_put(timer_heap[(i - 1) / 2], i);
+        i = (i - 1) / 2;
+    }
+    timer_heap_put(timer, i);
+}
+
+static void
+timer_heap_down(OsTimerPtr timer, int i)
+{
+    int child;
+
+    while ((child = 2 * i + 1) < timer_count) {
+        if (child + 1 < timer_count &&
+            timer_before(timer_heap[child + 1], timer_heap[child]))
+            child++;
+        if (!timer_before(timer_heap[child], timer))
+            break;
+        timer_heap_put(timer_heap[child], i);
+        i = child;
+    }
+    timer_heap_put(timer, i);
+}
+
+/* Make room for one more timer */
+static Bool
+timer_heap_reserve(void)
+{
+    OsTimerPtr *heap;
+    int size;
+
+    if (timers_allocated < timer_size)
+        return TRUE;
+
+    size = timer_size ? timer_size * 2 : 64;
+    heap = reallocarray(timer_heap, size, sizeof(OsTimerPtr));
+    if (!heap)
+        return FALSE;
+    timer_heap = heap;
+    timer_size = size;
+    return TRUE;
+}
+
+static void
+timer_heap_add(OsTimerPtr timer)
+{
+    timer->seq = timer_seq++;
+    timer_heap_up(timer, timer_count++);
+}
+
+static void
+timer_heap_remove(OsTimerPtr timer)
+{
+    int i = timer->index;
+    OsTimerPtr last = timer_heap[--timer_count];
+
+    timer->index = -1;
+    if (last == timer)
+        return;
+    if (i > 0 && timer_before(last, timer_heap[(i - 1) / 2]))
+        timer_heap_up(last, i);
+    else
+        timer_heap_down(last, i);
 }
 
 /* If time has rewound, re-run every affected timer.
- * Timers might drop out of the list, so we have to restart every time. */
+ * Timers might drop out of the heap, so we have to restart every time. */
 static void
 CheckAllTimers(void)
 {
     OsTimerPtr timer;
     CARD32 now;
+    int i;
 
     input_lock();
  start:
     now = GetTimeInMillis();
 
-    xorg_list_for_each_entry(timer, &timers, list) {
+    for (i = 0; i < timer_count; i++) {
+        timer = timer_heap[i];
         if (timer->expires - now > timer->delta + 250) {
             DoTimer(timer, now);
             goto start;
@@ -290,7 +391,7 @@ DoTimer(OsTimerPtr timer, CARD32 now)
 {
     CARD32 newTime;
 
-    xorg_list_del(&timer->list);
+    timer_heap_remove(timer);
     newTime = (*timer->callback) (timer, now, timer->arg);
     if (newTime)
         TimerSet(timer, 0, newTime, timer->callback, timer->arg);
@@ -314,19 +415,23 @@ OsTimerPtr
 TimerSet(OsTimerPtr timer, int flags, CARD32 millis,
          OsTimerCallback func, void *arg)
 {
-    OsTimerPtr existing, tmp;
     CARD32 now = GetTimeInMillis();
 
     if (!timer) {
-        timer = calloc(1, sizeof(struct _OsTimerRec));
+        input_lock();
+        if (timer_heap_reserve())
+            timer = calloc(1, sizeof(struct _OsTimerRec));
+        if (timer)
+            timers_allocated++;
+        input_unlock();
         if (!timer)
             return NULL;
-        xorg_list_init(&timer->list);
+        timer->index = -1;
     }
     else {
         input_lock();
         if (timer_pending(timer)) {
-            xorg_list_del(&timer->list);
+            timer_heap_remove(timer);
             if (flags & TimerForceOld)
                 (void) (*timer->callback) (timer, now, timer->arg);
         }
@@ -346,12 +451,10 @@ TimerSet(OsTimerPtr timer, int flags, CARD32 millis,
     timer->arg = arg;
     input_lock();
 
-    /* Sort into list */
-    xorg_list_for_each_entry_safe(existing, tmp, &timers, list)
-        if ((int) (existing->expires - millis) > 0)
-            break;
-    /* This even works at the end of the list -- existing->list will be timers */
-    xorg_list_add(&timer->list, existing->list.prev);
+    /* The callback may have set the timer again */
+    if (timer_pending(timer))
+        timer_heap_remove(timer);
+    timer_heap_add(timer);
 
     /* Check to see if the timer is ready to run now */
     if ((int) (millis - now) <= 0)
@@ -380,7 +483,8 @@ TimerCancel(OsTimerPtr timer)
     if (!timer)
         return;
     input_lock();
-    xorg_list_del(&timer->list);
+    if (timer_pending(timer))
+        timer_heap_remove(timer);
     input_unlock();
 }
 
@@ -389,7 +493,10 @@ TimerFree(OsTimerPtr timer)
 {
     if (!timer)
         return;
+    input_lock();
     TimerCancel(timer);
+    timers_allocated--;
+    input_unlock();
     free(timer);
 }
 
@@ -402,18 +509,12 @@ TimerCheck(void)
 void
 TimerInit(void)
 {
-    static Bool been_here;
-    OsTimerPtr timer, tmp;
-
-    if (!been_here) {
-        been_here = TRUE;
-        xorg_list_init((struct xorg_list*) &timers);
-    }
-
-    xorg_list_for_each_entry_safe(timer, tmp, &timers, list) {
-        xorg_list_del(&timer->list);
-        free(timer);
+    input_lock();
+    while (timer_count) {
+        free(timer_heap[--timer_count]);
+        timers_allocated--;
     }
+    input_unlock();
 }
 
 #ifdef DPMSExtension
@@ -622,6 +622,7 @@ AllocNewConnection(XtransConnInfo trans_conn, int fd, CARD32 conn_time)
     if (!oc)
         return NullClient;
     oc->trans_conn = trans_conn;
+    oc->reader = NULL;
     oc->fd = fd;
     oc->input = (ConnectionInputPtr) NULL;
     oc->output = (ConnectionOutputPtr) NULL;
@@ -637,6 +638,7 @@ AllocNewConnection(XtransConnInfo trans_conn, int fd, CARD32 conn_time)
                ospoll_trigger_edge,
                ClientReady,
                client);
+    ReaderThreadAddClient(client);
     set_poll_client(client);
 
 #ifdef DEBUG
@@ -771,6 +773,7 @@ CloseDownFileDescriptor(OsCommPtr oc)
         XdmcpCloseDisplay(connection);
 #endif
         ospoll_remove(server_poll, connection);
+        ReaderThreadRemoveClient(oc);
         _XSERVTransDisconnect(oc->trans_conn);
         _XSERVTransClose(oc->trans_conn);
         oc->trans_conn = NULL;
@@ -1107,7 +1110,8 @@ set_poll_client(ClientPtr client)
     OsCommPtr oc = (OsCommPtr) client->osPrivate;
 
     if (oc->trans_conn) {
-        if (listen_to_client(client))
+        /* requests from threaded clients come in via ReaderThreadNotify */
+        if (listen_to_client(client) && !oc->reader)
             ospoll_listen(server_poll, oc->trans_conn->fd, X_NOTIFY_READ);
         else
             ospoll_mute(server_poll, oc->trans_conn->fd, X_NOTIFY_READ);
@@ -91,15 +91,42 @@ typedef struct _connectionInput {
     unsigned int ignoreBytes;   /* bytes to ignore before the next request */
 } ConnectionInput;
 
+typedef struct _OsBuffer {
+    int refcnt;
+    int size;
+} OsBufferRec;
+
+/*
+ * Output queued behind the connection buffer once the client stops keeping
+ * up.  Large payloads written with WriteBufferToClient are queued by
+ * reference; anything written after them is copied into a private chunk
+ * so that the output stays in order.
+ */
+typedef struct _outputChunk {
+    struct _outputChunk *next;
+    OsBufferPtr buffer;
+    const char *data;
+    int count;                  /* bytes of data left to write */
+    int pad;                    /* bytes of padding left to write after data */
+    Bool copy;                  /* buffer is private, may be appended to */
+} OutputChunk, *OutputChunkPtr;
+
 typedef struct _connectionOutput {
     struct _connectionOutput *next;
     unsigned char *buf;
     int size;
     int count;
+    OutputChunkPtr chunks;      /* written after buf */
+    OutputChunkPtr lastChunk;
 } ConnectionOutput;
 
 static ConnectionInputPtr AllocateInputBuffer(void);
 static ConnectionOutputPtr AllocateOutputBuffer(void);
+static int DoWriteToClient(ClientPtr who, int count, const void *buf,
+                           OsBufferPtr buffer);
+static int FlushClientShared(ClientPtr who, OsCommPtr oc, const void *extraBuf,
+                             int extraCount, OsBufferPtr shared);
+static void FreeOutputChunks(ConnectionOutputPtr oco);
 
 static Bool CriticalOutputPending;
 static int timesThisConnection = 0;
@@ -119,6 +146,11 @@ static OsCommPtr AvailableInput = (OsCommPtr) NULL;
 #define BUFSIZE 16384
 #define BUFWATERMARK 32768
 
+/* smallest payload worth queueing by reference rather than copying */
+#define OUTPUT_SHARE_MIN BUFSIZE
+/* iovecs per writev; queued chunks past this wait for the next pass */
+#define OUTPUT_IOV_MAX 64
+
 /*
  *   A lot of the code in this file manipulates a ConnectionInputPtr:
  *
@@ -349,8 +381,12 @@ ReadRequestFromClient(ClientPtr client)
             YieldControlDeath();
             return -1;
         }
-        result = _XSERVTransRead(oc->trans_conn, oci->buffer + oci->bufcnt,
-                                 oci->size - oci->bufcnt);
+        if (oc->reader)
+            result = ReaderThreadRead(oc, oci->buffer + oci->bufcnt,
+                                      oci->size - oci->bufcnt);
+        else
+            result = _XSERVTransRead(oc->trans_conn, oci->buffer + oci->bufcnt,
+                                     oci->size - oci->bufcnt);
         if (result <= 0) {
             if ((result < 0) && ETEST(errno)) {
                 mark_client_not_ready(client);
@@ -469,7 +505,10 @@ ReadFdFromClient(ClientPtr client)
         OsCommPtr oc = (OsCommPtr) client->osPrivate;
 
         --client->req_fds;
-        fd = _XSERVTransRecvFd(oc->trans_conn);
+        if (oc->reader)
+            fd = ReaderThreadRecvFd(oc);
+        else
+            fd = _XSERVTransRecvFd(oc->trans_conn);
     } else
         LogMessage(X_ERROR, "Request asks for FD without setting req_fds\n");
     return fd;
@@ -651,6 +690,158 @@ AbortClient(ClientPtr client)
     }
 }
 
+/*****************
+ * OsBuffer
+ *    A reference counted block of memory for reply payloads.  Data
+ *    written with WriteBufferToClient stays referenced by the output
+ *    queue until the client has read it, so the caller must not change
+ *    the contents while OsBufferIsShared returns TRUE.
+ *****************/
+
+OsBufferPtr
+OsBufferAlloc(int size)
+{
+    OsBufferPtr buffer;
+
+    if (size < 0 || size > INT_MAX - sizeof(OsBufferRec))
+        return NULL;
+    buffer = calloc(1, sizeof(OsBufferRec) + size);
+    if (!buffer)
+        return NULL;
+    buffer->refcnt = 1;
+    buffer->size = size;
+    return buffer;
+}
+
+void *
+OsBufferData(OsBufferPtr buffer)
+{
+    return buffer + 1;
+}
+
+void
+OsBufferRef(OsBufferPtr buffer)
+{
+    buffer->refcnt++;
+}
+
+void
+OsBufferUnref(OsBufferPtr buffer)
+{
+    if (buffer && --buffer->refcnt == 0)
+        free(buffer);
+}
+
+Bool
+OsBufferIsShared(OsBufferPtr buffer)
+{
+    return buffer->refcnt > 1;
+}
+
+static OutputChunkPtr
+AppendOutputChunk(ConnectionOutputPtr oco, OsBufferPtr buffer,
+                  const char *data, int count, int pad)
+{
+    OutputChunkPtr chunk = malloc(sizeof(OutputChunk));
+
+    if (!chunk)
+        return NULL;
+    OsBufferRef(buffer);
+    chunk->next = NULL;
+    chunk->buffer = buffer;
+    chunk->data = data;
+    chunk->count = count;
+    chunk->pad = pad;
+    chunk->copy = FALSE;
+    if (oco->lastChunk)
+        oco->lastChunk->next = chunk;
+    else
+        oco->chunks = chunk;
+    oco->lastChunk = chunk;
+    return chunk;
+}
+
+static Bool
+QueueOutputBuffer(ConnectionOutputPtr oco, OsBufferPtr buffer,
+                  const char *data, int count, int pad)
+{
+    return AppendOutputChunk(oco, buffer, data, count, pad) != NULL;
+}
+
+static Bool
+QueueOutputCopy(ConnectionOutputPtr oco, const char *data, int count, int pad)
+{
+    OutputChunkPtr chunk = oco->lastChunk;
+    char *dst;
+
+    if (!count && !pad)
+        return TRUE;
+
+    if (!chunk || !chunk->copy ||
+        chunk->buffer->size - (chunk->data - (char *) OsBufferData(chunk->buffer))
+        - chunk->count < count + pad) {
+        OsBufferPtr buffer = OsBufferAlloc(max(count + pad, BUFSIZE));
+
+        if (!buffer)
+            return FALSE;
+        chunk = AppendOutputChunk(oco, buffer, OsBufferData(buffer), 0, 0);
+        OsBufferUnref(buffer);
+        if (!chunk)
+            return FALSE;
+        chunk->copy = TRUE;
+    }
+
+    dst = (char *) chunk->data + chunk->count;
+    if (count)
+        memcpy(dst, data, count);
+    memset(dst + count, '\0', pad);
+    chunk->count += count + pad;
+    return TRUE;
+}
+
+/* Drop written bytes from the head of the chunk queue, return the rest */
+static long
+ConsumeOutputChunks(ConnectionOutputPtr oco, long written)
+{
+    OutputChunkPtr chunk;
+
+    while ((chunk = oco->chunks) && written > 0) {
+        if (written < chunk->count) {
+            chunk->data += written;
+            chunk->count -= written;
+            return 0;
+        }
+        written -= chunk->count;
+        chunk->data += chunk->count;
+        chunk->count = 0;
+        if (written < chunk->pad) {
+            chunk->pad -= written;
+            return 0;
+        }
+        written -= chunk->pad;
+        oco->chunks = chunk->next;
+        if (!oco->chunks)
+            oco->lastChunk = NULL;
+        OsBufferUnref(chunk->buffer);
+        free(chunk);
+    }
+    return written;
+}
+
+static void
+FreeOutputChunks(ConnectionOutputPtr oco)
+{
+    OutputChunkPtr chunk, next;
+
+    for (chunk = oco->chunks; chunk; chunk = next) {
+        next = chunk->next;
+        OsBufferUnref(chunk->buffer);
+        free(chunk);
+    }
+    oco->chunks = NULL;
+    oco->lastChunk = NULL;
+}
+
 /*****************
  * WriteToClient
  *    Copies buf into ClientPtr.buf if it fits (with padding), else
@@ -664,6 +855,27 @@ AbortClient(ClientPtr client)
 
 int
 WriteToClient(ClientPtr who, int count, const void *__buf)
+{
+    return DoWriteToClient(who, count, __buf, NULL);
+}
+
+/*****************
+ * WriteBufferToClient
+ *    Like WriteToClient, but buf lies within buffer.  Large payloads
+ *    are written straight from buf, and whatever the client can't take
+ *    yet is queued by reference instead of being copied.
+ *****************/
+
+int
+WriteBufferToClient(ClientPtr who, int count, const void *buf,
+                    OsBufferPtr buffer)
+{
+    return DoWriteToClient(who, count, buf, buffer);
+}
+
+static int
+DoWriteToClient(ClientPtr who, int count, const void *__buf,
+                OsBufferPtr buffer)
 {
     OsCommPtr oc;
     ConnectionOutputPtr oco;
@@ -775,14 +987,30 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
         }
     }
 #endif
-    if (oco->count == 0 || oco->count + count + padBytes > oco->size) {
+    if (buffer && count < OUTPUT_SHARE_MIN)
+        buffer = NULL;
+
+    if (oco->chunks && !buffer) {
+        /* already behind, keep the output in order */
+        if (!QueueOutputCopy(oco, buf, count, padBytes)) {
+            AbortClient(who);
+            MarkClientException(who);
+            return -1;
+        }
+        NewOutputPending = TRUE;
+        output_pending_mark(who);
+        return count;
+    }
+
+    if (oco->count == 0 || oco->count + count + padBytes > oco->size ||
+        buffer) {
         output_pending_clear(who);
         if (!any_output_pending()) {
             CriticalOutputPending = FALSE;
             NewOutputPending = FALSE;
         }
 
-        return FlushClient(who, oc, buf, count);
+        return FlushClientShared(who, oc, buf, count, buffer);
     }
 
     NewOutputPending = TRUE;
@@ -808,12 +1036,25 @@ WriteToClient(ClientPtr who, int count, const void *__buf)
 
 int
 FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
+{
+    return FlushClientShared(who, oc, __extraBuf, extraCount, NULL);
+}
+
+/*
+ * As FlushClient, but if extraBuf lies within shared and the client can't
+ * take all of it, the rest is queued by reference instead of being copied
+ * into the output buffer.
+ */
+static int
+FlushClientShared(ClientPtr who, OsCommPtr oc, const void *__extraBuf,
+                  int extraCount, OsBufferPtr shared)
 {
     ConnectionOutputPtr oco = oc->output;
     XtransConnInfo trans_conn = oc->trans_conn;
-    struct iovec iov[3];
+    struct iovec iov[OUTPUT_IOV_MAX];
     static char padBuffer[3];
     const char *extraBuf = __extraBuf;
+    OutputChunkPtr chunk;
     long written;
     long padsize;
     long notWritten;
@@ -824,6 +1065,8 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
     written = 0;
     padsize = padding_for_int32(extraCount);
     notWritten = oco->count + extraCount + padsize;
+    for (chunk = oco->chunks; chunk; chunk = chunk->next)
+        notWritten += chunk->count + chunk->pad;
     if (!notWritten)
         return 0;
 
@@ -865,8 +1108,15 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
 	}
 
         InsertIOV((char *) oco->buf, oco->count)
+        for (chunk = oco->chunks;
+             chunk && i <= OUTPUT_IOV_MAX - 5; chunk = chunk->next) {
+            InsertIOV((char *) chunk->data, chunk->count)
+            InsertIOV(padBuffer, chunk->pad)
+        }
+        if (!chunk) {
             InsertIOV((char *) extraBuf, extraCount)
             InsertIOV(padBuffer, padsize)
+        }
 
             errno = 0;
         if (trans_conn && (len = _XSERVTransWritev(trans_conn, iov, i)) >= 0) {
@@ -899,6 +1149,35 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
                 written -= oco->count;
                 oco->count = 0;
             }
+            written = ConsumeOutputChunks(oco, written);
+
+            if (oco->chunks ||
+                (shared && extraCount - written >= OUTPUT_SHARE_MIN)) {
+                /* queue the rest behind what is already queued */
+                long pad = padsize;
+                Bool queued;
+
+                if (written > extraCount)
+                    pad -= written - extraCount;
+                len = extraCount - written;
+                if (len < 0)
+                    len = 0;
+
+                if (shared && len >= OUTPUT_SHARE_MIN)
+                    queued = QueueOutputBuffer(oco, shared,
+                                               extraBuf + written, len, pad);
+                else
+                    queued = QueueOutputCopy(oco, extraBuf + written, len, pad);
+                if (!queued) {
+                    AbortClient(who);
+                    MarkClientException(who);
+                    oco->count = 0;
+                    FreeOutputChunks(oco);
+                    return -1;
+                }
+                ospoll_listen(server_poll, oc->fd, X_NOTIFY_WRITE);
+                return extraCount;
+            }
 
             if (notWritten > oco->size) {
                 unsigned char *obuf = NULL;
@@ -937,12 +1216,14 @@ FlushClient(ClientPtr who, OsCommPtr oc, const void *__extraBuf, int extraCount)
             AbortClient(who);
             MarkClientException(who);
             oco->count = 0;
+            FreeOutputChunks(oco);
             return -1;
         }
     }
 
     /* everything was flushed out */
     oco->count = 0;
+    FreeOutputChunks(oco);
     output_pending_clear(who);
 
     if (oco->size > BUFWATERMARK) {
@@ -993,6 +1274,8 @@ AllocateOutputBuffer(void)
     }
     oco->size = BUFSIZE;
     oco->count = 0;
+    oco->chunks = NULL;
+    oco->lastChunk = NULL;
     return oco;
 }
 
@@ -1019,6 +1302,7 @@ FreeOsBuffers(OsCommPtr oc)
         }
     }
     if ((oco = oc->output)) {
+        FreeOutputChunks(oco);
         if (FreeOutputs) {
             free(oco->buf);
             free(oco);
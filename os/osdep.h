@@ -118,6 +118,7 @@ typedef struct _osComm {
     XID auth_id;                /* authorization id */
     CARD32 conn_time;           /* timestamp if not established, else 0  */
     struct _XtransConnInfo *trans_conn; /* transport connection object */
+    struct _ReaderClient *reader;       /* reader thread state, if any */
     int flags;
 } OsCommRec, *OsCommPtr;
 
@@ -144,6 +145,14 @@ extern struct ospoll    *server_poll;
 Bool
 listen_to_client(ClientPtr client);
 
+/* in readerthread.c */
+extern void ReaderThreadAddClient(ClientPtr client);
+extern void ReaderThreadRemoveClient(OsCommPtr oc);
+extern int ReaderThreadRead(OsCommPtr oc, char *buf, int size);
+#if XTRANS_SEND_FDS
+extern int ReaderThreadRecvFd(OsCommPtr oc);
+#endif
+
 extern Bool NewOutputPending;
 
 extern WorkQueuePtr workQueue;
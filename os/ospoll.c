@@ -47,6 +47,17 @@
 #if EPOLL
 #include <sys/epoll.h>
 
+#if OSPOLL_URING
+#include <linux/io_uring.h>
+#ifdef IORING_FEAT_EXT_ARG
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define URING           1
+#endif
+#endif
+
 /* epoll-based implementation */
 struct ospollfd {
     int                 fd;
@@ -55,6 +66,12 @@ struct ospollfd {
     void                (*callback)(int fd, int xevents, void *data);
     void                *data;
     struct xorg_list    deleted;
+#if URING
+    int                 armed;          /* xevents of the poll in flight */
+    Bool                cancelling;     /* and it is being cancelled */
+    int                 fired;          /* edge events not reset yet */
+    struct xorg_list    pending;        /* change that found no room */
+#endif
 };
 
 struct ospoll {
@@ -63,6 +80,9 @@ struct ospoll {
     int                 num;
     int                 size;
     struct xorg_list    deleted;
+#if URING
+    struct ospoll_uring *uring;         /* NULL when using epoll */
+#endif
 };
 
 #endif
@@ -87,6 +107,9 @@ struct ospoll {
 
 #endif
 
+/* Set by -uring: use io_uring rather than epoll where the kernel has it */
+Bool OsPollUring = FALSE;
+
 /* Binary search for the specified file descriptor
  *
  * Returns position if found
@@ -126,11 +149,351 @@ ospoll_clean_deleted(struct ospoll *ospoll)
 
     xorg_list_for_each_entry_safe(osfd, tmp, &ospoll->deleted, deleted) {
         xorg_list_del(&osfd->deleted);
+#if URING
+        xorg_list_del(&osfd->pending);
+#endif
         free(osfd);
     }
 }
 #endif
 
+#if URING
+
+/*
+ * io_uring-based implementation
+ *
+ * Each fd with events wanted has one IORING_OP_POLL_ADD in flight.  Those
+ * polls are one-shot: when one completes, the callback runs and the poll
+ * is queued again, for an edge-triggered fd only once ospoll_reset_events
+ * or ospoll_listen says the events were used up.  Changing the events of
+ * an armed fd cancels its poll and queues a new one when the cancel
+ * completes.
+ *
+ * None of that costs a system call by itself: new requests sit in the
+ * submission ring until ospoll_wait hands them to the kernel in the same
+ * io_uring_enter that waits for completions.  If the ring is full and
+ * the kernel won't take what is in it, the fd goes on a pending list,
+ * and ospoll_wait queues its request once there is room.  With epoll,
+ * every change to the events of a client, such as listening for writes
+ * when its output backs up, is an epoll_ctl call of its own.
+ *
+ * ospoll_create only uses it with -uring, and falls back to epoll when
+ * the kernel lacks io_uring, or the features used here, or won't let us
+ * use it.
+ */
+
+#define URING_ENTRIES   256
+#define URING_CQ_ENTRIES 4096
+
+struct ospoll_uring {
+    int                 fd;
+    void                *ring;
+    size_t              ring_size;
+    struct io_uring_sqe *sqes;
+    size_t              sqes_size;
+    unsigned            *sq_head, *sq_tail, *sq_array;
+    unsigned            sq_mask, sq_entries;
+    unsigned            *cq_head, *cq_tail;
+    unsigned            cq_mask;
+    struct io_uring_cqe *cqes;
+    struct xorg_list    dying;          /* removed, with a poll in flight */
+    struct xorg_list    pending;        /* fds whose request found no room */
+};
+
+#define uring_load(p)           __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define uring_store(p, v)       __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+static int
+uring_enter(struct ospoll_uring *uring, unsigned to_submit,
+            unsigned min_complete, unsigned flags, void *arg, size_t argsz)
+{
+    return syscall(__NR_io_uring_enter, uring->fd, to_submit, min_complete,
+                   flags, arg, argsz);
+}
+
+static unsigned
+uring_to_submit(struct ospoll_uring *uring)
+{
+    return *uring->sq_tail - uring_load(uring->sq_head);
+}
+
+static void
+uring_destroy(struct ospoll_uring *uring)
+{
+    struct ospollfd *osfd, *tmp;
+
+    if (uring->sqes)
+        munmap(uring->sqes, uring->sqes_size);
+    if (uring->ring)
+        munmap(uring->ring, uring->ring_size);
+    close(uring->fd);
+    xorg_list_for_each_entry_safe(osfd, tmp, &uring->dying, deleted) {
+        xorg_list_del(&osfd->deleted);
+        xorg_list_del(&osfd->pending);
+        free(osfd);
+    }
+    free(uring);
+}
+
+static struct ospoll_uring *
+uring_create(void)
+{
+    const unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+        IORING_FEAT_EXT_ARG;
+    struct io_uring_params p = {
+        .flags = IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP,
+        .cq_entries = URING_CQ_ENTRIES,
+    };
+    struct ospoll_uring *uring;
+    char *ring;
+
+    uring = calloc(1, sizeof (struct ospoll_uring));
+    if (!uring)
+        return NULL;
+    xorg_list_init(&uring->dying);
+    xorg_list_init(&uring->pending);
+
+    uring->fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &p);
+    if (uring->fd < 0) {
+        free(uring);
+        return NULL;
+    }
+    if ((p.features & needed) != needed)
+        goto bail;
+
+    uring->ring_size = max(p.sq_off.array + p.sq_entries * sizeof (unsigned),
+                           p.cq_off.cqes +
+                           p.cq_entries * sizeof (struct io_uring_cqe));
+    ring = mmap(NULL, uring->ring_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED)
+        goto bail;
+    uring->ring = ring;
+
+    uring->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+    uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+    if (uring->sqes == MAP_FAILED) {
+        uring->sqes = NULL;
+        goto bail;
+    }
+
+    uring->sq_head = (unsigned *) (ring + p.sq_off.head);
+    uring->sq_tail = (unsigned *) (ring + p.sq_off.tail);
+    uring->sq_array = (unsigned *) (ring + p.sq_off.array);
+    uring->sq_mask = *(unsigned *) (ring + p.sq_off.ring_mask);
+    uring->sq_entries = p.sq_entries;
+    uring->cq_head = (unsigned *) (ring + p.cq_off.head);
+    uring->cq_tail = (unsigned *) (ring + p.cq_off.tail);
+    uring->cq_mask = *(unsigned *) (ring + p.cq_off.ring_mask);
+    uring->cqes = (struct io_uring_cqe *) (ring + p.cq_off.cqes);
+    return uring;
+
+bail:
+    uring_destroy(uring);
+    return NULL;
+}
+
+/* Find room for another request, handing the queued ones to the kernel
+ * if the submission ring is full */
+static struct io_uring_sqe *
+uring_get_sqe(struct ospoll_uring *uring)
+{
+    unsigned tail = *uring->sq_tail;
+    unsigned idx = tail & uring->sq_mask;
+    struct io_uring_sqe *sqe;
+
+    if (uring_to_submit(uring) == uring->sq_entries) {
+        if (uring_enter(uring, uring->sq_entries, 0, 0, NULL, 0) < 0 ||
+            uring_to_submit(uring) == uring->sq_entries)
+            return NULL;
+    }
+
+    sqe = &uring->sqes[idx];
+    memset(sqe, 0, sizeof (*sqe));
+    uring->sq_array[idx] = idx;
+    return sqe;
+}
+
+static void
+uring_queue(struct ospoll_uring *uring)
+{
+    uring_store(uring->sq_tail, *uring->sq_tail + 1);
+}
+
+/* Bring the poll in flight for osfd in line with the events wanted */
+static void
+uring_update(struct ospoll *ospoll, struct ospollfd *osfd)
+{
+    struct ospoll_uring *uring = ospoll->uring;
+    int want = osfd->xevents & ~osfd->fired;
+    struct io_uring_sqe *sqe;
+
+    if (osfd->armed) {
+        if (osfd->armed == want || osfd->cancelling)
+            return;
+        sqe = uring_get_sqe(uring);
+        if (!sqe)
+            goto pending;
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = (uintptr_t) osfd;
+        sqe->user_data = 0;
+        uring_queue(uring);
+        osfd->cancelling = TRUE;
+        return;
+    }
+
+    if (!want)
+        return;
+    sqe = uring_get_sqe(uring);
+    if (!sqe)
+        goto pending;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = osfd->fd;
+    if (want & X_NOTIFY_READ)
+        sqe->poll_events |= POLLIN;
+    if (want & X_NOTIFY_WRITE)
+        sqe->poll_events |= POLLOUT;
+    sqe->user_data = (uintptr_t) osfd;
+    uring_queue(uring);
+    osfd->armed = want;
+    return;
+
+pending:
+    /* uring_wait tries again */
+    if (xorg_list_is_empty(&osfd->pending))
+        xorg_list_append(&osfd->pending, &uring->pending);
+}
+
+/* Queue the requests that found no room before; FALSE if some still don't */
+static Bool
+uring_update_pending(struct ospoll *ospoll)
+{
+    struct ospoll_uring *uring = ospoll->uring;
+    struct ospollfd *osfd, *tmp;
+
+    xorg_list_for_each_entry_safe(osfd, tmp, &uring->pending, pending) {
+        xorg_list_del(&osfd->pending);
+        uring_update(ospoll, osfd);
+        if (!xorg_list_is_empty(&osfd->pending))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static void
+uring_remove(struct ospoll *ospoll, struct ospollfd *osfd)
+{
+    if (osfd->armed) {
+        /* free it once the kernel is done with it */
+        osfd->xevents = 0;
+        uring_update(ospoll, osfd);
+        xorg_list_add(&osfd->deleted, &ospoll->uring->dying);
+    } else {
+        xorg_list_del(&osfd->pending);
+        xorg_list_add(&osfd->deleted, &ospoll->deleted);
+    }
+}
+
+static int
+uring_wait(struct ospoll *ospoll, int timeout)
+{
+    struct ospoll_uring *uring = ospoll->uring;
+    struct io_uring_getevents_arg arg = { 0 };
+    struct __kernel_timespec ts;
+    unsigned flags = IORING_ENTER_EXT_ARG;
+    unsigned head, tail, to_submit;
+    int nready = 0, ret = 0, err = 0;
+
+    /* Don't sleep on fds whose polls aren't in flight */
+    if (!uring_update_pending(ospoll))
+        timeout = 0;
+    head = *uring->cq_head;
+    to_submit = uring_to_submit(uring);
+
+    /* Submit the queued requests, and wait unless something completed
+     * already */
+    if (head == uring_load(uring->cq_tail)) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout >= 0) {
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000;
+            arg.ts = (uintptr_t) &ts;
+        }
+    }
+    if (to_submit || (flags & IORING_ENTER_GETEVENTS)) {
+        ret = uring_enter(uring, to_submit,
+                          (flags & IORING_ENTER_GETEVENTS) ? 1 : 0,
+                          flags, &arg, sizeof (arg));
+        if (ret < 0 && (errno == ETIME || errno == EBUSY))
+            ret = 0;
+        err = errno;
+    }
+
+    /* Rearming a ready fd may complete at once when a full submission
+     * ring is handed over below; leave those completions for next time */
+    tail = uring_load(uring->cq_tail);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &uring->cqes[head & uring->cq_mask];
+        struct ospollfd *osfd = (struct ospollfd *) (uintptr_t) cqe->user_data;
+        int res = cqe->res;
+        int xevents = 0;
+
+        uring_store(uring->cq_head, ++head);
+
+        /* completion of a POLL_REMOVE */
+        if (!osfd)
+            continue;
+
+        osfd->armed = 0;
+        osfd->cancelling = FALSE;
+        if (!osfd->callback) {
+            xorg_list_del(&osfd->deleted);
+            xorg_list_del(&osfd->pending);
+            xorg_list_add(&osfd->deleted, &ospoll->deleted);
+            continue;
+        }
+
+        if (res == -ECANCELED)
+            ;
+        else if (res < 0)
+            xevents = X_NOTIFY_ERROR;
+        else {
+            if (res & POLLIN)
+                xevents |= X_NOTIFY_READ;
+            if (res & POLLOUT)
+                xevents |= X_NOTIFY_WRITE;
+            if (res & ~(POLLIN|POLLOUT))
+                xevents |= X_NOTIFY_ERROR;
+            /* events muted while the completion was on its way */
+            xevents &= osfd->xevents | X_NOTIFY_ERROR;
+        }
+
+        if (osfd->trigger == ospoll_trigger_edge)
+            osfd->fired |= xevents & (X_NOTIFY_READ|X_NOTIFY_WRITE);
+
+        if (xevents) {
+            osfd->callback(osfd->fd, xevents, osfd->data);
+            nready++;
+        }
+
+        /* the callback may have removed it */
+        if (osfd->callback)
+            uring_update(ospoll, osfd);
+    }
+    uring_update_pending(ospoll);
+    ospoll_clean_deleted(ospoll);
+
+    if (ret < 0 && !nready) {
+        errno = err;
+        return -1;
+    }
+    return nready;
+}
+
+#endif
+
 /* Insert an element into an array
  *
  * base: base address of array
@@ -171,12 +534,23 @@ ospoll_create(void)
 #if EPOLL
     struct ospoll       *ospoll = calloc(1, sizeof (struct ospoll));
 
+    if (!ospoll)
+        return NULL;
+    xorg_list_init(&ospoll->deleted);
+#if URING
+    if (OsPollUring) {
+        ospoll->uring = uring_create();
+        if (ospoll->uring) {
+            ospoll->epoll_fd = -1;
+            return ospoll;
+        }
+    }
+#endif
     ospoll->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
     if (ospoll->epoll_fd < 0) {
         free (ospoll);
         return NULL;
     }
-    xorg_list_init(&ospoll->deleted);
     return ospoll;
 #endif
 #if POLL
@@ -190,7 +564,12 @@ ospoll_destroy(struct ospoll *ospoll)
 #if EPOLL
     if (ospoll) {
         assert (ospoll->num == 0);
-        close(ospoll->epoll_fd);
+#if URING
+        if (ospoll->uring)
+            uring_destroy(ospoll->uring);
+#endif
+        if (ospoll->epoll_fd >= 0)
+            close(ospoll->epoll_fd);
         ospoll_clean_deleted(ospoll);
         free(ospoll->fds);
         free(ospoll);
@@ -241,12 +620,16 @@ ospoll_add(struct ospoll *ospoll, int fd,
         ev.data.ptr = osfd;
         if (trigger == ospoll_trigger_edge)
             ev.events |= EPOLLET;
-        if (epoll_ctl(ospoll->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        if (ospoll->epoll_fd >= 0 &&
+            epoll_ctl(ospoll->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
             free(osfd);
             return FALSE;
         }
         osfd->fd = fd;
         osfd->xevents = 0;
+#if URING
+        xorg_list_init(&osfd->pending);
+#endif
 
         pos = -pos - 1;
         array_insert(ospoll->fds, ospoll->num, sizeof (ospoll->fds[0]), pos);
@@ -306,12 +689,19 @@ ospoll_remove(struct ospoll *ospoll, int fd)
         struct epoll_event ev;
         ev.events = 0;
         ev.data.ptr = osfd;
-        (void) epoll_ctl(ospoll->epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+        if (ospoll->epoll_fd >= 0)
+            (void) epoll_ctl(ospoll->epoll_fd, EPOLL_CTL_DEL, fd, &ev);
 
         array_delete(ospoll->fds, ospoll->num, sizeof (ospoll->fds[0]), pos);
         ospoll->num--;
         osfd->callback = NULL;
         osfd->data = NULL;
+#if URING
+        if (ospoll->uring) {
+            uring_remove(ospoll, osfd);
+            return;
+        }
+#endif
         xorg_list_add(&osfd->deleted, &ospoll->deleted);
 #endif
 #if POLL
@@ -328,6 +718,13 @@ static void
 epoll_mod(struct ospoll *ospoll, struct ospollfd *osfd)
 {
     struct epoll_event ev;
+
+#if URING
+    if (ospoll->uring) {
+        uring_update(ospoll, osfd);
+        return;
+    }
+#endif
     ev.events = 0;
     if (osfd->xevents & X_NOTIFY_READ)
         ev.events |= EPOLLIN;
@@ -349,6 +746,9 @@ ospoll_listen(struct ospoll *ospoll, int fd, int xevents)
 #if EPOLL
         struct ospollfd *osfd = ospoll->fds[pos];
         osfd->xevents |= xevents;
+#if URING
+        osfd->fired &= ~xevents;
+#endif
         epoll_mod(ospoll, osfd);
 #endif
 #if POLL
@@ -394,6 +794,10 @@ ospoll_wait(struct ospoll *ospoll, int timeout)
     struct epoll_event events[MAX_EVENTS];
     int i;
 
+#if URING
+    if (ospoll->uring)
+        return uring_wait(ospoll, timeout);
+#endif
     nready = epoll_wait(ospoll->epoll_fd, events, MAX_EVENTS, timeout);
     for (i = 0; i < nready; i++) {
         struct epoll_event *ev = &events[i];
@@ -451,6 +855,19 @@ ospoll_wait(struct ospoll *ospoll, int timeout)
 void
 ospoll_reset_events(struct ospoll *ospoll, int fd)
 {
+#if URING
+    int pos;
+
+    if (!ospoll->uring)
+        return;
+
+    pos = ospoll_find(ospoll, fd);
+    if (pos < 0 || !ospoll->fds[pos]->fired)
+        return;
+
+    ospoll->fds[pos]->fired = 0;
+    uring_update(ospoll, ospoll->fds[pos]);
+#endif
 #if POLL
     int pos = ospoll_find(ospoll, fd);
 
@@ -0,0 +1,704 @@
+/* readerthread.c -- Threaded reading of client requests.
+ *
+ * Copyright © 2026 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A small pool of threads which read from client sockets on behalf of the
+ * dispatch thread.
+ *
+ * Each client is assigned to one reader thread when the connection is
+ * accepted.  The reader drains the socket into a per-client ring buffer and
+ * follows the request framing (connection setup prefix, core and big request
+ * lengths) as the bytes stream past, so it only wakes the main thread once
+ * a whole request is available.  ReadRequestFromClient then copies out of
+ * the ring instead of calling read(2) itself; everything after that point,
+ * including byte swapping and request validation, still happens on the
+ * dispatch thread, since it depends on state only that thread may touch.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define XSERV_t
+#define TRANS_SERVER
+#define TRANS_REOPEN
+#include <X11/Xtrans/Xtrans.h>
+#include <X11/Xproto.h>
+#include <X11/extensions/bigreqsproto.h>
+
+#include "misc.h"
+#include "dixstruct.h"
+#include "opaque.h"
+#include "osdep.h"
+
+/* Number of reader threads requested with -readthreads; 0 disables them */
+int ReaderThreadCount = 0;
+
+#if INPUTTHREAD
+
+#define READER_RING_SIZE        (1 << 16)
+#define READER_RING_MASK        (READER_RING_SIZE - 1)
+
+typedef enum _ReaderClientState {
+    reader_state_added,
+    reader_state_running,
+    reader_state_removed
+} ReaderClientState;
+
+struct _ReaderThread;
+
+/**
+ * A client connection as seen by its reader thread.
+ *
+ * The ring and framing state are protected by lock; state, resume and the
+ * ready list linkage by reader_mutex.
+ */
+typedef struct _ReaderClient {
+    struct xorg_list node;
+    struct xorg_list ready;
+    struct _ReaderThread *thread;
+    ClientPtr client;
+    struct _XtransConnInfo *trans_conn;
+    int fd;
+    ReaderClientState state;
+    Bool resume;
+
+    pthread_mutex_t lock;
+    char *ring;
+    unsigned int head;          /* next byte the dispatch thread will read */
+    unsigned int tail;          /* next byte the reader thread will fill */
+    Bool stalled;               /* ring was full, fd muted */
+    Bool eof;
+    int error;
+
+    /* request framing */
+    Bool setup;                 /* connection setup prefix seen */
+    Bool swapped;
+    unsigned char header[sz_xConnClientPrefix];
+    unsigned int have;
+    unsigned int want;
+    uint64_t skip;              /* bytes left in the current request */
+} ReaderClient;
+
+typedef struct _ReaderThread {
+    pthread_t thread;
+    struct xorg_list clients;
+    struct ospoll *fds;
+    int wakeRead;
+    int wakeWrite;
+    Bool changed;
+    Bool running;
+} ReaderThread;
+
+static ReaderThread *readerThreads;
+static int numReaderThreads;
+static int nextReaderThread;
+
+static pthread_mutex_t reader_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct xorg_list readerReady;
+static int readerNotifyRead = -1;
+static int readerNotifyWrite = -1;
+
+static void
+ReaderThreadFillPipe(int writeHead)
+{
+    int ret;
+    char byte = 0;
+
+    do {
+        ret = write(writeHead, &byte, 1);
+    } while (ret < 0 && ETEST(errno));
+}
+
+static int
+ReaderThreadReadPipe(int readHead)
+{
+    int ret, array[10];
+
+    ret = read(readHead, &array, sizeof(array));
+    if (ret >= 0)
+        return ret;
+
+    if (errno != EAGAIN)
+        FatalError("reader-thread: draining pipe (%d)", errno);
+
+    return 1;
+}
+
+static int
+ReaderThreadPipe(int *readHead, int *writeHead)
+{
+    int fds[2];
+    int flags;
+
+    if (pipe(fds) < 0)
+        return -1;
+
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    flags = fcntl(fds[0], F_GETFD);
+    if (flags != -1)
+        (void)fcntl(fds[0], F_SETFD, flags | FD_CLOEXEC);
+    *readHead = fds[0];
+    *writeHead = fds[1];
+    return 0;
+}
+
+/**
+ * Work out the total length of the message whose header has been collected.
+ *
+ * @return the length in bytes, or 0 if more header bytes are needed first
+ */
+static uint64_t
+ReaderClientMessageLength(ReaderClient *rc)
+{
+    uint64_t length;
+
+    if (!rc->setup) {
+        xConnClientPrefix *prefix = (xConnClientPrefix *) rc->header;
+        CARD16 proto = prefix->nbytesAuthProto;
+        CARD16 string = prefix->nbytesAuthString;
+        int whichbyte = 1;
+
+        /* Same test as ProcInitialConnection */
+        rc->swapped = (((*(char *) &whichbyte) &&
+                        (prefix->byteOrder == 'B' ||
+                         prefix->byteOrder == 'R')) ||
+                       (!(*(char *) &whichbyte) &&
+                        (prefix->byteOrder == 'l' ||
+                         prefix->byteOrder == 'r')));
+        if (rc->swapped) {
+            proto = bswap_16(proto);
+            string = bswap_16(string);
+        }
+        rc->setup = TRUE;
+        return sz_xConnClientPrefix + pad_to_int32(proto) +
+            pad_to_int32(string);
+    }
+
+    length = ((xReq *) rc->header)->length;
+    if (rc->swapped)
+        length = bswap_16(length);
+    if (length)
+        return length << 2;
+
+    /*
+     * big_requests is only ever set while processing BigReqEnable, and the
+     * client cannot send a zero-length request before it has the reply.
+     */
+    if (!rc->client->big_requests)
+        return sz_xReq;
+    if (rc->want < sizeof(xBigReq)) {
+        rc->want = sizeof(xBigReq);
+        return 0;
+    }
+
+    length = ((xBigReq *) rc->header)->length;
+    if (rc->swapped)
+        length = bswap_32(length);
+    length <<= 2;
+    return length < sizeof(xBigReq) ? sizeof(xBigReq) : length;
+}
+
+/**
+ * Follow the request framing across newly read bytes.
+ *
+ * @return TRUE if at least one request was completed
+ */
+static Bool
+ReaderClientFrame(ReaderClient *rc, const char *data, unsigned int count)
+{
+    Bool complete = FALSE;
+    uint64_t length;
+    unsigned int n;
+
+    while (count > 0) {
+        if (rc->skip) {
+            n = rc->skip < count ? rc->skip : count;
+            rc->skip -= n;
+            data += n;
+            count -= n;
+            if (!rc->skip)
+                complete = TRUE;
+            continue;
+        }
+
+        n = rc->want - rc->have;
+        if (n > count)
+            n = count;
+        memcpy(rc->header + rc->have, data, n);
+        rc->have += n;
+        data += n;
+        count -= n;
+        if (rc->have < rc->want)
+            break;
+
+        length = ReaderClientMessageLength(rc);
+        if (!length)
+            continue;
+
+        if (length > rc->want)
+            rc->skip = length - rc->want;
+        else
+            complete = TRUE;
+        rc->have = 0;
+        rc->want = sz_xReq;
+    }
+
+    return complete;
+}
+
+/**
+ * Queue a client for the main thread, waking it if nothing was queued yet.
+ */
+static void
+ReaderClientNotify(ReaderClient *rc)
+{
+    Bool wake;
+
+    pthread_mutex_lock(&reader_mutex);
+    wake = xorg_list_is_empty(&readerReady);
+    if (rc->state != reader_state_removed && xorg_list_is_empty(&rc->ready))
+        xorg_list_append(&rc->ready, &readerReady);
+    else
+        wake = FALSE;
+    pthread_mutex_unlock(&reader_mutex);
+
+    if (wake)
+        ReaderThreadFillPipe(readerNotifyWrite);
+}
+
+static void
+ReaderClientReady(int fd, int xevents, void *data)
+{
+    ReaderClient *rc = data;
+    unsigned int space, offset;
+    Bool notify = FALSE;
+    int result;
+
+    pthread_mutex_lock(&rc->lock);
+    if (!rc->trans_conn || rc->eof) {
+        pthread_mutex_unlock(&rc->lock);
+        return;
+    }
+
+    space = READER_RING_SIZE - (rc->tail - rc->head);
+    if (space == 0) {
+        rc->stalled = TRUE;
+        ospoll_mute(rc->thread->fds, fd, X_NOTIFY_READ);
+        pthread_mutex_unlock(&rc->lock);
+        return;
+    }
+
+    offset = rc->tail & READER_RING_MASK;
+    if (space > READER_RING_SIZE - offset)
+        space = READER_RING_SIZE - offset;
+
+    result = _XSERVTransRead(rc->trans_conn, rc->ring + offset, space);
+    if (result > 0) {
+        notify = ReaderClientFrame(rc, rc->ring + offset, result);
+        rc->tail += result;
+        /* a request larger than the ring has to be taken in pieces */
+        if (rc->tail - rc->head == READER_RING_SIZE)
+            notify = TRUE;
+    }
+    else if (result == 0 || !ETEST(errno)) {
+        rc->eof = TRUE;
+        rc->error = result < 0 ? errno : 0;
+        ospoll_mute(rc->thread->fds, fd, X_NOTIFY_READ);
+        notify = TRUE;
+    }
+    pthread_mutex_unlock(&rc->lock);
+
+    if (notify)
+        ReaderClientNotify(rc);
+}
+
+static void
+ReaderClientDestroy(ReaderClient *rc)
+{
+    pthread_mutex_destroy(&rc->lock);
+    free(rc->ring);
+    free(rc);
+}
+
+static void
+ReaderThreadWakeNotify(int fd, int revents, void *data)
+{
+    ReaderThread *rt = data;
+
+    /* Shut down if the pipe has been closed */
+    if (ReaderThreadReadPipe(rt->wakeRead) == 0)
+        rt->running = FALSE;
+}
+
+static void *
+ReaderThreadDoWork(void *arg)
+{
+    ReaderThread *rt = arg;
+    sigset_t set;
+
+    /* Don't handle any signals on this thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+#if defined(HAVE_PTHREAD_SETNAME_NP_WITH_TID)
+    pthread_setname_np (pthread_self(), "ReaderThread");
+#elif defined(HAVE_PTHREAD_SETNAME_NP_WITHOUT_TID)
+    pthread_setname_np ("ReaderThread");
+#endif
+
+    ospoll_add(rt->fds, rt->wakeRead,
+               ospoll_trigger_level,
+               ReaderThreadWakeNotify,
+               rt);
+    ospoll_listen(rt->fds, rt->wakeRead, X_NOTIFY_READ);
+
+    while (rt->running) {
+        if (rt->changed) {
+            ReaderClient *rc, *tmp;
+
+            pthread_mutex_lock(&reader_mutex);
+            rt->changed = FALSE;
+            xorg_list_for_each_entry_safe(rc, tmp, &rt->clients, node) {
+                switch (rc->state) {
+                case reader_state_added:
+                    ospoll_add(rt->fds, rc->fd,
+                               ospoll_trigger_level,
+                               ReaderClientReady,
+                               rc);
+                    ospoll_listen(rt->fds, rc->fd, X_NOTIFY_READ);
+                    rc->state = reader_state_running;
+                    rc->resume = FALSE;
+                    break;
+                case reader_state_running:
+                    if (rc->resume) {
+                        rc->resume = FALSE;
+                        ospoll_listen(rt->fds, rc->fd, X_NOTIFY_READ);
+                    }
+                    break;
+                case reader_state_removed:
+                    ospoll_remove(rt->fds, rc->fd);
+                    xorg_list_del(&rc->node);
+                    ReaderClientDestroy(rc);
+                    break;
+                }
+            }
+            pthread_mutex_unlock(&reader_mutex);
+        }
+
+        if (ospoll_wait(rt->fds, -1) < 0) {
+            if (errno == EINVAL)
+                FatalError("reader-thread: %s (%s)", __func__, strerror(errno));
+            else if (errno != EINTR)
+                ErrorF("reader-thread: %s (%s)\n", __func__, strerror(errno));
+        }
+    }
+
+    ospoll_remove(rt->fds, rt->wakeRead);
+
+    return NULL;
+}
+
+/**
+ * Hand clients with complete requests back to the dispatcher.
+ */
+static void
+ReaderThreadNotify(int fd, int mask, void *data)
+{
+    ReaderClient *rc;
+
+    ReaderThreadReadPipe(fd);
+
+    pthread_mutex_lock(&reader_mutex);
+    while (!xorg_list_is_empty(&readerReady)) {
+        ClientPtr client;
+
+        rc = xorg_list_first_entry(&readerReady, ReaderClient, ready);
+        xorg_list_del(&rc->ready);
+        client = rc->client;
+
+        if (listen_to_client(client))
+            mark_client_ready(client);
+        else if (!(((OsCommPtr) client->osPrivate)->flags & OS_COMM_IGNORED))
+            /* grab active, mark ready when grab goes away */
+            mark_client_saved_ready(client);
+        /* ignored clients are marked ready again by AttendClient */
+    }
+    pthread_mutex_unlock(&reader_mutex);
+}
+
+/**
+ * Assign a new connection to one of the reader threads, if any are running.
+ */
+void
+ReaderThreadAddClient(ClientPtr client)
+{
+    OsCommPtr oc = (OsCommPtr) client->osPrivate;
+    ReaderThread *rt;
+    ReaderClient *rc;
+
+    if (!numReaderThreads)
+        return;
+
+    rc = calloc(1, sizeof(ReaderClient));
+    if (!rc)
+        return;
+    rc->ring = malloc(READER_RING_SIZE);
+    if (!rc->ring) {
+        free(rc);
+        return;
+    }
+
+    rt = &readerThreads[nextReaderThread];
+    nextReaderThread = (nextReaderThread + 1) % numReaderThreads;
+
+    rc->thread = rt;
+    rc->client = client;
+    rc->trans_conn = oc->trans_conn;
+    rc->fd = oc->fd;
+    rc->state = reader_state_added;
+    rc->want = sz_xConnClientPrefix;
+    xorg_list_init(&rc->ready);
+    pthread_mutex_init(&rc->lock, NULL);
+
+    oc->reader = rc;
+
+    pthread_mutex_lock(&reader_mutex);
+    /* Do not prepend, so that any removed client with the same fd
+     * gets processed first. */
+    xorg_list_append(&rc->node, &rt->clients);
+    rt->changed = TRUE;
+    pthread_mutex_unlock(&reader_mutex);
+
+    ReaderThreadFillPipe(rt->wakeWrite);
+}
+
+/**
+ * Detach a connection from its reader thread before the fd is closed.  The
+ * reader thread frees its state once it has removed the fd from its poll set.
+ */
+void
+ReaderThreadRemoveClient(OsCommPtr oc)
+{
+    ReaderClient *rc = oc->reader;
+
+    if (!rc)
+        return;
+
+    pthread_mutex_lock(&reader_mutex);
+    rc->state = reader_state_removed;
+    rc->thread->changed = TRUE;
+    xorg_list_del(&rc->ready);
+    pthread_mutex_unlock(&reader_mutex);
+
+    /* Wait out any read in progress */
+    pthread_mutex_lock(&rc->lock);
+    rc->trans_conn = NULL;
+    pthread_mutex_unlock(&rc->lock);
+
+    ReaderThreadFillPipe(rc->thread->wakeWrite);
+    oc->reader = NULL;
+}
+
+/**
+ * Take up to size bytes of buffered input, with the same return convention
+ * as _XSERVTransRead.
+ */
+int
+ReaderThreadRead(OsCommPtr oc, char *buf, int size)
+{
+    ReaderClient *rc = oc->reader;
+    unsigned int avail, offset, first;
+    Bool resume;
+
+    pthread_mutex_lock(&rc->lock);
+    avail = rc->tail - rc->head;
+    if (avail == 0) {
+        int result = -1;
+
+        if (!rc->eof)
+            errno = EAGAIN;
+        else if (rc->error)
+            errno = rc->error;
+        else
+            result = 0;
+        pthread_mutex_unlock(&rc->lock);
+        return result;
+    }
+
+    if (avail > size)
+        avail = size;
+    offset = rc->head & READER_RING_MASK;
+    first = READER_RING_SIZE - offset;
+    if (first > avail)
+        first = avail;
+    memcpy(buf, rc->ring + offset, first);
+    memcpy(buf + first, rc->ring, avail - first);
+    rc->head += avail;
+
+    resume = rc->stalled;
+    rc->stalled = FALSE;
+    pthread_mutex_unlock(&rc->lock);
+
+    if (resume) {
+        pthread_mutex_lock(&reader_mutex);
+        rc->resume = TRUE;
+        rc->thread->changed = TRUE;
+        pthread_mutex_unlock(&reader_mutex);
+        ReaderThreadFillPipe(rc->thread->wakeWrite);
+    }
+
+    return avail;
+}
+
+#if XTRANS_SEND_FDS
+/**
+ * Fetch a passed fd; the reader thread may be receiving more at the
+ * same time.
+ */
+int
+ReaderThreadRecvFd(OsCommPtr oc)
+{
+    ReaderClient *rc = oc->reader;
+    int fd;
+
+    pthread_mutex_lock(&rc->lock);
+    fd = _XSERVTransRecvFd(oc->trans_conn);
+    pthread_mutex_unlock(&rc->lock);
+    return fd;
+}
+#endif
+
+/**
+ * Start the reader threads requested with -readthreads.
+ */
+void
+ReaderThreadInit(void)
+{
+    pthread_attr_t attr;
+    int i;
+
+    if (ReaderThreadCount <= 0)
+        return;
+
+    readerThreads = calloc(ReaderThreadCount, sizeof(ReaderThread));
+    if (!readerThreads)
+        FatalError("reader-thread: could not allocate memory");
+
+    if (ReaderThreadPipe(&readerNotifyRead, &readerNotifyWrite) < 0)
+        FatalError("reader-thread: could not create pipe");
+    xorg_list_init(&readerReady);
+    SetNotifyFd(readerNotifyRead, ReaderThreadNotify, X_NOTIFY_READ, NULL);
+
+    pthread_attr_init(&attr);
+    if (pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM) != 0)
+        ErrorF("reader-thread: error setting thread scope\n");
+
+    for (i = 0; i < ReaderThreadCount; i++) {
+        ReaderThread *rt = &readerThreads[i];
+
+        xorg_list_init(&rt->clients);
+        rt->fds = ospoll_create();
+        if (!rt->fds ||
+            ReaderThreadPipe(&rt->wakeRead, &rt->wakeWrite) < 0)
+            FatalError("reader-thread: could not create thread state");
+        rt->running = TRUE;
+
+        DebugF("reader-thread: creating thread %d\n", i);
+        if (pthread_create(&rt->thread, &attr, &ReaderThreadDoWork, rt) != 0)
+            FatalError("reader-thread: could not create thread");
+        numReaderThreads++;
+    }
+
+    pthread_attr_destroy(&attr);
+    nextReaderThread = 0;
+}
+
+/**
+ * Stop the reader threads.  All clients have been closed down by now.
+ */
+void
+ReaderThreadFini(void)
+{
+    ReaderClient *rc, *tmp;
+    int i;
+
+    if (!readerThreads)
+        return;
+
+    for (i = 0; i < numReaderThreads; i++) {
+        ReaderThread *rt = &readerThreads[i];
+
+        /* Close the pipe to get the reader thread to shut down */
+        close(rt->wakeWrite);
+        pthread_join(rt->thread, NULL);
+
+        xorg_list_for_each_entry_safe(rc, tmp, &rt->clients, node) {
+            ospoll_remove(rt->fds, rc->fd);
+            xorg_list_del(&rc->node);
+            ReaderClientDestroy(rc);
+        }
+        ospoll_destroy(rt->fds);
+        close(rt->wakeRead);
+    }
+
+    RemoveNotifyFd(readerNotifyRead);
+    close(readerNotifyRead);
+    close(readerNotifyWrite);
+    readerNotifyRead = -1;
+    readerNotifyWrite = -1;
+
+    free(readerThreads);
+    readerThreads = NULL;
+    numReaderThreads = 0;
+}
+
+#else /* INPUTTHREAD */
+
+void ReaderThreadInit(void) {}
+void ReaderThreadFini(void) {}
+void ReaderThreadAddClient(ClientPtr client) {}
+void ReaderThreadRemoveClient(OsCommPtr oc) {}
+
+int
+ReaderThreadRead(OsCommPtr oc, char *buf, int size)
+{
+    errno = EAGAIN;
+    return -1;
+}
+
+#if XTRANS_SEND_FDS
+int
+ReaderThreadRecvFd(OsCommPtr oc)
+{
+    return -1;
+}
+#endif
+
+#endif
@@ -0,0 +1,212 @@
+/* scratch.c -- Short-lived memory for request handlers.
+ *
+ * Copyright © 2026 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * ScratchAlloc hands out memory from a bump allocator.  Everything it
+ * handed out goes away at once when ScratchReset is called, which
+ * Dispatch does after every request and on every trip around its loop.
+ * So it suits the buffers of points and spans that rendering code
+ * allocates, uses and frees within one call.
+ *
+ * ScratchFree gives memory back early, but only if it was the last
+ * allocation still held; that covers loops which allocate and free a
+ * buffer each time around.  Freeing anything else does nothing until the
+ * reset.
+ *
+ * ScratchMark and ScratchRelease free everything allocated in between at
+ * once, whatever the order, for code that builds up a lot of scratch
+ * memory in one call of a request that may make many such calls.
+ *
+ * Only the main thread may use it, and never for memory that has to
+ * outlive the request, such as anything passed to WriteToClient.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "misc.h"
+#include "os.h"
+
+#define SCRATCH_CHUNK_SIZE      (64 * 1024)
+#define SCRATCH_ALIGN(n)        (((n) + 15) & ~(size_t) 15)
+
+typedef union _ScratchBlock {
+    size_t size;                /* including this header */
+    char align[16];
+} ScratchBlock;
+
+typedef struct _ScratchChunk {
+    struct _ScratchChunk *next; /* the one we filled before this */
+    char *base, *top, *end;
+} ScratchChunk;
+
+/* the chunk we allocate from; the last in its list is never freed */
+static ScratchChunk *scratch;
+
+unsigned long ScratchAllocCount;
+unsigned long ScratchMallocCount;
+
+static ScratchChunk *
+ScratchNewChunk(size_t need)
+{
+    size_t size = max(need, SCRATCH_CHUNK_SIZE);
+    ScratchChunk *chunk;
+
+    chunk = malloc(SCRATCH_ALIGN(sizeof(ScratchChunk)) + size);
+    if (!chunk)
+        return NULL;
+    if (scratch)
+        ScratchMallocCount++;
+    chunk->next = scratch;
+    chunk->base = chunk->top =
+        (char *) chunk + SCRATCH_ALIGN(sizeof(ScratchChunk));
+    chunk->end = chunk->top + size;
+    scratch = chunk;
+    return chunk;
+}
+
+/**
+ * Allocate size bytes, 16-byte aligned, which stay valid until the next
+ * ScratchReset.  Returns NULL when out of memory.
+ */
+void *
+ScratchAlloc(size_t size)
+{
+    ScratchChunk *chunk = scratch;
+    ScratchBlock *block;
+    size_t need;
+
+    if (size > SIZE_MAX / 2)
+        return NULL;
+    need = sizeof(ScratchBlock) + SCRATCH_ALIGN(size);
+
+    if (!chunk || chunk->end - chunk->top < need) {
+        chunk = ScratchNewChunk(need);
+        if (!chunk)
+            return NULL;
+    }
+
+    block = (ScratchBlock *) chunk->top;
+    block->size = need;
+    chunk->top += need;
+    ScratchAllocCount++;
+    return block + 1;
+}
+
+/**
+ * Allocate an array of nmemb elements of size bytes each, like
+ * xallocarray.
+ */
+void *
+ScratchAllocArray(size_t nmemb, size_t size)
+{
+    if (size && nmemb > SIZE_MAX / 2 / size)
+        return NULL;
+    return ScratchAlloc(nmemb * size);
+}
+
+/**
+ * Give back ptr if nothing allocated after it is still held.
+ */
+void
+ScratchFree(void *ptr)
+{
+    ScratchChunk *chunk = scratch;
+    ScratchBlock *block = ptr;
+
+    if (!ptr)
+        return;
+
+    block--;
+    if ((char *) block + block->size != chunk->top)
+        return;
+
+    chunk->top = (char *) block;
+    /* drop a chunk that emptied, unless it's the one we keep */
+    if (chunk->top == chunk->base && chunk->next) {
+        scratch = chunk->next;
+        free(chunk);
+    }
+}
+
+/**
+ * Free everything allocated since the last reset.
+ */
+void
+ScratchReset(void)
+{
+    ScratchChunk *chunk;
+
+    if (!scratch)
+        return;
+
+    while (scratch->next) {
+        chunk = scratch;
+        scratch = chunk->next;
+        free(chunk);
+    }
+    scratch->top = scratch->base;
+}
+
+/**
+ * Remember where the arena is now.
+ */
+void
+ScratchMark(ScratchMarkPtr mark)
+{
+    mark->chunk = scratch;
+    mark->top = scratch ? scratch->top : NULL;
+}
+
+/**
+ * Free everything allocated since ScratchMark filled in mark.  Nothing
+ * allocated since may be used afterwards.
+ */
+void
+ScratchRelease(ScratchMarkPtr mark)
+{
+    ScratchChunk *chunk, *next;
+
+    if (!mark->chunk) {
+        ScratchReset();
+        return;
+    }
+
+    /* ScratchFree may have given back the marked chunk already */
+    for (chunk = scratch; chunk && chunk != mark->chunk; chunk = chunk->next)
+        ;
+    if (!chunk)
+        return;
+
+    while (scratch != chunk) {
+        next = scratch->next;
+        free(scratch);
+        scratch = next;
+    }
+    if (mark->top < scratch->top)
+        scratch->top = mark->top;
+}
@@ -576,6 +576,20 @@ UseMsg(void)
     ErrorF
         ("-dumbSched             Disable smart scheduling and threaded input, enable old behavior\n");
     ErrorF("-schedInterval int     Set scheduler interval in msec\n");
+    ErrorF("-schedClass name slice budget\n"
+           "                       Set a scheduling class's slice and budget in msec\n");
+    ErrorF("-noSchedClasses        Schedule all clients alike\n");
+#if INPUTTHREAD
+    ErrorF("-readthreads int       Read client requests on int threads\n");
+#endif
+#ifdef OSPOLL_URING
+    ErrorF("-uring                 Poll clients with io_uring instead of epoll\n");
+#endif
+    ErrorF("-workers int           Use int threads to split up rendering work\n");
+    ErrorF("-workerpixels int      Split up fills and copies of int pixels or more\n");
+    ErrorF("-timerslack int        Let timers run up to int msec late to save wakeups\n");
+    ErrorF("-reqstats              Collect request statistics, log them on SIGUSR2 and reset\n");
+    ErrorF("-pixmappool int        Keep up to int KiB of freed pixmaps for reuse\n");
     ErrorF("-sigstop               Enable SIGSTOP based startup\n");
     ErrorF("+extension name        Enable extension\n");
     ErrorF("-extension name        Disable extension\n");
@@ -1008,6 +1022,56 @@ ProcessCommandLine(int argc, char *argv[])
             else
                 UseMsg();
         }
+#if INPUTTHREAD
+        else if (strcmp(argv[i], "-readthreads") == 0) {
+            if (++i < argc)
+                ReaderThreadCount = atoi(argv[i]);
+            else
+                UseMsg();
+        }
+#endif
+#ifdef OSPOLL_URING
+        else if (strcmp(argv[i], "-uring") == 0) {
+            OsPollUring = TRUE;
+        }
+#endif
+        else if (strcmp(argv[i], "-workers") == 0) {
+            if (++i < argc)
+                WorkerThreadCount = atoi(argv[i]);
+            else
+                UseMsg();
+        }
+        else if (strcmp(argv[i], "-workerpixels") == 0) {
+            if (++i < argc && atoi(argv[i]) >= 0)
+                WorkerThreadMinPixels = atoi(argv[i]);
+            else
+                UseMsg();
+        }
+        else if (strcmp(argv[i], "-timerslack") == 0) {
+            if (++i < argc && atoi(argv[i]) >= 0)
+                TimerSlack = atoi(argv[i]);
+            else
+                UseMsg();
+        }
+        else if (strcmp(argv[i], "-reqstats") == 0) {
+            RequestStatsEnabled = TRUE;
+        }
+        else if (strcmp(argv[i], "-pixmappool") == 0) {
+            if (++i < argc && atoi(argv[i]) >= 0)
+                PixmapPoolLimit = (size_t) atoi(argv[i]) * 1024;
+            else
+                UseMsg();
+        }
+        else if (strcmp(argv[i], "-schedClass") == 0) {
+            if (i + 3 < argc &&
+                SmartScheduleParseClass(argv[i + 1], argv[i + 2], argv[i + 3]))
+                i += 3;
+            else
+                UseMsg();
+        }
+        else if (strcmp(argv[i], "-noSchedClasses") == 0) {
+            SmartScheduleClassesEnable = FALSE;
+        }
         else if (strcmp(argv[i], "-schedMax") == 0) {
             if (++i < argc) {
                 SmartScheduleMaxSlice = atoi(argv[i]);
@@ -0,0 +1,287 @@
+/* workerthread.c -- A pool of threads for splitting up rendering work.
+ *
+ * Copyright © 2026 The X.Org Foundation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * WorkerThreadRun calls a function once for each of a number of jobs,
+ * spread over a few threads, and returns when all of them are done.  The
+ * calling thread runs jobs too, so with no worker threads, or when the
+ * pool is already busy, the jobs simply run one after the other.
+ *
+ * Jobs must only touch memory nobody else is using while they run; they
+ * can't call back into the rest of the server.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "misc.h"
+#include "os.h"
+
+/*
+ * Number of worker threads, set with -workers.  -1 picks one less than the
+ * number of CPUs, up to WORKER_THREAD_MAX.
+ */
+int WorkerThreadCount = -1;
+
+/*
+ * Fills and copies covering at least this many pixels are split up over
+ * the threads, set with -workerpixels.  0 leaves them on the main thread.
+ */
+int WorkerThreadMinPixels = 0;
+
+#define WORKER_THREAD_MAX       8
+
+#if INPUTTHREAD
+
+typedef struct _WorkerJob {
+    WorkerThreadProc proc;
+    void *data;
+    int njobs;
+    int next;                   /* next job to hand out */
+    int users;                  /* worker threads running jobs from here */
+} WorkerJob;
+
+static pthread_t *workerThreads;
+static int numWorkerThreads;
+static Bool workerFailed;       /* don't retry starting the threads */
+
+static pthread_mutex_t worker_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t worker_done = PTHREAD_COND_INITIALIZER;
+static WorkerJob *workerJob;
+static Bool workerRunning;
+static int workerBusy;
+
+static int
+WorkerThreadWanted(void)
+{
+    long ncpu;
+
+    if (WorkerThreadCount >= 0)
+        return min(WorkerThreadCount, WORKER_THREAD_MAX);
+
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu <= 1)
+        return 0;
+    return min(ncpu - 1, WORKER_THREAD_MAX);
+}
+
+/**
+ * How many threads run the jobs of a WorkerThreadRun call, counting the
+ * caller.  Use it to decide how finely to split up work.
+ */
+int
+WorkerThreadParallelism(void)
+{
+    if (workerFailed)
+        return 1;
+    return WorkerThreadWanted() + 1;
+}
+
+static void
+WorkerThreadDrain(WorkerJob *job)
+{
+    int i;
+
+    while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+           job->njobs)
+        (*job->proc) (job->data, i);
+}
+
+static void *
+WorkerThreadDoWork(void *arg)
+{
+    WorkerJob *job;
+    sigset_t set;
+
+    /* Don't handle any signals on this thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+#if defined(HAVE_PTHREAD_SETNAME_NP_WITH_TID)
+    pthread_setname_np (pthread_self(), "WorkerThread");
+#elif defined(HAVE_PTHREAD_SETNAME_NP_WITHOUT_TID)
+    pthread_setname_np ("WorkerThread");
+#endif
+
+    pthread_mutex_lock(&worker_mutex);
+    for (;;) {
+        while (workerRunning &&
+               (!workerJob || __atomic_load_n(&workerJob->next,
+                                              __ATOMIC_RELAXED) >=
+                workerJob->njobs))
+            pthread_cond_wait(&worker_start, &worker_mutex);
+        if (!workerRunning)
+            break;
+
+        job = workerJob;
+        job->users++;
+        pthread_mutex_unlock(&worker_mutex);
+
+        WorkerThreadDrain(job);
+
+        pthread_mutex_lock(&worker_mutex);
+        if (--job->users == 0)
+            pthread_cond_signal(&worker_done);
+    }
+    pthread_mutex_unlock(&worker_mutex);
+
+    return NULL;
+}
+
+static Bool
+WorkerThreadStart(void)
+{
+    pthread_attr_t attr;
+    int wanted = WorkerThreadWanted();
+    int i;
+
+    if (workerThreads || workerFailed)
+        return workerThreads != NULL;
+    if (wanted <= 0)
+        return FALSE;
+
+    workerThreads = calloc(wanted, sizeof(pthread_t));
+    if (!workerThreads) {
+        workerFailed = TRUE;
+        return FALSE;
+    }
+
+    pthread_attr_init(&attr);
+    if (pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM) != 0)
+        ErrorF("worker-thread: error setting thread scope\n");
+
+    workerRunning = TRUE;
+    for (i = 0; i < wanted; i++) {
+        DebugF("worker-thread: creating thread %d\n", i);
+        if (pthread_create(&workerThreads[i], &attr,
+                           &WorkerThreadDoWork, NULL) != 0) {
+            ErrorF("worker-thread: could not create thread %d\n", i);
+            break;
+        }
+        numWorkerThreads++;
+    }
+    pthread_attr_destroy(&attr);
+
+    if (!numWorkerThreads) {
+        free(workerThreads);
+        workerThreads = NULL;
+        workerFailed = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/**
+ * Run proc(data, i) for every i from 0 to njobs - 1, in no particular
+ * order and possibly at the same time, and wait for all of them.  The
+ * threads are started the first time there's work for them.
+ */
+void
+WorkerThreadRun(WorkerThreadProc proc, void *data, int njobs)
+{
+    WorkerJob job = { proc, data, njobs, 0, 0 };
+
+    if (njobs <= 0)
+        return;
+
+    /* nested or concurrent calls just run their jobs here */
+    if (njobs == 1 || __atomic_exchange_n(&workerBusy, 1, __ATOMIC_ACQUIRE)) {
+        WorkerThreadDrain(&job);
+        return;
+    }
+
+    if (!WorkerThreadStart()) {
+        WorkerThreadDrain(&job);
+        __atomic_store_n(&workerBusy, 0, __ATOMIC_RELEASE);
+        return;
+    }
+
+    pthread_mutex_lock(&worker_mutex);
+    workerJob = &job;
+    pthread_cond_broadcast(&worker_start);
+    pthread_mutex_unlock(&worker_mutex);
+
+    WorkerThreadDrain(&job);
+
+    pthread_mutex_lock(&worker_mutex);
+    workerJob = NULL;
+    while (job.users)
+        pthread_cond_wait(&worker_done, &worker_mutex);
+    pthread_mutex_unlock(&worker_mutex);
+
+    __atomic_store_n(&workerBusy, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Stop the worker threads, if they were started.
+ */
+void
+WorkerThreadFini(void)
+{
+    int i;
+
+    if (!workerThreads) {
+        workerFailed = FALSE;
+        return;
+    }
+
+    pthread_mutex_lock(&worker_mutex);
+    workerRunning = FALSE;
+    pthread_cond_broadcast(&worker_start);
+    pthread_mutex_unlock(&worker_mutex);
+
+    for (i = 0; i < numWorkerThreads; i++)
+        pthread_join(workerThreads[i], NULL);
+
+    free(workerThreads);
+    workerThreads = NULL;
+    numWorkerThreads = 0;
+    workerFailed = FALSE;
+}
+
+#else /* INPUTTHREAD */
+
+int
+WorkerThreadParallelism(void)
+{
+    return 1;
+}
+
+void
+WorkerThreadRun(WorkerThreadProc proc, void *data, int njobs)
+{
+    int i;
+
+    for (i = 0; i < njobs; i++)
+        (*proc) (data, i);
+}
+
+void WorkerThreadFini(void) {}
+
+#endif
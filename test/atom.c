@@ -0,0 +1,164 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <X11/Xatom.h>
+#include "misc.h"
+#include "dix.h"
+
+#include "tests-common.h"
+
+/**
+ * Checks atom lookups and creation: predefined atoms, names that are not
+ * atoms yet, names with embedded NULs, and enough atoms to grow the hash
+ * table and the string arena several times over while the names handed
+ * out earlier stay where they were.
+ */
+
+#define NUM_ATOMS       5000
+#define LONG_NAME       (20 * 1024)
+
+static void
+atom_lookup(void)
+{
+    Atom atom, last;
+
+    InitAtoms();
+    assert(MakeAtom("PRIMARY", 7, FALSE) == XA_PRIMARY);
+    assert(MakeAtom("PRIMARY", 7, TRUE) == XA_PRIMARY);
+    assert(MakeAtom("WM_TRANSIENT_FOR", 16, FALSE) == XA_WM_TRANSIENT_FOR);
+    assert(strcmp(NameForAtom(XA_STRING), "STRING") == 0);
+
+    /* a prefix or an extension of a name is a different name */
+    assert(MakeAtom("PRIMAR", 6, FALSE) == None);
+    assert(MakeAtom("PRIMARY_", 8, FALSE) == None);
+    assert(MakeAtom("PRIMARYX", 7, FALSE) == XA_PRIMARY);
+
+    /* looking up doesn't create */
+    assert(MakeAtom("_XSERVER_TEST", 13, FALSE) == None);
+    assert(!ValidAtom(XA_LAST_PREDEFINED + 1));
+
+    atom = MakeAtom("_XSERVER_TEST", 13, TRUE);
+    assert(atom == XA_LAST_PREDEFINED + 1);
+    assert(ValidAtom(atom));
+    assert(MakeAtom("_XSERVER_TEST", 13, FALSE) == atom);
+    assert(MakeAtom("_XSERVER_TEST", 13, TRUE) == atom);
+    assert(strcmp(NameForAtom(atom), "_XSERVER_TEST") == 0);
+
+    last = MakeAtom("", 0, TRUE);
+    assert(last == atom + 1);
+    assert(MakeAtom("", 0, FALSE) == last);
+    assert(strcmp(NameForAtom(last), "") == 0);
+
+    assert(NameForAtom(None) == NULL);
+    assert(NameForAtom(last + 1) == NULL);
+}
+
+static void
+atom_embedded_nul(void)
+{
+    Atom a, b, c, d;
+
+    InitAtoms();
+    a = MakeAtom("a\0b", 3, TRUE);
+    b = MakeAtom("a\0c", 3, TRUE);
+    c = MakeAtom("a", 1, TRUE);
+    d = MakeAtom("a\0", 2, TRUE);
+    assert(a != None && b != None && c != None && d != None);
+    assert(a != b && a != c && a != d && b != c && b != d && c != d);
+
+    assert(MakeAtom("a\0b", 3, FALSE) == a);
+    assert(MakeAtom("a\0c", 3, FALSE) == b);
+    assert(MakeAtom("a\0d", 3, FALSE) == None);
+    assert(MakeAtom("a", 1, FALSE) == c);
+    assert(MakeAtom("a\0", 2, FALSE) == d);
+
+    assert(memcmp(NameForAtom(a), "a\0b", 4) == 0);
+    assert(memcmp(NameForAtom(b), "a\0c", 4) == 0);
+    assert(strcmp(NameForAtom(c), "a") == 0);
+}
+
+static void
+atom_growth(void)
+{
+    static const char *names[NUM_ATOMS];
+    static Atom atoms[NUM_ATOMS];
+    char buf[32], *long_name;
+    const char *long_copy;
+    Atom long_atom;
+    int i, len;
+
+    InitAtoms();
+    long_name = malloc(LONG_NAME + 1);
+    assert(long_name);
+    memset(long_name, 'x', LONG_NAME);
+    long_name[LONG_NAME] = '\0';
+
+    /* far past the initial table, with a name too long for an arena
+     * block in the middle */
+    for (i = 0; i < NUM_ATOMS; i++) {
+        if (i == NUM_ATOMS / 2) {
+            long_atom = MakeAtom(long_name, LONG_NAME, TRUE);
+            assert(long_atom != None && long_atom != BAD_RESOURCE);
+            long_copy = NameForAtom(long_atom);
+        }
+        len = snprintf(buf, sizeof(buf), "_XSERVER_TEST_%d", i);
+        atoms[i] = MakeAtom(buf, len, TRUE);
+        assert(atoms[i] != None && atoms[i] != BAD_RESOURCE);
+        names[i] = NameForAtom(atoms[i]);
+        assert(strcmp(names[i], buf) == 0);
+    }
+
+    /* every atom is still found, and its name hasn't moved */
+    for (i = 0; i < NUM_ATOMS; i++) {
+        len = snprintf(buf, sizeof(buf), "_XSERVER_TEST_%d", i);
+        assert(MakeAtom(buf, len, FALSE) == atoms[i]);
+        assert(MakeAtom(buf, len, TRUE) == atoms[i]);
+        assert(NameForAtom(atoms[i]) == names[i]);
+        assert(strcmp(names[i], buf) == 0);
+    }
+    assert(MakeAtom(long_name, LONG_NAME, FALSE) == long_atom);
+    assert(NameForAtom(long_atom) == long_copy);
+    assert(strcmp(long_copy, long_name) == 0);
+    assert(MakeAtom(long_name, LONG_NAME - 1, FALSE) == None);
+    assert(MakeAtom("PRIMARY", 7, FALSE) == XA_PRIMARY);
+
+    FreeAllAtoms();
+    assert(!ValidAtom(XA_PRIMARY));
+    assert(MakeAtom("PRIMARY", 7, FALSE) == None);
+    free(long_name);
+}
+
+int
+atom_test(void)
+{
+    atom_lookup();
+    atom_embedded_nul();
+    atom_growth();
+
+    return 0;
+}
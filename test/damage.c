@@ -0,0 +1,192 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+#include <string.h>
+#include "misc.h"
+#include "scrnintstr.h"
+#include "damage.h"
+#include "damagestr.h"
+
+#include "tests-common.h"
+
+/**
+ * Checks that damage capped with DamageSetMaxRects stays within the cap
+ * while still covering everything that was reported, both as it is
+ * accumulated and when the cap is set on damage that is already there.
+ */
+
+#define MAX_RECTS       8
+#define NUM_BOXES       500
+
+static DamageRec damage;
+static RegionRec reported;
+
+static void
+report(DamagePtr pDamage, RegionPtr pRegion, void *closure)
+{
+    RegionUnion(&reported, &reported, pRegion);
+}
+
+static void
+setup(DamageReportLevel level)
+{
+    memset(&damage, 0, sizeof(damage));
+    damage.damageLevel = level;
+    damage.damageReport = report;
+    RegionNull(&damage.damage);
+    RegionNull(&damage.pendingDamage);
+    RegionNull(&reported);
+}
+
+static void
+teardown(void)
+{
+    RegionUninit(&damage.damage);
+    RegionUninit(&damage.pendingDamage);
+    RegionUninit(&reported);
+}
+
+/* small disjoint boxes scattered over the coordinate space, ending past
+ * the largest tile so the approximation has to fall back to the extents */
+static BoxRec
+nth_box(int i)
+{
+    BoxRec box;
+
+    box.x1 = (i * 7919) % 32000 - 16000;
+    box.y1 = (i * 104729) % 32000 - 16000;
+    box.x2 = box.x1 + 1 + i % 3;
+    box.y2 = box.y1 + 1 + i % 5;
+    return box;
+}
+
+static void
+add_box(int i)
+{
+    BoxRec box = nth_box(i);
+    RegionRec region;
+
+    RegionInit(&region, &box, 1);
+    DamageReportDamage(&damage, &region);
+    RegionUninit(&region);
+}
+
+static void
+assert_covers(RegionPtr pRegion, int nboxes)
+{
+    BoxRec box;
+    int i;
+
+    for (i = 0; i < nboxes; i++) {
+        box = nth_box(i);
+        assert(RegionContainsRect(pRegion, &box) == rgnIN);
+    }
+}
+
+static void
+damage_accumulate(DamageReportLevel level)
+{
+    int i;
+
+    setup(level);
+    DamageSetMaxRects(&damage, MAX_RECTS);
+    for (i = 0; i < NUM_BOXES; i++) {
+        add_box(i);
+        assert(RegionNumRects(&damage.damage) <= MAX_RECTS);
+        if (i % 37 == 0)
+            assert_covers(&damage.damage, i + 1);
+    }
+    assert_covers(&damage.damage, NUM_BOXES);
+
+    /* every report together covers what was accumulated */
+    if (level == DamageReportRawRegion || level == DamageReportDeltaRegion)
+        assert_covers(&reported, NUM_BOXES);
+    if (level == DamageReportDeltaRegion) {
+        RegionSubtract(&reported, &damage.damage, &reported);
+        assert(!RegionNotEmpty(&reported));
+    }
+    teardown();
+}
+
+static void
+damage_set_later(void)
+{
+    int i;
+
+    /* exact damage first, then capped afterwards */
+    setup(DamageReportNone);
+    for (i = 0; i < 64; i++)
+        add_box(i);
+    assert(RegionNumRects(&damage.damage) == 64);
+
+    DamageSetMaxRects(&damage, MAX_RECTS);
+    assert(RegionNumRects(&damage.damage) <= MAX_RECTS);
+    assert_covers(&damage.damage, 64);
+
+    /* back to exact: nothing is approximated any more */
+    DamageSetMaxRects(&damage, 0);
+    RegionEmpty(&damage.damage);
+    for (i = 0; i < 64; i++)
+        add_box(i);
+    assert(RegionNumRects(&damage.damage) == 64);
+    teardown();
+}
+
+static void
+damage_small_area(void)
+{
+    int i;
+
+    /* boxes within one tile snap to that tile, not the whole extents */
+    setup(DamageReportNone);
+    DamageSetMaxRects(&damage, 1);
+    for (i = 0; i < 16; i++) {
+        BoxRec box = { i * 4, i, i * 4 + 1, i + 1 };
+        RegionRec region;
+
+        RegionInit(&region, &box, 1);
+        DamageReportDamage(&damage, &region);
+        RegionUninit(&region);
+        assert(RegionContainsRect(&damage.damage, &box) == rgnIN);
+    }
+    assert(RegionNumRects(&damage.damage) == 1);
+    assert(RegionExtents(&damage.damage)->x2 <= 64);
+    assert(RegionExtents(&damage.damage)->y2 <= 32);
+    teardown();
+}
+
+int
+damage_test(void)
+{
+    damage_accumulate(DamageReportNone);
+    damage_accumulate(DamageReportRawRegion);
+    damage_accumulate(DamageReportDeltaRegion);
+    damage_accumulate(DamageReportBoundingBox);
+    damage_set_later();
+    damage_small_area();
+
+    return 0;
+}
@@ -0,0 +1,302 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "misc.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "gcstruct.h"
+#include "fb.h"
+
+#include "tests-common.h"
+
+/**
+ * Fills and copies with fb split into bands over the worker threads, and
+ * checks that they leave the same pixels as doing them in one go: copies
+ * between pixmaps and scrolls within one in every direction, solid fills
+ * of many boxes, and solid and tiled fills of large rectangles.
+ */
+
+#define WIDTH           1000
+#define HEIGHT          700
+
+static const int bpps[] = { 1, 8, 16, 24, 32 };
+
+static ScreenRec screen;
+static PixmapRec pixmaps[3];   /* source, destination and tile */
+static GCPtr gc;
+
+static void
+setup_screen(void)
+{
+    memset(&screen, 0, sizeof(screen));
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+
+    dixInitScreenSpecificPrivates(&screen);
+    assert(dixAllocatePrivates(&screen.devPrivates, PRIVATE_SCREEN));
+    assert(fbAllocatePrivates(&screen));
+
+    gc = dixAllocateScreenObjectWithPrivates(&screen, GC, PRIVATE_GC);
+    assert(gc);
+    gc->pScreen = &screen;
+}
+
+static void
+setup_pixmap(PixmapPtr pixmap, int width, int height, int bpp)
+{
+    CARD32 *bits;
+    int stride = BitmapBytePad(width * bpp);
+    int i;
+
+    free(pixmap->devPrivate.ptr);
+    memset(pixmap, 0, sizeof(*pixmap));
+    pixmap->drawable.type = DRAWABLE_PIXMAP;
+    pixmap->drawable.pScreen = &screen;
+    pixmap->drawable.width = width;
+    pixmap->drawable.height = height;
+    pixmap->drawable.depth = bpp == 32 ? 24 : bpp;
+    pixmap->drawable.bitsPerPixel = bpp;
+    pixmap->devKind = stride;
+
+    bits = malloc(stride * height);
+    assert(bits);
+    for (i = 0; i < stride * height / 4; i++)
+        bits[i] = i * 2654435761u;
+    pixmap->devPrivate.ptr = bits;
+}
+
+/* Run draw without and then with threads, and compare the results */
+static void
+check_threaded(PixmapPtr dst, void (*draw) (void *), void *closure)
+{
+    size_t size = dst->devKind * dst->drawable.height;
+    void *orig = malloc(size), *serial = malloc(size);
+
+    assert(orig && serial);
+    memcpy(orig, dst->devPrivate.ptr, size);
+
+    WorkerThreadMinPixels = 0;
+    (*draw) (closure);
+    memcpy(serial, dst->devPrivate.ptr, size);
+
+    memcpy(dst->devPrivate.ptr, orig, size);
+    WorkerThreadMinPixels = 1;
+    (*draw) (closure);
+    assert(memcmp(serial, dst->devPrivate.ptr, size) == 0);
+
+    WorkerThreadMinPixels = 0;
+    free(orig);
+    free(serial);
+}
+
+typedef struct {
+    PixmapPtr src, dst;
+    BoxPtr boxes;
+    int nbox, dx, dy;
+} copy_case;
+
+static void
+do_copy(void *closure)
+{
+    copy_case *c = closure;
+
+    /* as miCopyRegion decides it; the boxes are in a safe order */
+    fbCopyNtoN(&c->src->drawable, &c->dst->drawable, NULL, c->boxes,
+               c->nbox, c->dx, c->dy, c->dx < 0, c->dy < 0, 0, NULL);
+}
+
+static int
+make_boxes(BoxPtr boxes, int n, int width, int height)
+{
+    int i, x, y;
+
+    /* a column of boxes, one band each, in order top to bottom */
+    for (i = 0, y = 0; i < n && y < height; i++) {
+        x = rand() % (width / 2);
+        boxes[i].x1 = x;
+        boxes[i].x2 = x + 1 + rand() % (width - x);
+        boxes[i].y1 = y;
+        y += 1 + rand() % (2 * height / n);
+        boxes[i].y2 = y = min(y, height);
+    }
+    return i;
+}
+
+static void
+fb_band_copy(void)
+{
+    static const struct {
+        int dx, dy;
+    } moves[] = {
+        { 0, 0 }, { 37, 0 }, { -37, 0 }, { 0, 41 }, { 0, -41 },
+        { 3, -1 }, { -1, 3 },
+    };
+    BoxRec boxes[64];
+    copy_case c;
+    int i, j, k, x1, y1;
+
+    for (i = 0; i < ARRAY_SIZE(bpps); i++) {
+        setup_pixmap(&pixmaps[0], WIDTH, HEIGHT, bpps[i]);
+        setup_pixmap(&pixmaps[1], WIDTH, HEIGHT, bpps[i]);
+
+        for (j = 0; j < ARRAY_SIZE(moves); j++) {
+            for (k = 0; k < 4; k++) {
+                /* pixmap to pixmap, then scrolling within one */
+                c.src = &pixmaps[k & 1];
+                c.dst = &pixmaps[1];
+                c.dx = moves[j].dx;
+                c.dy = moves[j].dy;
+                x1 = abs(c.dx);
+                y1 = abs(c.dy);
+                c.nbox = make_boxes(boxes, k < 2 ? 1 : ARRAY_SIZE(boxes),
+                                    WIDTH - 2 * x1, HEIGHT - 2 * y1);
+                for (c.boxes = boxes; c.boxes < boxes + c.nbox; c.boxes++) {
+                    c.boxes->x1 += x1;
+                    c.boxes->x2 += x1;
+                    c.boxes->y1 += y1;
+                    c.boxes->y2 += y1;
+                }
+                c.boxes = boxes;
+                if (c.dy < 0) {
+                    /* bottom to top, as miCopyRegion would */
+                    BoxRec *a = boxes, *b = boxes + c.nbox - 1;
+
+                    for (; a < b; a++, b--) {
+                        BoxRec t = *a;
+
+                        *a = *b;
+                        *b = t;
+                    }
+                }
+                check_threaded(c.dst, do_copy, &c);
+            }
+        }
+    }
+}
+
+typedef struct {
+    PixmapPtr dst;
+    RegionPtr region;
+    FbBits and, xor;
+} fill_region_case;
+
+static void
+do_fill_region(void *closure)
+{
+    fill_region_case *f = closure;
+
+    fbFillRegionSolid(&f->dst->drawable, f->region, f->and, f->xor);
+}
+
+typedef struct {
+    PixmapPtr dst;
+    xRectangle rect;
+} fill_case;
+
+static void
+do_fill(void *closure)
+{
+    fill_case *f = closure;
+
+    fbFill(&f->dst->drawable, gc, f->rect.x, f->rect.y,
+           f->rect.width, f->rect.height);
+}
+
+static void
+fb_band_fill(void)
+{
+    fill_region_case fr;
+    fill_case f;
+    xRectangle rects[200];
+    FbGCPrivPtr priv = fbGetGCPrivate(gc);
+    int i, j, n;
+
+    for (i = 0; i < ARRAY_SIZE(bpps); i++) {
+        setup_pixmap(&pixmaps[1], WIDTH, HEIGHT, bpps[i]);
+
+        /* window backgrounds: many boxes, copy and xor */
+        for (j = 0; j < ARRAY_SIZE(rects); j++) {
+            rects[j].x = rand() % WIDTH;
+            rects[j].y = rand() % HEIGHT;
+            rects[j].width = 1 + rand() % (WIDTH - rects[j].x);
+            rects[j].height = 1 + rand() % (HEIGHT - rects[j].y);
+        }
+        n = 1 + rand() % ARRAY_SIZE(rects);
+        fr.dst = &pixmaps[1];
+        fr.region = RegionFromRects(n, rects, CT_UNSORTED);
+        assert(fr.region);
+        fr.and = 0;
+        fr.xor = fbReplicatePixel(0x123456, bpps[i]);
+        check_threaded(fr.dst, do_fill_region, &fr);
+        fr.and = FB_ALLONES;
+        check_threaded(fr.dst, do_fill_region, &fr);
+        RegionDestroy(fr.region);
+
+        /* solid, then tiled with a tile the bands cut through */
+        f.dst = &pixmaps[1];
+        f.rect.x = 3;
+        f.rect.y = 5;
+        f.rect.width = WIDTH - 10;
+        f.rect.height = HEIGHT - 7;
+
+        gc->fillStyle = FillSolid;
+        gc->alu = GXxor;
+        priv->pm = FB_ALLONES;
+        priv->and = fbAnd(GXxor, fbReplicatePixel(0x5a5a5a, bpps[i]),
+                          FB_ALLONES);
+        priv->xor = fbXor(GXxor, fbReplicatePixel(0x5a5a5a, bpps[i]),
+                          FB_ALLONES);
+        check_threaded(f.dst, do_fill, &f);
+
+        setup_pixmap(&pixmaps[2], 13, 11, bpps[i]);
+        gc->fillStyle = FillTiled;
+        gc->alu = GXcopy;
+        gc->tile.pixmap = &pixmaps[2];
+        gc->patOrg.x = 7;
+        gc->patOrg.y = 3;
+        check_threaded(f.dst, do_fill, &f);
+    }
+}
+
+int
+fbband_test(void)
+{
+    /* make sure the bands really are spread over threads */
+    if (WorkerThreadParallelism() < 2)
+        WorkerThreadCount = 3;
+
+    srand(0xfba);
+    setup_screen();
+    fb_band_copy();
+    fb_band_fill();
+
+    WorkerThreadFini();
+    return 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fb.h"
+
+#include "tests-common.h"
+
+/**
+ * Copies random rectangles with fbBlt, at every bpp, between two buffers
+ * and within one, and checks the result bit by bit against a plain copy
+ * with and without the SIMD kernels.
+ */
+
+#define STRIDE          160     /* FbBits, 5120 bits per row */
+#define HEIGHT          16
+
+static FbBits src_buf[STRIDE * HEIGHT], dst_buf[STRIDE * HEIGHT];
+static FbBits expect[STRIDE * HEIGHT], orig[STRIDE * HEIGHT];
+
+static const int bpps[] = { 1, 4, 8, 16, 24, 32 };
+
+static void
+fill_random(FbBits *buf, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        buf[i] = (FbBits) rand() << 16 ^ rand();
+}
+
+/* bits count from the left of the screen, as in fbBlt */
+static int
+get_bit(const FbBits *row, int x)
+{
+#if BITMAP_BIT_ORDER == LSBFirst
+    return (row[x >> FB_SHIFT] >> (x & FB_MASK)) & 1;
+#else
+    return (row[x >> FB_SHIFT] >> (FB_MASK - (x & FB_MASK))) & 1;
+#endif
+}
+
+static void
+set_bit(FbBits *row, int x, int bit)
+{
+#if BITMAP_BIT_ORDER == LSBFirst
+    FbBits mask = (FbBits) 1 << (x & FB_MASK);
+#else
+    FbBits mask = (FbBits) 1 << (FB_MASK - (x & FB_MASK));
+#endif
+
+    if (bit)
+        row[x >> FB_SHIFT] |= mask;
+    else
+        row[x >> FB_SHIFT] &= ~mask;
+}
+
+/* copy from a snapshot of the source, which is what CopyArea means */
+static void
+reference_blt(const FbBits *src, int sx, int sy, FbBits *dst, int dx, int dy,
+              int width, int height)
+{
+    int x, y;
+
+    for (y = 0; y < height; y++)
+        for (x = 0; x < width; x++)
+            set_bit(dst + (dy + y) * STRIDE, dx + x,
+                    get_bit(src + (sy + y) * STRIDE, sx + x));
+}
+
+static void
+check_blt(Bool same, int bpp, int sx, int sy, int dx, int dy,
+          int width, int height)
+{
+    FbBits *src = same ? dst_buf : src_buf;
+    Bool reverse = same && sy == dy && sx < dx;
+    Bool upsidedown = same && sy < dy;
+    int i;
+
+    /* fbBlt works in bits; pixel positions are multiples of bpp */
+    sx *= bpp;
+    dx *= bpp;
+    width *= bpp;
+
+    memcpy(orig, dst_buf, sizeof(dst_buf));
+    memcpy(expect, dst_buf, sizeof(dst_buf));
+    reference_blt(same ? orig : src_buf, sx, sy, expect, dx, dy,
+                  width, height);
+
+    for (i = 0; i < 2; i++) {
+        fbBltUseSimd = i;
+        memcpy(dst_buf, orig, sizeof(dst_buf));
+        fbBlt(src + sy * STRIDE, STRIDE, sx, dst_buf + dy * STRIDE, STRIDE,
+              dx, width, height, GXcopy, FB_ALLONES, bpp, reverse, upsidedown);
+        assert(memcmp(dst_buf, expect, sizeof(dst_buf)) == 0);
+    }
+}
+
+static void
+fb_blt_copy(void)
+{
+    int i, j, bpp, width, height, sx, sy, dx, dy;
+
+    srand(0xb17);
+    fbBltInit();
+
+    for (i = 0; i < ARRAY_SIZE(bpps); i++) {
+        bpp = bpps[i];
+        for (j = 0; j < 2000; j++) {
+            int pixels = STRIDE * FB_UNIT / bpp;
+
+            fill_random(src_buf, ARRAY_SIZE(src_buf));
+            fill_random(dst_buf, ARRAY_SIZE(dst_buf));
+
+            /* mostly short rows, some long enough for the kernels */
+            width = 1 + rand() % (j & 1 ? pixels / 2 : 64);
+            height = 1 + rand() % HEIGHT;
+            sx = rand() % (pixels - width + 1);
+            dx = rand() % (pixels - width + 1);
+            sy = rand() % (HEIGHT - height + 1);
+            dy = rand() % (HEIGHT - height + 1);
+            check_blt(FALSE, bpp, sx, sy, dx, dy, width, height);
+
+            /* scrolling: the same rows, or rows close by */
+            dy = j & 2 ? sy : sy + rand() % 5 - 2;
+            dy = min(max(dy, 0), HEIGHT - height);
+            dx = sx + rand() % 65 - 32;
+            dx = min(max(dx, 0), pixels - width);
+            check_blt(TRUE, bpp, sx, sy, dx, dy, width, height);
+        }
+    }
+    fbBltUseSimd = TRUE;
+}
+
+int
+fbblt_test(void)
+{
+    fb_blt_copy();
+
+    return 0;
+}
@@ -0,0 +1,285 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "misc.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "picturestr.h"
+#include "damage.h"
+#include "fb.h"
+#include "fbpict.h"
+
+#include "tests-common.h"
+
+/**
+ * Draws streams of trapezoids and triangles like the ones cairo sends,
+ * filled circles cut into slices and the strokes of a line chart, through
+ * a mask with fbTrapezoids and fbTriangles, and checks that rasterizing
+ * the mask in bands on the worker threads leaves the same pixels as doing
+ * it in one go.
+ */
+
+#define WIDTH           640
+#define HEIGHT          480
+
+static ScreenRec screen;
+static PixmapPtr pixmap;
+static PictFormatRec dst_format, mask_format;
+static PictureRec dst;
+static PicturePtr src;
+
+typedef struct {
+    int ntrap;
+    xTrapezoid *traps;
+    int ntri;
+    xTriangle *tris;
+} stream;
+
+static xFixed
+fixed(double d)
+{
+    return (xFixed) floor(d * 65536 + 0.5);
+}
+
+static void
+setup(int width, int height)
+{
+    xRenderColor color = { 0x8000, 0x4000, 0xc000, 0xa000 };
+    BoxRec clip = { 5, 3, width - 7, height - 2 };
+    CARD32 *bits;
+    int stride = width * 4, error, i;
+
+    if (!pixmap) {
+        memset(&screen, 0, sizeof(screen));
+        screenInfo.numScreens = 1;
+        screenInfo.screens[0] = &screen;
+
+        dixInitScreenSpecificPrivates(&screen);
+        assert(dixAllocatePrivates(&screen.devPrivates, PRIVATE_SCREEN));
+        assert(fbAllocatePrivates(&screen));
+        assert(DamageSetup(&screen));
+
+        src = CreateSolidPicture(0, &color, &error);
+        assert(src);
+    }
+    else {
+        free(pixmap->devPrivate.ptr);
+        RegionDestroy(dst.pCompositeClip);
+        dixFreeObjectWithPrivates(pixmap, PRIVATE_PIXMAP);
+    }
+
+    pixmap = dixAllocateScreenObjectWithPrivates(&screen, PixmapRec,
+                                                 PRIVATE_PIXMAP);
+    assert(pixmap);
+    pixmap->drawable.type = DRAWABLE_PIXMAP;
+    pixmap->drawable.pScreen = &screen;
+    pixmap->drawable.width = width;
+    pixmap->drawable.height = height;
+    pixmap->drawable.depth = 32;
+    pixmap->drawable.bitsPerPixel = 32;
+    pixmap->devKind = stride;
+    bits = malloc(stride * height);
+    assert(bits);
+    for (i = 0; i < stride * height / 4; i++)
+        bits[i] = i * 2654435761u;
+    pixmap->devPrivate.ptr = bits;
+
+    dst_format.format = PICT_a8r8g8b8;
+    memset(&dst, 0, sizeof(dst));
+    dst.pDrawable = &pixmap->drawable;
+    dst.pFormat = &dst_format;
+    dst.format = PICT_a8r8g8b8;
+    dst.pCompositeClip = RegionCreate(&clip, 1);
+    assert(dst.pCompositeClip);
+}
+
+static void
+add_trap(stream *s, double top, double bottom, double l1, double l2,
+         double r1, double r2)
+{
+    xTrapezoid *t;
+
+    s->traps = reallocarray(s->traps, s->ntrap + 1, sizeof(xTrapezoid));
+    assert(s->traps);
+    t = &s->traps[s->ntrap++];
+    t->top = fixed(top);
+    t->bottom = fixed(bottom);
+    t->left.p1.x = fixed(l1);
+    t->left.p1.y = t->top;
+    t->left.p2.x = fixed(l2);
+    t->left.p2.y = t->bottom;
+    t->right.p1.x = fixed(r1);
+    t->right.p1.y = t->top;
+    t->right.p2.x = fixed(r2);
+    t->right.p2.y = t->bottom;
+}
+
+static void
+add_tri(stream *s, double x1, double y1, double x2, double y2,
+        double x3, double y3)
+{
+    xTriangle *t;
+
+    s->tris = reallocarray(s->tris, s->ntri + 1, sizeof(xTriangle));
+    assert(s->tris);
+    t = &s->tris[s->ntri++];
+    t->p1.x = fixed(x1);
+    t->p1.y = fixed(y1);
+    t->p2.x = fixed(x2);
+    t->p2.y = fixed(y2);
+    t->p3.x = fixed(x3);
+    t->p3.y = fixed(y3);
+}
+
+/* a filled circle, as slices with sloped sides */
+static void
+add_circle(stream *s, double cx, double cy, double r, int slices)
+{
+    double y0, y1, w0, w1;
+    int i;
+
+    for (i = 0; i < slices; i++) {
+        y0 = cy - r + 2 * r * i / slices;
+        y1 = cy - r + 2 * r * (i + 1) / slices;
+        w0 = sqrt(fmax(r * r - (y0 - cy) * (y0 - cy), 0));
+        w1 = sqrt(fmax(r * r - (y1 - cy) * (y1 - cy), 0));
+        add_trap(s, y0, y1, cx - w0, cx - w1, cx + w0, cx + w1);
+    }
+}
+
+/* the stroke of a line chart, each segment as a trapezoid with slanted
+ * sides and as the two triangles of a parallelogram */
+static void
+add_chart(stream *s, int width, int height, int points, double line)
+{
+    double x0, y0, x1, y1;
+    int i;
+
+    x0 = 0;
+    y0 = height / 2;
+    for (i = 1; i <= points; i++) {
+        x1 = (double) width * i / points;
+        y1 = fmin(fmax(y0 + (rand() % 2001 - 1000) * height / 8000.0, 0),
+                  height - line);
+        if (y0 < y1)
+            add_trap(s, y0, y1 + line, x0 - line, x1, x0, x1 + line);
+        else
+            add_trap(s, y1, y0 + line, x1, x0 - line, x1 + line, x0);
+        add_tri(s, x0, y0, x1, y1, x1, y1 + line);
+        add_tri(s, x0, y0, x1, y1 + line, x0, y0 + line);
+        x0 = x1;
+        y0 = y1;
+    }
+}
+
+static void
+free_stream(stream *s)
+{
+    free(s->traps);
+    free(s->tris);
+    memset(s, 0, sizeof(*s));
+}
+
+static void
+draw(CARD8 op, PictFormatPtr format, stream *s)
+{
+    if (s->ntrap)
+        fbTrapezoids(op, src, &dst, format, 0, 0, s->ntrap, s->traps);
+    if (s->ntri)
+        fbTriangles(op, src, &dst, format, 0, 0, s->ntri, s->tris);
+}
+
+/* Draw without and then with threads, and compare the results */
+static void
+check_threaded(CARD8 op, PictFormatPtr format, stream *s)
+{
+    size_t size = pixmap->devKind * pixmap->drawable.height;
+    void *orig = malloc(size), *serial = malloc(size);
+
+    assert(orig && serial);
+    memcpy(orig, pixmap->devPrivate.ptr, size);
+
+    WorkerThreadMinPixels = 0;
+    draw(op, format, s);
+    memcpy(serial, pixmap->devPrivate.ptr, size);
+    assert(memcmp(serial, orig, size) != 0);
+
+    memcpy(pixmap->devPrivate.ptr, orig, size);
+    WorkerThreadMinPixels = 1;
+    draw(op, format, s);
+    assert(memcmp(serial, pixmap->devPrivate.ptr, size) == 0);
+
+    WorkerThreadMinPixels = 0;
+    free(orig);
+    free(serial);
+}
+
+static void
+fb_trap_streams(void)
+{
+    static const CARD8 ops[] = { PictOpOver, PictOpAdd, PictOpSrc };
+    static const CARD32 formats[] = { PICT_a8, PICT_a4, PICT_a1 };
+    stream s = { 0 };
+    int i, j, k;
+
+    setup(WIDTH, HEIGHT);
+
+    for (i = 0; i < ARRAY_SIZE(formats); i++) {
+        mask_format.format = formats[i];
+        for (j = 0; j < ARRAY_SIZE(ops); j++) {
+            /* overlapping circles, some reaching outside the clip */
+            for (k = 0; k < 20; k++)
+                add_circle(&s, rand() % WIDTH, rand() % HEIGHT,
+                           10 + rand() % 200, 4 + rand() % 60);
+            check_threaded(ops[j], &mask_format, &s);
+            free_stream(&s);
+
+            add_chart(&s, WIDTH, HEIGHT, 50 + rand() % 200,
+                      1 + rand() % 5 / 2.0);
+            check_threaded(ops[j], &mask_format, &s);
+            free_stream(&s);
+        }
+    }
+}
+
+int
+fbtrap_test(void)
+{
+    /* make sure the bands really are spread over threads */
+    if (WorkerThreadParallelism() < 2)
+        WorkerThreadCount = 3;
+
+    srand(0x7a9);
+    fb_trap_streams();
+
+    WorkerThreadFini();
+    return 0;
+}
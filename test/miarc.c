@@ -0,0 +1,240 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "misc.h"
+#include "scrnintstr.h"
+#include "gcstruct.h"
+#include "windowstr.h"
+#include "mi.h"
+#include "mifillarc.h"
+
+#include "tests-common.h"
+
+/**
+ * Draws markers, a few arcs over and over at random places, and checks
+ * that they cover the same pixels with the arc span cache as without it:
+ * circles and ellipses, whole and in part, solid and dashed, with every
+ * cap and join, and some of them joined to the next one.
+ */
+
+#define WIDTH           400
+#define HEIGHT          300
+
+static ScreenRec screen;
+static WindowRec window;
+static GCPtr gc;
+static GCOps ops;
+static GCFuncs funcs;
+
+/* times each pixel was drawn */
+static unsigned char counts[HEIGHT][WIDTH];
+
+static void
+draw_span(int x, int y, int w)
+{
+    long end = (long) x + w;
+
+    if (y < 0 || y >= HEIGHT)
+        return;
+    for (x = max(x, 0); x < min(end, WIDTH); x++)
+        counts[y][x]++;
+}
+
+static void
+test_fill_spans(DrawablePtr draw, GCPtr pGC, int n, DDXPointPtr points,
+                int *widths, int sorted)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        draw_span(points[i].x, points[i].y, widths[i]);
+}
+
+static void
+test_poly_fill_rect(DrawablePtr draw, GCPtr pGC, int n, xRectangle *rects)
+{
+    int i, y;
+
+    for (i = 0; i < n; i++)
+        for (y = rects[i].y; y < rects[i].y + rects[i].height; y++)
+            draw_span(rects[i].x, y, rects[i].width);
+}
+
+static void
+test_validate_gc(GCPtr pGC, unsigned long changes, DrawablePtr draw)
+{
+}
+
+static void
+test_change_gc(GCPtr pGC, unsigned long mask)
+{
+}
+
+static void
+setup(void)
+{
+    static unsigned char dashes[] = { 11, 5, 2, 5 };
+
+    memset(&screen, 0, sizeof(screen));
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+    dixInitScreenSpecificPrivates(&screen);
+    assert(dixAllocatePrivates(&screen.devPrivates, PRIVATE_SCREEN));
+
+    /* a window, so that the arcs are moved by its origin */
+    window.drawable.type = DRAWABLE_WINDOW;
+    window.drawable.pScreen = &screen;
+    window.drawable.x = 13;
+    window.drawable.y = 7;
+    window.drawable.width = WIDTH;
+    window.drawable.height = HEIGHT;
+    window.drawable.depth = 8;
+    window.drawable.bitsPerPixel = 8;
+
+    ops.FillSpans = test_fill_spans;
+    ops.PolyFillRect = test_poly_fill_rect;
+    funcs.ValidateGC = test_validate_gc;
+    funcs.ChangeGC = test_change_gc;
+
+    gc = dixAllocateScreenObjectWithPrivates(&screen, GC, PRIVATE_GC);
+    assert(gc);
+    gc->pScreen = &screen;
+    gc->ops = &ops;
+    gc->funcs = &funcs;
+    gc->miTranslate = TRUE;
+    gc->alu = GXcopy;
+    gc->fgPixel = 1;
+    gc->bgPixel = 2;
+    gc->dash = dashes;
+    gc->numInDashList = ARRAY_SIZE(dashes);
+    gc->dashOffset = 3;
+}
+
+static void
+draw(int narcs, xArc *arcs)
+{
+    miPolyArc(&window.drawable, gc, narcs, arcs);
+    ScratchReset();
+}
+
+static void
+random_shape(xArc *arc)
+{
+    arc->width = rand() % 50;
+    arc->height = rand() % 3 ? arc->width : rand() % 50;
+    arc->angle1 = rand() % (4 * FULLCIRCLE) - 2 * FULLCIRCLE;
+    switch (rand() % 3) {
+    case 0:
+        arc->angle2 = FULLCIRCLE;
+        break;
+    case 1:
+        arc->angle2 = (rand() % 8 - 4) * 45 * 64;
+        break;
+    default:
+        arc->angle2 = rand() % (2 * FULLCIRCLE) - FULLCIRCLE;
+        break;
+    }
+}
+
+/* markers: the same few shapes at random places, some joined up */
+static int
+random_markers(xArc *arcs, int n, xArc *shapes, int nshapes)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        if (i > 0 && rand() % 8 == 0) {
+            /* the rest of the ellipse, starting where the last arc ends */
+            arcs[i] = arcs[i - 1];
+            arcs[i].angle1 += arcs[i].angle2;
+            arcs[i].angle2 = FULLCIRCLE / 2 - arcs[i].angle2;
+            continue;
+        }
+        arcs[i] = shapes[rand() % nshapes];
+        arcs[i].x = rand() % (WIDTH + 40) - 20;
+        arcs[i].y = rand() % (HEIGHT + 40) - 20;
+    }
+    return n;
+}
+
+static void
+mi_arc_cache_markers(void)
+{
+    static const int styles[] = { LineSolid, LineOnOffDash, LineDoubleDash };
+    static const int caps[] = { CapButt, CapRound, CapProjecting };
+    static const int joins[] = { JoinMiter, JoinRound, JoinBevel };
+    static unsigned char uncached[HEIGHT][WIDTH];
+    unsigned long hits = miArcCacheHits, misses;
+    xArc shapes[6], arcs[60];
+    int i, j, narcs;
+
+    for (i = 0; i < 300; i++) {
+        for (j = 0; j < ARRAY_SIZE(shapes); j++)
+            random_shape(&shapes[j]);
+        narcs = random_markers(arcs, 1 + rand() % ARRAY_SIZE(arcs),
+                               shapes, 1 + rand() % ARRAY_SIZE(shapes));
+        gc->lineWidth = 1 + rand() % 8;
+        gc->lineStyle = styles[i % ARRAY_SIZE(styles)];
+        gc->capStyle = caps[rand() % ARRAY_SIZE(caps)];
+        gc->joinStyle = joins[rand() % ARRAY_SIZE(joins)];
+
+        memset(counts, 0, sizeof(counts));
+        miArcCacheEnabled = FALSE;
+        draw(narcs, arcs);
+        memcpy(uncached, counts, sizeof(counts));
+
+        /* the first time fills the cache, the second uses it */
+        miArcCacheEnabled = TRUE;
+        for (j = 0; j < 2; j++) {
+            memset(counts, 0, sizeof(counts));
+            draw(narcs, arcs);
+            assert(memcmp(counts, uncached, sizeof(counts)) == 0);
+        }
+    }
+    assert(miArcCacheHits > hits);
+
+    /* a flushed cache starts over */
+    misses = miArcCacheMisses;
+    miArcCacheFlush();
+    memset(counts, 0, sizeof(counts));
+    draw(narcs, arcs);
+    assert(memcmp(counts, uncached, sizeof(counts)) == 0);
+    assert(miArcCacheMisses > misses);
+}
+
+int
+miarc_test(void)
+{
+    srand(0xa7c);
+    setup();
+    mi_arc_cache_markers();
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include "assert.h"
+#include "misc.h"
+#include "inputstr.h"
+#include "eventstr.h"
+#include "mi.h"
+
+#include "tests-common.h"
+
+#if INPUTTHREAD
+#include <pthread.h>
+#endif
+
+/**
+ * Exercises the event queue between a producer that enqueues with
+ * input_lock held, as the input thread does, and the main thread
+ * draining it without the lock.  Checks that events come out in order,
+ * that motion events from one device are still folded together.
+ */
+
+#define STRESS_EVENTS 2000000
+
+static DeviceIntRec devs[2];
+static SpriteInfoRec spriteInfo[2];
+static SpriteRec sprite[2];
+
+static uint32_t last_raw, last_motion[2];
+static uint32_t n_raw, n_motion;
+
+static void
+init_devices(void)
+{
+    int i;
+
+    memset(devs, 0, sizeof(devs));
+    memset(spriteInfo, 0, sizeof(spriteInfo));
+    memset(sprite, 0, sizeof(sprite));
+    for (i = 0; i < 2; i++) {
+        devs[i].id = 2 + i;
+        devs[i].enabled = 1;
+        devs[i].spriteInfo = &spriteInfo[i];
+        spriteInfo[i].sprite = &sprite[i];
+    }
+}
+
+static void
+raw_handler(int screenNum, InternalEvent *ie, DeviceIntPtr dev)
+{
+    RawDeviceEvent *e = &ie->raw_event;
+
+    assert(e->type == ET_RawMotion);
+    assert(e->flags > last_raw);
+    last_raw = e->flags;
+    n_raw++;
+}
+
+static void
+motion_handler(int screenNum, InternalEvent *ie, DeviceIntPtr dev)
+{
+    DeviceEvent *e = &ie->device_event;
+    int i = dev - devs;
+
+    assert(e->type == ET_Motion);
+    assert(e->deviceid == dev->id);
+    /* folding may skip events, but never reorders them */
+    assert(e->flags > last_motion[i]);
+    last_motion[i] = e->flags;
+    n_motion++;
+}
+
+static void
+enqueue_raw(DeviceIntPtr dev, uint32_t seq)
+{
+    RawDeviceEvent e = { 0 };
+
+    e.header = ET_Internal;
+    e.type = ET_RawMotion;
+    e.length = sizeof(e);
+    e.deviceid = dev->id;
+    e.flags = seq;
+
+    mieqEnqueue(dev, (InternalEvent *) &e);
+}
+
+static void
+enqueue_motion(DeviceIntPtr dev, uint32_t seq)
+{
+    DeviceEvent e = { 0 };
+
+    e.header = ET_Internal;
+    e.type = ET_Motion;
+    e.length = sizeof(e);
+    e.deviceid = dev->id;
+    e.flags = seq;
+
+    mieqEnqueue(dev, (InternalEvent *) &e);
+}
+
+static void
+reset_counters(void)
+{
+    last_raw = n_raw = n_motion = 0;
+    last_motion[0] = last_motion[1] = 0;
+}
+
+static void
+mieq_motion_compression(void)
+{
+    reset_counters();
+
+    /* consecutive motion from one device collapses into the last one */
+    enqueue_motion(&devs[0], 1);
+    enqueue_motion(&devs[0], 2);
+    enqueue_motion(&devs[0], 3);
+    mieqProcessInputEvents();
+    assert(n_motion == 1);
+    assert(last_motion[0] == 3);
+
+    /* but not across devices */
+    enqueue_motion(&devs[0], 4);
+    enqueue_motion(&devs[1], 1);
+    enqueue_motion(&devs[0], 5);
+    mieqProcessInputEvents();
+    assert(n_motion == 4);
+    assert(last_motion[0] == 5 && last_motion[1] == 1);
+
+    /* nor across other events */
+    enqueue_motion(&devs[0], 6);
+    enqueue_raw(&devs[0], 1);
+    enqueue_motion(&devs[0], 7);
+    mieqProcessInputEvents();
+    assert(n_motion == 6 && n_raw == 1);
+
+    /* a dequeued event is never rewritten */
+    enqueue_motion(&devs[0], 8);
+    mieqProcessInputEvents();
+    enqueue_motion(&devs[0], 9);
+    mieqProcessInputEvents();
+    assert(n_motion == 8);
+    assert(last_motion[0] == 9);
+}
+
+static void
+mieq_overflow(void)
+{
+    uint32_t i;
+
+    reset_counters();
+
+    /* the queue grows up to its maximum, then drops the newest events */
+    for (i = 1; i <= 20000; i++)
+        enqueue_raw(&devs[0], i);
+    mieqProcessInputEvents();
+    assert(n_raw > 512 && n_raw < 20000);
+
+    /* and recovers once drained */
+    enqueue_raw(&devs[0], 20001);
+    mieqProcessInputEvents();
+    assert(last_raw == 20001);
+}
+
+#if INPUTTHREAD
+static volatile int producer_done;
+
+static void *
+producer(void *arg)
+{
+    uint32_t i;
+
+    for (i = 1; i <= STRESS_EVENTS; i++) {
+        input_lock();
+        if (i % 4)
+            enqueue_raw(&devs[0], i);
+        else
+            enqueue_motion(&devs[i % 8 ? 0 : 1], i);
+        input_unlock();
+    }
+    __atomic_store_n(&producer_done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void
+mieq_threaded(void)
+{
+    pthread_t thread;
+
+    reset_counters();
+    producer_done = 0;
+
+    assert(pthread_create(&thread, NULL, producer, NULL) == 0);
+    while (!__atomic_load_n(&producer_done, __ATOMIC_ACQUIRE))
+        mieqProcessInputEvents();
+    mieqProcessInputEvents();
+    pthread_join(thread, NULL);
+
+    assert(n_raw > 0 && n_motion > 0);
+}
+#endif
+
+int
+mieq_stress_test(void)
+{
+    init_devices();
+    mieqInit();
+    mieqSetHandler(ET_RawMotion, raw_handler);
+    mieqSetHandler(ET_Motion, motion_handler);
+
+    mieq_motion_compression();
+    mieq_overflow();
+#if INPUTTHREAD
+    mieq_threaded();
+#endif
+
+    mieqFini();
+    return 0;
+}
@@ -0,0 +1,205 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "misc.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "gcstruct.h"
+#include "mi.h"
+
+#include "tests-common.h"
+
+/**
+ * Draws wide polylines, solid and dashed, and checks that with a rop that
+ * must touch each pixel once they cover the same pixels as with GXcopy,
+ * each of them once.
+ */
+
+#define WIDTH           400
+#define HEIGHT          300
+
+static ScreenRec screen;
+static PixmapRec pixmap;
+static GCPtr gc;
+static GCOps ops;
+static GCFuncs funcs;
+
+/* times each pixel was drawn */
+static unsigned char counts[HEIGHT][WIDTH];
+
+static void
+draw_span(int x, int y, int w)
+{
+    if (y < 0 || y >= HEIGHT)
+        return;
+    for (w += x, x = max(x, 0); x < min(w, WIDTH); x++)
+        counts[y][x]++;
+}
+
+static void
+test_fill_spans(DrawablePtr draw, GCPtr pGC, int n, DDXPointPtr points,
+                int *widths, int sorted)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        draw_span(points[i].x, points[i].y, widths[i]);
+}
+
+static void
+test_poly_fill_rect(DrawablePtr draw, GCPtr pGC, int n, xRectangle *rects)
+{
+    int i, y;
+
+    for (i = 0; i < n; i++)
+        for (y = rects[i].y; y < rects[i].y + rects[i].height; y++)
+            draw_span(rects[i].x, y, rects[i].width);
+}
+
+static void
+test_validate_gc(GCPtr pGC, unsigned long changes, DrawablePtr draw)
+{
+}
+
+static void
+test_change_gc(GCPtr pGC, unsigned long mask)
+{
+}
+
+static void
+setup(void)
+{
+    static unsigned char dashes[] = { 13, 7, 3, 7 };
+
+    memset(&screen, 0, sizeof(screen));
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+    dixInitScreenSpecificPrivates(&screen);
+    assert(dixAllocatePrivates(&screen.devPrivates, PRIVATE_SCREEN));
+
+    pixmap.drawable.type = DRAWABLE_PIXMAP;
+    pixmap.drawable.pScreen = &screen;
+    pixmap.drawable.width = WIDTH;
+    pixmap.drawable.height = HEIGHT;
+    pixmap.drawable.depth = 8;
+    pixmap.drawable.bitsPerPixel = 8;
+
+    ops.FillSpans = test_fill_spans;
+    ops.PolyFillRect = test_poly_fill_rect;
+    funcs.ValidateGC = test_validate_gc;
+    funcs.ChangeGC = test_change_gc;
+
+    gc = dixAllocateScreenObjectWithPrivates(&screen, GC, PRIVATE_GC);
+    assert(gc);
+    gc->pScreen = &screen;
+    gc->ops = &ops;
+    gc->funcs = &funcs;
+    gc->fgPixel = 1;
+    gc->bgPixel = 2;
+    gc->dash = dashes;
+    gc->numInDashList = ARRAY_SIZE(dashes);
+    gc->dashOffset = 5;
+}
+
+static void
+draw(int npt, DDXPointPtr pts)
+{
+    if (gc->lineStyle == LineSolid)
+        miWideLine(&pixmap.drawable, gc, CoordModeOrigin, npt, pts);
+    else
+        miWideDash(&pixmap.drawable, gc, CoordModeOrigin, npt, pts);
+    ScratchReset();
+}
+
+static void
+random_polyline(DDXPointPtr pts, int npt, int width, int height)
+{
+    int i;
+
+    /* like a plot: left to right, jumping up and down */
+    for (i = 0; i < npt; i++) {
+        pts[i].x = (long) i * width / npt + rand() % 9 - 4;
+        pts[i].y = rand() % height;
+    }
+    /* and sometimes closed */
+    if (rand() % 4 == 0)
+        pts[npt - 1] = pts[0];
+}
+
+static void
+mi_wide_line_once(void)
+{
+    static const int widths[] = { 2, 3, 5, 10, 20 };
+    static const int styles[] = { LineSolid, LineOnOffDash, LineDoubleDash };
+    static const int caps[] = { CapButt, CapRound, CapProjecting };
+    static const int joins[] = { JoinMiter, JoinRound, JoinBevel };
+    static unsigned char copied[HEIGHT][WIDTH];
+    DDXPointRec pts[40];
+    int i, x, y, npt;
+
+    for (i = 0; i < 300; i++) {
+        npt = 2 + rand() % (ARRAY_SIZE(pts) - 1);
+        random_polyline(pts, npt, WIDTH, HEIGHT);
+        gc->lineWidth = widths[rand() % ARRAY_SIZE(widths)];
+        gc->lineStyle = styles[i % ARRAY_SIZE(styles)];
+        gc->capStyle = caps[rand() % ARRAY_SIZE(caps)];
+        gc->joinStyle = joins[rand() % ARRAY_SIZE(joins)];
+
+        /* GXcopy draws every piece as it comes, overlapping */
+        memset(counts, 0, sizeof(counts));
+        gc->alu = GXcopy;
+        draw(npt, pts);
+        for (y = 0; y < HEIGHT; y++)
+            for (x = 0; x < WIDTH; x++)
+                copied[y][x] = counts[y][x] != 0;
+
+        /* GXxor merges the pieces of each colour */
+        memset(counts, 0, sizeof(counts));
+        gc->alu = GXxor;
+        draw(npt, pts);
+        for (y = 0; y < HEIGHT; y++)
+            for (x = 0; x < WIDTH; x++) {
+                assert(!counts[y][x] == !copied[y][x]);
+                /* each colour only once */
+                assert(counts[y][x] <=
+                       (gc->lineStyle == LineDoubleDash ? 2 : 1));
+            }
+    }
+}
+
+int
+miwideline_test(void)
+{
+    srand(0x31de);
+    setup();
+    mi_wide_line_once();
+
+    return 0;
+}
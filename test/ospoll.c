@@ -0,0 +1,373 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "os.h"
+#include "ospoll.h"
+
+#include "tests-common.h"
+
+/**
+ * Drives the ospoll API on pipes and sockets, once with the default
+ * backend and once with -uring, and checks that both report the same
+ * events: level and edge triggered reads, writes, muting, and fds
+ * removed from their own callbacks, more of them than fit in the
+ * io_uring submission ring at once, and enough changes at once that
+ * the kernel can't take them all.
+ */
+
+#define MANY_FDS        300
+#define FULL_FDS        1024
+
+struct watch {
+    struct ospoll       *ospoll;
+    int                 fd;
+    int                 calls;
+    int                 xevents;
+};
+
+static void
+count_events(int fd, int xevents, void *data)
+{
+    struct watch *w = data;
+
+    assert(fd == w->fd);
+    w->calls++;
+    w->xevents |= xevents;
+}
+
+static void
+remove_self(int fd, int xevents, void *data)
+{
+    count_events(fd, xevents, data);
+    ospoll_remove(((struct watch *) data)->ospoll, fd);
+}
+
+/* io_uring instances open in this process */
+static int
+uring_fds(void)
+{
+    char path[64], link[64];
+    struct dirent *ent;
+    DIR *dir;
+    int n = 0;
+    ssize_t len;
+
+    dir = opendir("/proc/self/fd");
+    if (!dir)
+        return 0;
+    while ((ent = readdir(dir))) {
+        snprintf(path, sizeof(path), "/proc/self/fd/%s", ent->d_name);
+        len = readlink(path, link, sizeof(link) - 1);
+        if (len < 0)
+            continue;
+        link[len] = '\0';
+        if (strcmp(link, "anon_inode:[io_uring]") == 0)
+            n++;
+    }
+    closedir(dir);
+    return n;
+}
+
+static struct ospoll *
+create(Bool uring)
+{
+    struct ospoll *ospoll;
+    int before = uring_fds();
+
+    OsPollUring = uring;
+    ospoll = ospoll_create();
+    assert(ospoll);
+
+    /* epoll unless asked for io_uring */
+    if (!uring)
+        assert(uring_fds() == before);
+    return ospoll;
+}
+
+static void
+wait_for(struct ospoll *ospoll, struct watch *w, int calls)
+{
+    int i;
+
+    for (i = 0; i < 100 && w->calls < calls; i++)
+        assert(ospoll_wait(ospoll, 100) >= 0);
+    assert(w->calls == calls);
+}
+
+static void
+ospoll_level(Bool uring)
+{
+    struct ospoll *ospoll = create(uring);
+    struct watch w = { ospoll };
+    int fds[2];
+    char c = 'x';
+
+    assert(pipe(fds) == 0);
+    w.fd = fds[0];
+    assert(ospoll_add(ospoll, fds[0], ospoll_trigger_level,
+                      count_events, &w));
+    ospoll_listen(ospoll, fds[0], X_NOTIFY_READ);
+    assert(ospoll_data(ospoll, fds[0]) == &w);
+
+    ospoll_wait(ospoll, 0);
+    assert(w.calls == 0);
+
+    /* reported for as long as there is something to read */
+    assert(write(fds[1], &c, 1) == 1);
+    wait_for(ospoll, &w, 1);
+    assert(w.xevents == X_NOTIFY_READ);
+    wait_for(ospoll, &w, 2);
+
+    assert(read(fds[0], &c, 1) == 1);
+    ospoll_wait(ospoll, 0);
+    assert(w.calls == 2);
+
+    /* and not once muted or removed */
+    assert(write(fds[1], &c, 1) == 1);
+    ospoll_mute(ospoll, fds[0], X_NOTIFY_READ);
+    ospoll_wait(ospoll, 0);
+    assert(w.calls == 2);
+    ospoll_listen(ospoll, fds[0], X_NOTIFY_READ);
+    wait_for(ospoll, &w, 3);
+
+    ospoll_remove(ospoll, fds[0]);
+    assert(ospoll_data(ospoll, fds[0]) == NULL);
+    ospoll_wait(ospoll, 0);
+    assert(w.calls == 3);
+
+    ospoll_destroy(ospoll);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void
+ospoll_edge(Bool uring)
+{
+    struct ospoll *ospoll = create(uring);
+    struct watch w = { ospoll };
+    int fds[2];
+    char buf[4] = "abc";
+
+    assert(pipe(fds) == 0);
+    w.fd = fds[0];
+    assert(ospoll_add(ospoll, fds[0], ospoll_trigger_edge,
+                      count_events, &w));
+    ospoll_listen(ospoll, fds[0], X_NOTIFY_READ);
+
+    /* reported once, however long it goes unread */
+    assert(write(fds[1], buf, 1) == 1);
+    wait_for(ospoll, &w, 1);
+    ospoll_wait(ospoll, 0);
+    ospoll_wait(ospoll, 0);
+    assert(w.calls == 1);
+
+    /* then again for new data once it has all been read */
+    assert(read(fds[0], buf, sizeof(buf)) == 1);
+    ospoll_reset_events(ospoll, fds[0]);
+    ospoll_wait(ospoll, 0);
+    assert(w.calls == 1);
+    assert(write(fds[1], buf, 3) == 3);
+    wait_for(ospoll, &w, 2);
+    assert(w.xevents == X_NOTIFY_READ);
+
+    ospoll_remove(ospoll, fds[0]);
+    ospoll_destroy(ospoll);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void
+ospoll_write(Bool uring)
+{
+    struct ospoll *ospoll = create(uring);
+    struct watch w = { ospoll };
+    int fds[2];
+
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    w.fd = fds[0];
+    assert(ospoll_add(ospoll, fds[0], ospoll_trigger_level,
+                      count_events, &w));
+
+    /* an empty socket can be written, and has nothing to read */
+    ospoll_listen(ospoll, fds[0], X_NOTIFY_READ | X_NOTIFY_WRITE);
+    wait_for(ospoll, &w, 1);
+    assert(w.xevents == X_NOTIFY_WRITE);
+
+    ospoll_mute(ospoll, fds[0], X_NOTIFY_WRITE);
+    ospoll_wait(ospoll, 0);
+    ospoll_wait(ospoll, 0);
+    assert(w.calls == 1);
+
+    assert(write(fds[1], "x", 1) == 1);
+    w.xevents = 0;
+    wait_for(ospoll, &w, 2);
+    assert(w.xevents == X_NOTIFY_READ);
+
+    ospoll_remove(ospoll, fds[0]);
+    ospoll_destroy(ospoll);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+static void
+ospoll_many(Bool uring)
+{
+    struct ospoll *ospoll = create(uring);
+    struct watch w[MANY_FDS];
+    int fds[MANY_FDS][2];
+    int i, j, pending;
+
+    for (i = 0; i < MANY_FDS; i++) {
+        assert(pipe(fds[i]) == 0);
+        w[i] = (struct watch) { ospoll, fds[i][0] };
+        assert(ospoll_add(ospoll, fds[i][0], i % 2 ? ospoll_trigger_edge
+                          : ospoll_trigger_level, remove_self, &w[i]));
+        ospoll_listen(ospoll, fds[i][0], X_NOTIFY_READ);
+        assert(write(fds[i][1], "x", 1) == 1);
+    }
+
+    /* every fd is reported, once, and then is gone */
+    for (j = 0, pending = MANY_FDS; j < 100 && pending; j++) {
+        assert(ospoll_wait(ospoll, 100) >= 0);
+        for (i = 0, pending = 0; i < MANY_FDS; i++)
+            if (!w[i].calls)
+                pending++;
+    }
+    assert(pending == 0);
+    ospoll_wait(ospoll, 0);
+    for (i = 0; i < MANY_FDS; i++) {
+        assert(w[i].calls == 1);
+        assert(w[i].xevents == X_NOTIFY_READ);
+        assert(ospoll_data(ospoll, fds[i][0]) == NULL);
+    }
+
+    ospoll_destroy(ospoll);
+    for (i = 0; i < MANY_FDS; i++) {
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+}
+
+static void
+ospoll_ring_full(Bool uring)
+{
+    struct ospoll *ospoll = create(uring);
+    struct watch *w = calloc(FULL_FDS, sizeof (*w));
+    int (*fds)[2] = calloc(FULL_FDS, sizeof (*fds));
+    struct rlimit rl;
+    int i, j, n, pending;
+
+    assert(w && fds);
+    assert(getrlimit(RLIMIT_NOFILE, &rl) == 0);
+    if (rl.rlim_cur < rl.rlim_max) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        assert(getrlimit(RLIMIT_NOFILE, &rl) == 0);
+    }
+    n = rl.rlim_cur < 2 * FULL_FDS + 64 ? (rl.rlim_cur - 64) / 2 : FULL_FDS;
+
+    /* more completions than the ring holds, and twice that many
+     * requests queued behind them without a wait in between */
+    for (i = 0; i < n; i++) {
+        assert(pipe(fds[i]) == 0);
+        assert(write(fds[i][1], "x", 1) == 1);
+        w[i] = (struct watch) { ospoll, fds[i][0] };
+        assert(ospoll_add(ospoll, fds[i][0], ospoll_trigger_level,
+                          count_events, &w[i]));
+        ospoll_listen(ospoll, fds[i][0], X_NOTIFY_READ);
+    }
+    assert(ospoll_wait(ospoll, 0) >= 0);
+    for (i = 0; i < n; i++) {
+        ospoll_mute(ospoll, fds[i][0], X_NOTIFY_READ);
+        w[i].calls = 0;
+    }
+    for (i = 0; i < n; i++)
+        ospoll_listen(ospoll, fds[i][0], X_NOTIFY_READ);
+
+    /* none of those changes is lost */
+    for (j = 0, pending = n; j < 100 && pending; j++) {
+        assert(ospoll_wait(ospoll, 100) >= 0);
+        for (i = 0, pending = 0; i < n; i++)
+            if (!w[i].calls)
+                pending++;
+    }
+    assert(pending == 0);
+
+    for (i = 0; i < n; i++)
+        ospoll_mute(ospoll, fds[i][0], X_NOTIFY_READ);
+    assert(ospoll_wait(ospoll, 0) >= 0);
+    for (i = 0; i < n; i++)
+        w[i].calls = 0;
+    assert(ospoll_wait(ospoll, 10) == 0);
+    for (i = 0; i < n; i++)
+        assert(w[i].calls == 0);
+
+    for (i = 0; i < n; i++)
+        ospoll_remove(ospoll, fds[i][0]);
+    ospoll_destroy(ospoll);
+    for (i = 0; i < n; i++) {
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+    free(fds);
+    free(w);
+}
+
+static void
+ospoll_backend(Bool uring)
+{
+    ospoll_level(uring);
+    ospoll_edge(uring);
+    ospoll_write(uring);
+    ospoll_many(uring);
+    ospoll_ring_full(uring);
+}
+
+int
+ospoll_test(void)
+{
+    struct ospoll *ospoll;
+
+    ospoll_backend(FALSE);
+
+    ospoll = create(TRUE);
+    if (uring_fds() == 0)
+        printf("ospoll: io_uring not available, testing the epoll fallback\n");
+    ospoll_destroy(ospoll);
+    ospoll_backend(TRUE);
+
+    OsPollUring = FALSE;
+    return 0;
+}
@@ -0,0 +1,231 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/Xatom.h>
+#include "misc.h"
+#include "dixstruct.h"
+#include "scrnintstr.h"
+#include "windowstr.h"
+#include "propertyst.h"
+#include "xace.h"
+#include "xacestr.h"
+
+#include "tests-common.h"
+
+/**
+ * Polyinstantiates a property the way SELinux does, one instance per
+ * client, on a window with enough properties to be indexed, and checks
+ * that each client keeps finding its own instance as the list and the
+ * index change underneath.
+ */
+
+#define POLY            1000
+#define FILLER          2000
+
+static ScreenRec screen;
+static WindowRec window;
+static WindowOptRec optional;
+static ClientRec client_a, client_b;
+static DevPrivateKeyRec ownerKey;
+
+/* like SELinuxProperty: labels new instances, then finds the right one */
+static void
+poly_property_access(CallbackListPtr *pcbl, void *unused, void *calldata)
+{
+    XacePropertyAccessRec *rec = calldata;
+    PropertyPtr pProp = *rec->ppProp;
+    Atom name = pProp->propertyName;
+    int *owner;
+
+    if (rec->access_mode & DixPostAccess)
+        return;
+
+    owner = dixLookupPrivate(&pProp->devPrivates, &ownerKey);
+    if (rec->access_mode & DixCreateAccess) {
+        *owner = rec->client->index;
+        return;
+    }
+    if (name != POLY)
+        return;
+
+    while (pProp->propertyName != name || *owner != rec->client->index) {
+        if ((pProp = pProp->next) == NULL) {
+            rec->status = BadMatch;
+            return;
+        }
+        owner = dixLookupPrivate(&pProp->devPrivates, &ownerKey);
+    }
+    *rec->ppProp = pProp;
+}
+
+static void
+setup(void)
+{
+    screenInfo.numScreens = 1;
+    screenInfo.screens[0] = &screen;
+
+    /* a root window, so that it keeps its optional record */
+    window.drawable.type = DRAWABLE_WINDOW;
+    window.drawable.pScreen = &screen;
+    window.drawable.id = 0x100;
+    window.optional = &optional;
+
+    client_a.index = 1;
+    client_b.index = 2;
+
+    assert(dixRegisterPrivateKey(&ownerKey, PRIVATE_PROPERTY, sizeof(int)));
+    assert(XaceRegisterCallback(XACE_PROPERTY_ACCESS,
+                                poly_property_access, NULL));
+}
+
+static int
+count_instances(Atom name)
+{
+    PropertyPtr pProp;
+    int n = 0;
+
+    for (pProp = wUserProps(&window); pProp; pProp = pProp->next)
+        if (pProp->propertyName == name)
+            n++;
+    return n;
+}
+
+static void
+set(ClientPtr client, Atom name, int value)
+{
+    assert(dixChangeWindowProperty(client, &window, name, XA_INTEGER, 32,
+                                   PropModeReplace, 1, &value,
+                                   FALSE) == Success);
+}
+
+/* the value client sees for name, or -1 if it sees none */
+static int
+get(ClientPtr client, Atom name)
+{
+    PropertyPtr pProp;
+    int rc, *owner;
+
+    rc = dixLookupProperty(&pProp, &window, name, client, DixReadAccess);
+    if (rc == BadMatch)
+        return -1;
+    assert(rc == Success);
+    assert(pProp->propertyName == name);
+    if (name == POLY) {
+        owner = dixLookupPrivate(&pProp->devPrivates, &ownerKey);
+        assert(*owner == client->index);
+    }
+    return *(int *) pProp->data;
+}
+
+static void
+add_fillers(int first, int n)
+{
+    int i;
+
+    for (i = first; i < first + n; i++)
+        set(&client_a, FILLER + i, i);
+}
+
+static void
+check_fillers(int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        assert(get(&client_a, FILLER + i) == i);
+        assert(get(&client_b, FILLER + i) == i);
+    }
+}
+
+static void
+property_poly_instances(void)
+{
+    /* enough to be indexed */
+    add_fillers(0, 20);
+    assert(optional.propIndex);
+
+    /* each client gets its own instance, once */
+    set(&client_a, POLY, 1);
+    set(&client_b, POLY, 2);
+    assert(count_instances(POLY) == 2);
+    set(&client_a, POLY, 11);
+    set(&client_b, POLY, 12);
+    assert(count_instances(POLY) == 2);
+    assert(get(&client_a, POLY) == 11);
+    assert(get(&client_b, POLY) == 12);
+
+    /* still so when the index is rebuilt bigger */
+    add_fillers(20, 100);
+    assert(count_instances(POLY) == 2);
+    assert(get(&client_a, POLY) == 11);
+    assert(get(&client_b, POLY) == 12);
+    check_fillers(120);
+
+    /* deleting the first instance leaves the other one findable */
+    assert(DeleteProperty(&client_b, &window, POLY) == Success);
+    assert(count_instances(POLY) == 1);
+    assert(get(&client_a, POLY) == 11);
+    assert(get(&client_b, POLY) == -1);
+
+    set(&client_b, POLY, 22);
+    assert(count_instances(POLY) == 2);
+    assert(get(&client_a, POLY) == 11);
+    assert(get(&client_b, POLY) == 22);
+
+    /* and so does deleting one further down */
+    assert(DeleteProperty(&client_a, &window, POLY) == Success);
+    assert(count_instances(POLY) == 1);
+    assert(get(&client_a, POLY) == -1);
+    assert(get(&client_b, POLY) == 22);
+
+    set(&client_a, POLY, 31);
+    assert(count_instances(POLY) == 2);
+    assert(get(&client_a, POLY) == 31);
+    assert(get(&client_b, POLY) == 22);
+
+    assert(DeleteProperty(&client_a, &window, POLY) == Success);
+    assert(DeleteProperty(&client_b, &window, POLY) == Success);
+    assert(count_instances(POLY) == 0);
+    assert(get(&client_a, POLY) == -1);
+    assert(get(&client_b, POLY) == -1);
+    check_fillers(120);
+
+    DeleteAllWindowProperties(&window);
+    assert(!optional.propIndex);
+}
+
+int
+property_test(void)
+{
+    setup();
+    property_poly_instances();
+
+    return 0;
+}
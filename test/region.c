@@ -0,0 +1,160 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "misc.h"
+#include "gc.h"
+#include "regionstr.h"
+
+#include "tests-common.h"
+
+/**
+ * Checks that the SIMD and scalar band kernels in dix/region.c produce
+ * identical regions from a few box distributions seen in practice:
+ *
+ * windows: overlapping top-level sized rectangles, as unioned by
+ *          miValidateTree when computing childUnion/totalClip
+ * text:    rows of small glyph-sized boxes, as accumulated by damage
+ * tiles:   an abutting grid, which coalesces into a few large boxes
+ */
+
+enum distribution {
+    DIST_WINDOWS,
+    DIST_TEXT,
+    DIST_TILES,
+};
+
+static int
+make_rects(enum distribution dist, xRectangle *rects, int max)
+{
+    int i, n = 0;
+
+    switch (dist) {
+    case DIST_WINDOWS:
+        for (i = 0; i < max; i++, n++) {
+            rects[n].x = rand() % 3000 - 200;
+            rects[n].y = rand() % 1800 - 100;
+            rects[n].width = 100 + rand() % 1200;
+            rects[n].height = 50 + rand() % 900;
+        }
+        break;
+    case DIST_TEXT:
+        for (i = 0; i < max; i++, n++) {
+            rects[n].x = (i % 120) * 8 + rand() % 3;
+            rects[n].y = (i / 120) * 16;
+            rects[n].width = 4 + rand() % 6;
+            rects[n].height = 13 + rand() % 3;
+        }
+        break;
+    case DIST_TILES:
+        for (i = 0; i < max; i++, n++) {
+            rects[n].x = (i % 32) * 64;
+            rects[n].y = (i / 32) * 64;
+            rects[n].width = 64;
+            rects[n].height = 64;
+        }
+        break;
+    }
+
+    return n;
+}
+
+static void
+assert_regions_equal(RegionPtr a, RegionPtr b)
+{
+    assert(RegionNumRects(a) == RegionNumRects(b));
+    assert(memcmp(RegionExtents(a), RegionExtents(b), sizeof(BoxRec)) == 0);
+    assert(memcmp(RegionRects(a), RegionRects(b),
+                  RegionNumRects(a) * sizeof(BoxRec)) == 0);
+}
+
+static void
+dix_region_simd_matches_scalar(void)
+{
+    Bool simd = regionUseSimd;
+    xRectangle rects[1024];
+    RegionPtr scalar, vector;
+    int dist, n, i;
+
+    srand(0x5eed);
+    for (dist = DIST_WINDOWS; dist <= DIST_TILES; dist++) {
+        for (i = 0; i < 50; i++) {
+            n = make_rects(dist, rects, 1 + rand() % 1024);
+
+            regionUseSimd = FALSE;
+            scalar = RegionFromRects(n, rects, CT_NONE);
+            regionUseSimd = simd;
+            vector = RegionFromRects(n, rects, CT_NONE);
+
+            assert(!RegionNar(scalar));
+            assert_regions_equal(scalar, vector);
+
+            RegionDestroy(scalar);
+            RegionDestroy(vector);
+        }
+    }
+    regionUseSimd = simd;
+}
+
+static void
+dix_region_append_validate(void)
+{
+    xRectangle rects[64];
+    RegionRec total;
+    RegionPtr reg;
+    Bool overlap;
+    int n, i;
+
+    /* the miValidateTree pattern: append each window, validate once */
+    srand(0x5eed);
+    n = make_rects(DIST_WINDOWS, rects, 64);
+
+    RegionNull(&total);
+    for (i = 0; i < n; i++) {
+        reg = RegionFromRects(1, &rects[i], CT_NONE);
+        RegionAppend(&total, reg);
+        RegionDestroy(reg);
+    }
+    assert(RegionValidate(&total, &overlap));
+    assert(overlap);
+
+    reg = RegionFromRects(n, rects, CT_NONE);
+    assert_regions_equal(&total, reg);
+
+    RegionDestroy(reg);
+    RegionUninit(&total);
+}
+
+int
+region_test(void)
+{
+    dix_region_simd_matches_scalar();
+    dix_region_append_validate();
+
+    return 0;
+}
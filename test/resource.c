@@ -0,0 +1,278 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "misc.h"
+#include "dixstruct.h"
+#include "resource.h"
+
+#include "tests-common.h"
+
+/**
+ * Adds, looks up and frees resources of one client: several entries for
+ * one id, walks whose callbacks free and add resources, and a client
+ * with thousands of resources, some of whose delete functions free other
+ * resources of the client as they go.
+ */
+
+#define MANY            5000
+
+typedef struct {
+    XID id;
+    int freed;          /* times deleted */
+    int order;          /* when, counting from 1 */
+    int visits;         /* times a walk came to it */
+    XID partner;        /* freed along with this one, if not 0 */
+} TestResourceRec;
+
+static ClientRec server_client, client;
+static RESTYPE type_a, type_b, test_class;
+static int deletions;
+
+static int
+delete_resource(void *value, XID id)
+{
+    TestResourceRec *res = value;
+
+    assert(res->id == id);
+    res->freed++;
+    res->order = ++deletions;
+    if (res->partner)
+        FreeResource(res->partner, RT_NONE);
+    return Success;
+}
+
+static void
+setup(void)
+{
+    serverClient = &server_client;
+    InitClient(serverClient, 0, NULL);
+    assert(InitClientResources(serverClient));
+    InitClient(&client, 1, NULL);
+    assert(InitClientResources(&client));
+
+    test_class = CreateNewResourceClass();
+    type_a = CreateNewResourceType(delete_resource, "TestA") | test_class;
+    type_b = CreateNewResourceType(delete_resource, "TestB") | test_class;
+    assert(type_a && type_b && test_class);
+}
+
+static XID
+client_id(int n)
+{
+    return client.clientAsMask | (n + 1);
+}
+
+static void *
+lookup_type(XID id, RESTYPE type)
+{
+    void *value;
+
+    if (dixLookupResourceByType(&value, id, type, NULL, DixReadAccess))
+        return NULL;
+    return value;
+}
+
+static void *
+lookup_class(XID id, RESTYPE rclass)
+{
+    void *value;
+
+    if (dixLookupResourceByClass(&value, id, rclass, NULL, DixReadAccess))
+        return NULL;
+    return value;
+}
+
+static void
+resource_duplicate_ids(void)
+{
+    TestResourceRec a = { client_id(0) }, b = a, c = a;
+    XID id = a.id;
+
+    deletions = 0;
+    assert(AddResource(id, type_a, &a));
+    assert(AddResource(id, type_b, &b));
+
+    assert(lookup_type(id, type_a) == &a);
+    assert(lookup_type(id, type_b) == &b);
+    assert(lookup_type(id, RT_GC) == NULL);
+
+    /* the newest in the class, even just after finding an older one */
+    assert(lookup_type(id, type_a) == &a);
+    assert(lookup_class(id, test_class) == &b);
+    assert(lookup_class(id, RC_ANY) == &b);
+    assert(lookup_type(id, type_a) == &a);
+
+    FreeResourceByType(id, type_b, FALSE);
+    assert(b.freed == 1);
+    assert(lookup_type(id, type_b) == NULL);
+    assert(lookup_class(id, test_class) == &a);
+
+    /* the same type twice: the newest is found, and freed first */
+    assert(AddResource(id, type_b, &b));
+    assert(AddResource(id, type_b, &c));
+    assert(lookup_type(id, type_b) == &c);
+    assert(ChangeResourceValue(id, type_a, &a));
+    assert(lookup_type(id, type_b) == &c);
+
+    FreeResource(id, RT_NONE);
+    assert(a.freed == 1 && b.freed == 2 && c.freed == 1);
+    assert(c.order < b.order && b.order < a.order);
+    assert(lookup_class(id, RC_ANY) == NULL);
+}
+
+static TestResourceRec *walked;
+static int walk_next;
+
+/* frees the next resource, and adds one */
+static void
+free_next(void *value, XID id, void *cdata)
+{
+    TestResourceRec *res = value;
+    TestResourceRec *added = (TestResourceRec *) cdata + walk_next;
+
+    assert(res->id == id && !res->freed);
+    res->visits++;
+    if (res + 1 < walked + MANY)
+        FreeResource(res[1].id, RT_NONE);
+    *added = (TestResourceRec) { client_id(MANY + walk_next++) };
+    assert(AddResource(added->id, type_a, added));
+}
+
+static Bool
+find_freed(void *value, XID id, void *cdata)
+{
+    TestResourceRec *res = value;
+
+    assert(!res->freed);
+    return id == *(XID *) cdata;
+}
+
+static void
+resource_walk_frees(void)
+{
+    static TestResourceRec res[MANY], added[MANY];
+    int i;
+
+    walked = res;
+    walk_next = 0;
+    for (i = 0; i < MANY; i++) {
+        res[i] = (TestResourceRec) { client_id(i) };
+        assert(AddResource(res[i].id, type_a, &res[i]));
+    }
+    memset(added, 0, sizeof(added));
+
+    /* each one is visited once, unless it was freed before its turn */
+    FindClientResourcesByType(&client, type_a, free_next, added);
+    for (i = 0; i < MANY; i++) {
+        assert(res[i].visits <= 1);
+        assert(res[i].visits || res[i].freed);
+        assert(added[i].visits == 0);
+        if (res[i].visits && i + 1 < MANY)
+            assert(res[i + 1].freed);
+    }
+    assert(walk_next > 0);
+
+    /* the survivors and the added ones are all there */
+    for (i = 0; i < MANY; i += 97)
+        if (!res[i].freed)
+            assert(LookupClientResourceComplex(&client, type_a, find_freed,
+                                               &res[i].id) == &res[i]);
+    for (i = 0; i < walk_next; i++)
+        assert(lookup_type(added[i].id, type_a) == &added[i]);
+
+    FreeClientResources(&client);
+    for (i = 0; i < MANY; i++)
+        assert(res[i].freed == 1);
+    for (i = 0; i < walk_next; i++)
+        assert(added[i].freed == 1);
+    assert(InitClientResources(&client));
+}
+
+static void
+resource_many(void)
+{
+    static TestResourceRec res[MANY], dup[MANY / 10];
+    TestResourceRec *newest;
+    int i, n;
+
+    deletions = 0;
+    for (i = 0; i < MANY; i++) {
+        res[i] = (TestResourceRec) { client_id(i) };
+        /* like a window taking its pixmap with it */
+        if (i % 7 == 0 && i + 1 < MANY)
+            res[i].partner = client_id(i + 1);
+        assert(AddResource(res[i].id, i % 2 ? type_a : type_b, &res[i]));
+    }
+    for (i = 0; i < ARRAY_SIZE(dup); i++) {
+        dup[i] = (TestResourceRec) { client_id(i * 10) };
+        assert(AddResource(dup[i].id, type_a, &dup[i]));
+    }
+
+    for (i = 0; i < MANY; i++) {
+        newest = i % 10 ? &res[i] : &dup[i / 10];
+        assert(lookup_type(res[i].id, i % 2 ? type_a : type_b) == &res[i]);
+        assert(lookup_class(res[i].id, test_class) == newest);
+    }
+
+    /* free some one at a time, in an order of their own */
+    for (i = 0, n = 0; i < MANY; i += 3) {
+        if (res[i].freed || res[i].partner)
+            continue;
+        FreeResourceByType(res[i].id, i % 2 ? type_a : type_b, FALSE);
+        assert(res[i].freed == 1);
+        n++;
+    }
+    assert(n > 0);
+
+    /* then the rest with the client */
+    FreeClientResources(&client);
+    for (i = 0; i < MANY; i++)
+        assert(res[i].freed == 1);
+    for (i = 0; i < ARRAY_SIZE(dup); i++) {
+        assert(dup[i].freed == 1);
+        /* newest first, unless the older one was freed by itself */
+        if ((i * 10) % 3 == 0 && !res[i * 10].partner)
+            assert(res[i * 10].order < dup[i].order);
+        else
+            assert(dup[i].order < res[i * 10].order);
+    }
+    assert(deletions == MANY + ARRAY_SIZE(dup));
+}
+
+int
+resource_test(void)
+{
+    setup();
+    resource_duplicate_ids();
+    resource_walk_frees();
+    resource_many();
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "misc.h"
+#include "scrnintstr.h"
+#include "pixmapstr.h"
+#include "shadow.h"
+
+#include "tests-common.h"
+
+/**
+ * Checks that shadow updates split into bands across worker threads write
+ * the same frame buffer as a single pass, packed and at every rotation.
+ */
+
+typedef struct {
+    int rotation;
+    ShadowUpdateProc update;
+} shadow_update_case;
+
+static const shadow_update_case updates[] = {
+    { 0, shadowUpdatePacked },
+    { 90, shadowUpdateRotate32_90 },
+    { 180, shadowUpdateRotate32_180 },
+    { 270, shadowUpdateRotate32_270 },
+};
+
+static ScreenRec screen;
+static PixmapRec shadow;
+static DamageRec damage;
+static CARD32 *fb;
+static int fb_stride;
+
+static void *
+shadow_window(ScreenPtr pScreen, CARD32 row, CARD32 offset, int mode,
+              CARD32 *size, void *closure)
+{
+    *size = fb_stride;
+    return (char *) fb + row * fb_stride + offset;
+}
+
+static void
+setup(shadowBufPtr pBuf, int width, int height, int rotation)
+{
+    BoxRec box = { 0, 0, width, height };
+    CARD32 *bits;
+    int i;
+
+    /* the screen is what the shadow looks like once rotated */
+    memset(&screen, 0, sizeof(screen));
+    screen.width = rotation % 180 ? height : width;
+    screen.height = rotation % 180 ? width : height;
+    fb_stride = screen.width * sizeof(CARD32);
+
+    bits = calloc(width * height, sizeof(CARD32));
+    assert(bits);
+    for (i = 0; i < width * height; i++)
+        bits[i] = i * 2654435761u;
+
+    memset(&shadow, 0, sizeof(shadow));
+    shadow.drawable.type = DRAWABLE_PIXMAP;
+    shadow.drawable.width = width;
+    shadow.drawable.height = height;
+    shadow.drawable.depth = 24;
+    shadow.drawable.bitsPerPixel = 32;
+    shadow.devKind = width * sizeof(CARD32);
+    shadow.devPrivate.ptr = bits;
+
+    memset(&damage, 0, sizeof(damage));
+    RegionInit(&damage.damage, &box, 1);
+
+    memset(pBuf, 0, sizeof(*pBuf));
+    pBuf->pDamage = &damage;
+    pBuf->window = shadow_window;
+    pBuf->pPixmap = &shadow;
+}
+
+static void
+teardown(void)
+{
+    free(shadow.devPrivate.ptr);
+    RegionUninit(&damage.damage);
+}
+
+static void
+shadow_threaded_matches_serial(void)
+{
+    const shadow_update_case *u;
+    shadowBufRec buf;
+    CARD32 *serial;
+    BoxRec boxes[3] = {
+        { 10, 3, 700, 290 },
+        { 300, 290, 301, 500 },
+        { 0, 510, 640, 600 },
+    };
+    size_t size;
+    int i;
+
+    for (u = updates; u < updates + ARRAY_SIZE(updates); u++) {
+        setup(&buf, 800, 600, u->rotation);
+        RegionUninit(&damage.damage);
+        RegionInit(&damage.damage, NULL, 0);
+        for (i = 0; i < ARRAY_SIZE(boxes); i++) {
+            RegionRec r;
+
+            RegionInit(&r, &boxes[i], 1);
+            RegionUnion(&damage.damage, &damage.damage, &r);
+            RegionUninit(&r);
+        }
+
+        size = fb_stride * screen.height;
+        serial = calloc(1, size);
+        fb = calloc(1, size);
+        assert(serial && fb);
+
+        buf.threaded = FALSE;
+        (*u->update) (&screen, &buf);
+        memcpy(serial, fb, size);
+        memset(fb, 0, size);
+
+        buf.threaded = TRUE;
+        (*u->update) (&screen, &buf);
+        assert(memcmp(serial, fb, size) == 0);
+
+        free(serial);
+        free(fb);
+        teardown();
+    }
+}
+
+int
+shadow_test(void)
+{
+    /* make sure the bands really are spread over threads */
+    if (WorkerThreadParallelism() < 2)
+        WorkerThreadCount = 3;
+
+    shadow_threaded_matches_serial();
+
+    WorkerThreadFini();
+    return 0;
+}
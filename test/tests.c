@@ -9,10 +9,24 @@ main(int argc, char **argv)
     run_test(string_test);
 
 #ifdef XORG_TESTS
+    run_test(atom_test);
+    run_test(damage_test);
+    run_test(fbband_test);
+    run_test(fbblt_test);
+    run_test(fbtrap_test);
     run_test(fixes_test);
     run_test(input_test);
+    run_test(miarc_test);
+    run_test(mieq_stress_test);
     run_test(misc_test);
+    run_test(miwideline_test);
+    run_test(ospoll_test);
+    run_test(property_test);
+    run_test(region_test);
+    run_test(resource_test);
+    run_test(shadow_test);
     run_test(signal_logging_test);
+    run_test(timer_test);
     run_test(touch_test);
     run_test(xfree86_test);
     run_test(xkb_test);
@@ -35,6 +49,7 @@ main(int argc, char **argv)
     run_test(protocol_xiquerypointer_test);
     run_test(protocol_xiwarppointer_test);
     run_test(protocol_eventconvert_test);
+    run_test(delivery_test);
     run_test(xi2_test);
 #endif
 
@@ -1,13 +1,27 @@
 #ifndef TESTS_H
 #define TESTS_H
 
+int atom_test(void);
+int damage_test(void);
+int fbband_test(void);
+int fbblt_test(void);
+int fbtrap_test(void);
 int fixes_test(void);
 int hashtabletest_test(void);
 int input_test(void);
 int list_test(void);
+int miarc_test(void);
+int mieq_stress_test(void);
 int misc_test(void);
+int miwideline_test(void);
+int ospoll_test(void);
+int property_test(void);
+int region_test(void);
+int resource_test(void);
+int shadow_test(void);
 int signal_logging_test(void);
 int string_test(void);
+int timer_test(void);
 int touch_test(void);
 int xfree86_test(void);
 int xkb_test(void);
@@ -25,6 +39,7 @@ int protocol_xipassivegrabdevice_test(void);
 int protocol_xiquerypointer_test(void);
 int protocol_xiwarppointer_test(void);
 int protocol_eventconvert_test(void);
+int delivery_test(void);
 int xi2_test(void);
 
 #ifndef INSIDE_PROTOCOL_COMMON
@@ -0,0 +1,181 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "assert.h"
+#include "misc.h"
+#include "os.h"
+
+#include "tests-common.h"
+
+/**
+ * Sets, moves and cancels lots of timers and checks that the ones left
+ * run in order of expiry, those expiring together in the order they were
+ * set.
+ */
+
+#define NTIMERS 10000
+
+struct expiry {
+    CARD32 expires;
+    int seq;
+};
+
+static struct expiry expiries[NTIMERS];
+static OsTimerPtr timers[NTIMERS];
+static struct expiry last;
+static int fired;
+
+static CARD32
+check_order(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    struct expiry *e = arg;
+
+    assert((int) (now - e->expires) >= 0);
+    if (fired) {
+        assert((int) (e->expires - last.expires) >= 0);
+        assert(e->expires != last.expires || e->seq > last.seq);
+    }
+    last = *e;
+    fired++;
+    return 0;
+}
+
+static CARD32
+never(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    assert(!"timer should not have run");
+    return 0;
+}
+
+static void
+wait_until(CARD32 when)
+{
+    while ((int) (GetTimeInMillis() - when) < 0)
+        usleep(1000);
+}
+
+static void
+timer_order(void)
+{
+    CARD32 base = GetTimeInMillis() + 200;
+    int i, seq = 0, expected = 0;
+
+    srand(1);
+    fired = 0;
+
+    for (i = 0; i < NTIMERS; i++) {
+        expiries[i].expires = base + rand() % 40;
+        expiries[i].seq = seq++;
+        timers[i] = TimerSet(NULL, TimerAbsolute, expiries[i].expires,
+                             check_order, &expiries[i]);
+        assert(timers[i]);
+    }
+
+    /* cancel some, move some, and leave the rest */
+    for (i = 0; i < NTIMERS; i++) {
+        switch (i % 3) {
+        case 0:
+            TimerCancel(timers[i]);
+            break;
+        case 1:
+            expiries[i].expires = base + rand() % 40;
+            expiries[i].seq = seq++;
+            TimerSet(timers[i], TimerAbsolute, expiries[i].expires,
+                     check_order, &expiries[i]);
+            expected++;
+            break;
+        default:
+            expected++;
+            break;
+        }
+    }
+
+    /* nothing runs early */
+    TimerCheck();
+    assert(fired == 0);
+
+    wait_until(base + 40);
+    TimerCheck();
+    assert(fired == expected);
+
+    for (i = 0; i < NTIMERS; i++)
+        TimerFree(timers[i]);
+}
+
+static int periodic_runs;
+
+static CARD32
+periodic(OsTimerPtr timer, CARD32 now, void *arg)
+{
+    /* runs three times, setting itself again from the callback */
+    return ++periodic_runs < 3 ? 1 : 0;
+}
+
+static void
+timer_rearm(void)
+{
+    OsTimerPtr timer, other;
+
+    timer = TimerSet(NULL, 0, 1, periodic, NULL);
+    assert(timer);
+    while (periodic_runs < 3) {
+        usleep(2000);
+        TimerCheck();
+    }
+    usleep(2000);
+    TimerCheck();
+    assert(periodic_runs == 3);
+
+    /* forcing runs a pending timer right away, and only a pending one */
+    periodic_runs = 2;
+    TimerSet(timer, 0, 100000, periodic, NULL);
+    assert(TimerForce(timer));
+    assert(periodic_runs == 3);
+    assert(!TimerForce(timer));
+
+    /* cancelling twice, or a timer that never ran, is harmless */
+    other = TimerSet(NULL, 0, 100000, never, NULL);
+    TimerCancel(other);
+    TimerCancel(other);
+    TimerCancel(timer);
+    TimerCheck();
+
+    TimerFree(timer);
+    TimerFree(other);
+}
+
+int
+timer_test(void)
+{
+    timer_order();
+    timer_rearm();
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+/**
+ * Copyright © 2026 The X.Org Foundation
+ *
+ *  Permission is hereby granted, free of charge, to any person obtaining a
+ *  copy of this software and associated documentation files (the "Software"),
+ *  to deal in the Software without restriction, including without limitation
+ *  the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ *  and/or sell copies of the Software, and to permit persons to whom the
+ *  Software is furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice (including the next
+ *  paragraph) shall be included in all copies or substantial portions of the
+ *  Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ *  THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ *  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ *  DEALINGS IN THE SOFTWARE.
+ */
+
+#ifdef HAVE_DIX_CONFIG_H
+#include <dix-config.h>
+#endif
+
+/*
+ * Replays a stream of pointer events through DeliverDeviceEvents, with
+ * many clients selecting for events on the windows but only a few of
+ * them for motion, and checks who gets what:
+ *
+ * Motion propagates from the pointer window up to the root window, where
+ * every client that selected XI_Motion gets it.
+ * The same clients get it whether the recipients cached on the windows
+ * are reused or rebuilt for every event.
+ * Changing a selection in the middle of the stream takes effect right
+ * away.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <X11/X.h>
+#include <X11/extensions/XI2proto.h>
+#include "inputstr.h"
+#include "windowstr.h"
+#include "scrnintstr.h"
+#include "exevents.h"
+#include "eventstr.h"
+#include "inpututils.h"
+
+#include "protocol-common.h"
+
+#define NCLIENTS        64
+#define MOTION_CLIENTS  8       /* every 8th client selects for motion */
+#define DEPTH           4       /* windows below CLIENT_WINDOW */
+#define NEVENTS         1000
+
+static ClientRec delivery_clients[NCLIENTS];
+static WindowRec children[DEPTH];
+static int writes[NCLIENTS];
+
+static void
+count_writes(ClientPtr client, int len, char *data, void *userdata)
+{
+    int i = client - delivery_clients;
+
+    assert(i >= 0 && i < NCLIENTS);
+    writes[i]++;
+}
+
+static void
+select_events(ClientPtr client, WindowPtr win, int deviceid, ...)
+{
+    unsigned char mask[XIMaskLen(XI2LASTEVENT)] = { 0 };
+    DeviceIntRec dev = { .id = deviceid };
+    va_list args;
+    int type;
+
+    va_start(args, deviceid);
+    while ((type = va_arg(args, int)) >= 0)
+        SetBit(mask, type);
+    va_end(args);
+
+    XISetEventMask(&dev, win, client, sizeof(mask), mask);
+}
+
+static void
+setup_clients(void)
+{
+    WindowPtr pointer_win = &children[DEPTH - 1];
+    int i;
+
+    init_window(&children[0], &window, CLIENT_WINDOW_ID + 1);
+    for (i = 1; i < DEPTH; i++)
+        init_window(&children[i], &children[i - 1], CLIENT_WINDOW_ID + 1 + i);
+
+    for (i = 0; i < NCLIENTS; i++) {
+        ClientPtr client = &delivery_clients[i];
+
+        *client = init_client(0, NULL);
+        client->index = CLIENT_INDEX + 1 + i;
+        client->clientAsMask = client->index << CLIENTOFFSET;
+        clients[client->index] = client;
+
+        /* what most clients select for on the root window */
+        if (i % MOTION_CLIENTS)
+            select_events(client, &root, XIAllDevices, XI_HierarchyChanged,
+                          XI_PropertyEvent, -1);
+        else
+            select_events(client, &root, XIAllMasterDevices, XI_Motion,
+                          XI_HierarchyChanged, -1);
+
+        select_events(client, &window, XIAllMasterDevices, XI_Enter,
+                      XI_Leave, XI_FocusIn, XI_FocusOut, -1);
+    }
+
+    /* someone wants presses on the pointer window, but not motion */
+    select_events(&delivery_clients[1], pointer_win, XIAllMasterDevices,
+                  XI_ButtonPress, -1);
+}
+
+static void
+replay(Bool churn)
+{
+    WindowPtr pointer_win = &children[DEPTH - 1];
+    DeviceIntPtr dev = devices.vcp;
+    DeviceEvent ev;
+    int i, j;
+
+    memset(writes, 0, sizeof(writes));
+
+    for (i = 0; i < NEVENTS; i++) {
+        init_device_event(&ev, dev, i, EVENT_SOURCE_NORMAL);
+        ev.type = ET_Motion;
+        ev.root_x = SPRITE_X + i % 50;
+        ev.root_y = SPRITE_Y + i % 30;
+
+        /* what delivery cost when every event rescanned the masks */
+        if (churn) {
+            InvalidateInputRecipients(&root);
+            InvalidateInputRecipients(pointer_win);
+        }
+
+        DeliverDeviceEvents(pointer_win, (InternalEvent *) &ev, NullGrab,
+                            NullWindow, dev);
+    }
+
+    for (j = 0; j < NCLIENTS; j++)
+        assert(writes[j] == (j % MOTION_CLIENTS ? 0 : NEVENTS));
+}
+
+static void
+test_selection_change(void)
+{
+    WindowPtr pointer_win = &children[DEPTH - 1];
+    DeviceIntPtr dev = devices.vcp;
+    DeviceEvent ev;
+
+    init_device_event(&ev, dev, 0, EVENT_SOURCE_NORMAL);
+    ev.type = ET_Motion;
+    ev.root_x = SPRITE_X;
+    ev.root_y = SPRITE_Y;
+
+    memset(writes, 0, sizeof(writes));
+    DeliverDeviceEvents(pointer_win, (InternalEvent *) &ev, NullGrab,
+                        NullWindow, dev);
+    assert(writes[0] == 1 && writes[1] == 0 && writes[MOTION_CLIENTS] == 1);
+
+    /* client 0 stops listening, client 1 starts, on the root window */
+    select_events(&delivery_clients[0], &root, XIAllMasterDevices,
+                  XI_HierarchyChanged, -1);
+    select_events(&delivery_clients[1], &root, XIAllDevices, XI_Motion, -1);
+
+    memset(writes, 0, sizeof(writes));
+    DeliverDeviceEvents(pointer_win, (InternalEvent *) &ev, NullGrab,
+                        NullWindow, dev);
+    assert(writes[0] == 0 && writes[1] == 1 && writes[MOTION_CLIENTS] == 1);
+
+    /* motion selected on the pointer window stops propagation */
+    select_events(&delivery_clients[2], pointer_win, XIAllMasterDevices,
+                  XI_Motion, -1);
+
+    memset(writes, 0, sizeof(writes));
+    DeliverDeviceEvents(pointer_win, (InternalEvent *) &ev, NullGrab,
+                        NullWindow, dev);
+    assert(writes[1] == 0 && writes[2] == 1 && writes[MOTION_CLIENTS] == 0);
+}
+
+int
+delivery_test(void)
+{
+    init_simple();
+    enable_XISetEventMask_wrap = 0;
+    reply_handler = count_writes;
+
+    setup_clients();
+
+    replay(FALSE);
+    replay(TRUE);
+    test_selection_change();
+
+    return 0;
+}